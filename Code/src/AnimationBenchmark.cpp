@@ -0,0 +1,357 @@
+#include "AnimationBenchmark.h"
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+
+#include "Debug.h"
+
+// written after every iteration so the optimizer can't drop the evaluated transforms
+static volatile float sSink = 0.0f;
+
+static const float sClipTimes[] = { 0.0f, 0.5f, 0.95f };
+static const float sBlendFactors[] = { 0.0f, 0.25f, 0.5f, 0.75f, 1.0f };
+static const unsigned int sInstanceCounts[] = { 1, 16, 64 };
+
+static std::string EscapeJson(const std::string& text)
+{
+	std::string escaped;
+
+	for (const auto& c : text)
+	{
+		if (c == '"' || c == '\\')
+			escaped += '\\';
+
+		escaped += c;
+	}
+
+	return escaped;
+}
+
+static double ClipTimeInSeconds(const aiAnimation& animation, const float& fraction)
+{
+	double ticksPerSecond = animation.mTicksPerSecond != 0 ? animation.mTicksPerSecond : 25.0;
+
+	return fraction * animation.mDuration / ticksPerSecond;
+}
+
+/// <summary>
+/// Loads the model without GL resources, runs every suite and writes the results as JSON
+/// </summary>
+/// <param name="modelPath">Animated model (Models/Character.fbx)</param>
+/// <param name="outputPath">JSON file the results are written to</param>
+/// <param name="iterations">Measured iterations per configuration</param>
+///
+void AnimationBenchmark::Run(const std::string& modelPath, const std::string& outputPath, const unsigned int& iterations)
+{
+	MeshV2 mesh(modelPath, true);
+
+	if (mesh.mPScene->mNumAnimations == 0)
+		Debug::ThrowException("AnimationBenchmark => '" + modelPath + "' has no animations!");
+
+	std::vector<AnimationBenchmarkResult> results;
+
+	printf("-------------------\n");
+	printf("Animation benchmark (%d iterations per run, %d bones)\n\n", iterations, mesh.GetBoneCount());
+
+	BoneTransforms(mesh, iterations, results);
+	BoneTransformsBlending(mesh, iterations, results);
+	KeyLookup(mesh, iterations, results);
+	HierarchyTraversal(mesh, iterations, results);
+
+	printf("%-20s %5s %5s %6s %6s %9s %12s %12s %12s\n", "test", "start", "end", "time", "blend", "instances", "mean [us]", "median [us]", "max [us]");
+
+	for (const auto& result : results)
+	{
+		printf("%-20s %5d %5d %6.2f %6.2f %9d %12.2f %12.2f %12.2f\n", result.mTest.c_str(), result.mStartAnimation, result.mEndAnimation,
+			result.mClipTime, result.mBlendFactor, result.mInstances, result.mMean, result.mMedian, result.mMax);
+	}
+
+	WriteJson(outputPath, mesh, iterations, results);
+
+	printf("\nResults written to %s\n", outputPath.c_str());
+}
+
+void AnimationBenchmark::BoneTransforms(MeshV2& mesh, const unsigned int& iterations, std::vector<AnimationBenchmarkResult>& results)
+{
+	std::vector<aiMatrix4x4> transforms;
+
+	unsigned int activeAnimation = mesh.mActiveAnimation;
+
+	for (unsigned int clip = 0; clip < mesh.mPScene->mNumAnimations; clip++)
+	{
+		// ReadNodeHeirarchy samples the channels of the active animation, so keep it in sync with the clip index
+		mesh.mActiveAnimation = clip;
+
+		for (const auto& clipTime : sClipTimes)
+		{
+			double seconds = ClipTimeInSeconds(*mesh.mPScene->mAnimations[clip], clipTime);
+
+			for (const auto& instances : sInstanceCounts)
+			{
+				AnimationBenchmarkResult result;
+				result.mTest = "GetBoneTransforms";
+				result.mStartAnimation = clip;
+				result.mClipTime = clipTime;
+				result.mInstances = instances;
+				result.mOperations = instances * mesh.GetBoneCount();
+
+				Measure(result, iterations, [&]()
+				{
+					for (unsigned int i = 0; i < instances; i++)
+					{
+						mesh.GetBoneTransforms(seconds, transforms, clip);
+						sSink = sSink + transforms[0].a4;
+					}
+				});
+
+				results.push_back(result);
+			}
+		}
+	}
+
+	mesh.mActiveAnimation = activeAnimation;
+}
+
+void AnimationBenchmark::BoneTransformsBlending(MeshV2& mesh, const unsigned int& iterations, std::vector<AnimationBenchmarkResult>& results)
+{
+	std::vector<aiMatrix4x4> transforms;
+
+	unsigned int startAnimation = 0;
+	unsigned int endAnimation = std::min(1u, mesh.mPScene->mNumAnimations - 1);
+
+	// both clips are sampled at the same time, so use the start clip for the time in seconds
+	for (const auto& clipTime : sClipTimes)
+	{
+		float seconds = (float)ClipTimeInSeconds(*mesh.mPScene->mAnimations[startAnimation], clipTime);
+
+		for (const auto& blendFactor : sBlendFactors)
+		{
+			for (const auto& instances : sInstanceCounts)
+			{
+				AnimationBenchmarkResult result;
+				result.mTest = "GetBoneTransoformsBlending";
+				result.mStartAnimation = startAnimation;
+				result.mEndAnimation = endAnimation;
+				result.mClipTime = clipTime;
+				result.mBlendFactor = blendFactor;
+				result.mInstances = instances;
+				result.mOperations = instances * mesh.GetBoneCount();
+
+				Measure(result, iterations, [&]()
+				{
+					for (unsigned int i = 0; i < instances; i++)
+					{
+						mesh.GetBoneTransoformsBlending(seconds, transforms, startAnimation, endAnimation, blendFactor);
+						sSink = sSink + transforms[0].a4;
+					}
+				});
+
+				results.push_back(result);
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Only the key searches (FindPosition/FindRotation/FindScaling) of every channel, without interpolation or matrix work
+/// </summary>
+///
+void AnimationBenchmark::KeyLookup(MeshV2& mesh, const unsigned int& iterations, std::vector<AnimationBenchmarkResult>& results)
+{
+	for (unsigned int clip = 0; clip < mesh.mPScene->mNumAnimations; clip++)
+	{
+		const aiAnimation& animation = *mesh.mPScene->mAnimations[clip];
+
+		for (const auto& clipTime : sClipTimes)
+		{
+			float animationTimeTicks = mesh.CalculateAnimationTimeTicks((float)ClipTimeInSeconds(animation, clipTime), clip);
+
+			AnimationBenchmarkResult result;
+			result.mTest = "KeyLookup";
+			result.mStartAnimation = clip;
+			result.mClipTime = clipTime;
+			result.mOperations = animation.mNumChannels * 3;
+
+			Measure(result, iterations, [&]()
+			{
+				unsigned int keys = 0;
+
+				for (unsigned int i = 0; i < animation.mNumChannels; i++)
+				{
+					const aiNodeAnim* pNodeAnim = animation.mChannels[i];
+
+					keys += mesh.FindPosition(animationTimeTicks, pNodeAnim);
+					keys += mesh.FindRotation(animationTimeTicks, pNodeAnim);
+					keys += mesh.FindScaling(animationTimeTicks, pNodeAnim);
+				}
+
+				sSink = sSink + (float)keys;
+			});
+
+			results.push_back(result);
+		}
+	}
+}
+
+/// <summary>
+/// Walks the node hierarchy like ReadNodeHeirarchy does (channel search, bone lookup, matrix concatenation), but uses the bind pose
+/// instead of interpolating keys. Together with KeyLookup this splits GetBoneTransforms into its two halves.
+/// </summary>
+///
+void AnimationBenchmark::HierarchyTraversal(MeshV2& mesh, const unsigned int& iterations, std::vector<AnimationBenchmarkResult>& results)
+{
+	aiMatrix4x4 identity;
+
+	for (unsigned int clip = 0; clip < mesh.mPScene->mNumAnimations; clip++)
+	{
+		const aiAnimation& animation = *mesh.mPScene->mAnimations[clip];
+
+		for (const auto& instances : sInstanceCounts)
+		{
+			AnimationBenchmarkResult result;
+			result.mTest = "HierarchyTraversal";
+			result.mStartAnimation = clip;
+			result.mInstances = instances;
+			result.mOperations = instances * TraverseHierarchy(mesh, animation, mesh.mPScene->mRootNode, identity);
+
+			Measure(result, iterations, [&]()
+			{
+				for (unsigned int i = 0; i < instances; i++)
+				{
+					TraverseHierarchy(mesh, animation, mesh.mPScene->mRootNode, identity);
+				}
+
+				sSink = sSink + mesh.mBoneInfo[0].mFinalTransformation.a4;
+			});
+
+			results.push_back(result);
+		}
+	}
+}
+
+unsigned int AnimationBenchmark::TraverseHierarchy(MeshV2& mesh, const aiAnimation& animation, const aiNode* pNode, const aiMatrix4x4& parentTransform)
+{
+	std::string nodeName(pNode->mName.C_Str());
+
+	const aiNodeAnim* pNodeAnim = mesh.FindNodeAnim(&animation, nodeName);
+
+	aiMatrix4x4 globalTransformation = parentTransform * pNode->mTransformation;
+
+	if (pNodeAnim != nullptr)
+		sSink = sSink + (float)pNodeAnim->mNumRotationKeys;
+
+	auto bone = mesh.mBoneNameToIndexMap.find(nodeName);
+
+	if (bone != mesh.mBoneNameToIndexMap.end())
+		mesh.mBoneInfo[bone->second].mFinalTransformation = mesh.mGlobalInverseTransform * globalTransformation * mesh.mBoneInfo[bone->second].mOffsetMatrix;
+
+	unsigned int nodes = 1;
+
+	for (unsigned int j = 0; j < pNode->mNumChildren; j++)
+	{
+		nodes += TraverseHierarchy(mesh, animation, pNode->mChildren[j], globalTransformation);
+	}
+
+	return nodes;
+}
+
+void AnimationBenchmark::Measure(AnimationBenchmarkResult& result, const unsigned int& iterations, const std::function<void()>& iteration)
+{
+	for (unsigned int i = 0; i < ANIMATION_BENCHMARK_WARMUP; i++)
+	{
+		iteration();
+	}
+
+	std::vector<double> times(iterations);
+
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		iteration();
+		auto end = std::chrono::steady_clock::now();
+
+		times[i] = std::chrono::duration<double, std::micro>(end - start).count();
+	}
+
+	if (times.empty())
+		return;
+
+	double sum = 0.0;
+	for (const auto& time : times)
+		sum += time;
+
+	result.mMean = sum / times.size();
+
+	double variance = 0.0;
+	for (const auto& time : times)
+		variance += (time - result.mMean) * (time - result.mMean);
+
+	result.mStdDev = std::sqrt(variance / times.size());
+
+	std::sort(times.begin(), times.end());
+
+	result.mMin = times.front();
+	result.mMax = times.back();
+	result.mMedian = times[times.size() / 2];
+}
+
+void AnimationBenchmark::WriteJson(const std::string& outputPath, const MeshV2& mesh, const unsigned int& iterations, const std::vector<AnimationBenchmarkResult>& results)
+{
+	std::ofstream file(outputPath);
+
+	if (!file.is_open())
+		Debug::ThrowException("AnimationBenchmark => couldn't open file '" + outputPath + "' for writing!");
+
+#ifdef _DEBUG
+	const char* build = "Debug";
+#else
+	const char* build = "Release";
+#endif
+
+#if defined(_MSC_VER)
+	std::string compiler = "MSVC " + STRING(_MSC_VER);
+#elif defined(__VERSION__)
+	std::string compiler = __VERSION__;
+#else
+	std::string compiler = "unknown";
+#endif
+
+	file << "{\n";
+	file << "\"model\":\"" << EscapeJson(mesh.GetFilePath()) << "\",\n";
+	file << "\"build\":\"" << build << "\",\n";
+	file << "\"compiler\":\"" << EscapeJson(compiler) << "\",\n";
+	file << "\"iterations\":" << iterations << ",\n";
+	file << "\"warmup\":" << ANIMATION_BENCHMARK_WARMUP << ",\n";
+	file << "\"bones\":" << mesh.GetBoneCount() << ",\n";
+	file << "\"nodes\":" << mesh.mRequiredNodeMap.size() << ",\n";
+
+	file << "\"animations\":[";
+	for (unsigned int i = 0; i < mesh.mPScene->mNumAnimations; i++)
+	{
+		const aiAnimation& animation = *mesh.mPScene->mAnimations[i];
+
+		file << (i == 0 ? "\n" : ",\n");
+		file << "{\"name\":\"" << EscapeJson(animation.mName.C_Str()) << "\",\"duration\":" << animation.mDuration
+			<< ",\"ticksPerSecond\":" << animation.mTicksPerSecond << ",\"channels\":" << animation.mNumChannels << "}";
+	}
+	file << "\n],\n";
+
+	file << "\"results\":[";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const AnimationBenchmarkResult& result = results[i];
+
+		file << (i == 0 ? "\n" : ",\n");
+		file << "{\"test\":\"" << result.mTest << "\",\"startAnimation\":" << result.mStartAnimation << ",\"endAnimation\":" << result.mEndAnimation
+			<< ",\"clipTime\":" << result.mClipTime << ",\"blendFactor\":" << result.mBlendFactor << ",\"instances\":" << result.mInstances
+			<< ",\"operations\":" << result.mOperations << ",\"meanUs\":" << result.mMean << ",\"medianUs\":" << result.mMedian
+			<< ",\"minUs\":" << result.mMin << ",\"maxUs\":" << result.mMax << ",\"stdDevUs\":" << result.mStdDev
+			<< ",\"nsPerOperation\":" << (result.mOperations != 0 ? result.mMean * 1000.0 / result.mOperations : 0.0) << "}";
+	}
+	file << "\n],\n";
+
+	file << "\"checksum\":" << sSink << "\n";
+	file << "}\n";
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "MeshV2.h"
+
+#define ANIMATION_BENCHMARK_ITERATIONS 200
+#define ANIMATION_BENCHMARK_WARMUP 10
+
+// One measured configuration; times are per iteration (all instances), in microseconds
+struct AnimationBenchmarkResult
+{
+	std::string mTest;
+	int mStartAnimation = -1;
+	int mEndAnimation = -1;
+	float mClipTime = 0.0f; // fraction of the clip duration
+	float mBlendFactor = 0.0f;
+	unsigned int mInstances = 1;
+	unsigned int mOperations = 0; // evaluated bones/lookups/nodes per iteration
+
+	double mMean = 0.0;
+	double mMedian = 0.0;
+	double mMin = 0.0;
+	double mMax = 0.0;
+	double mStdDev = 0.0;
+};
+
+// Times the CPU side of skeletal animation on a headless MeshV2 (no window or GL context)
+class AnimationBenchmark
+{
+public:
+
+	static void Run(const std::string& modelPath, const std::string& outputPath, const unsigned int& iterations = ANIMATION_BENCHMARK_ITERATIONS);
+
+private:
+
+	static void BoneTransforms(MeshV2& mesh, const unsigned int& iterations, std::vector<AnimationBenchmarkResult>& results);
+	static void BoneTransformsBlending(MeshV2& mesh, const unsigned int& iterations, std::vector<AnimationBenchmarkResult>& results);
+	static void KeyLookup(MeshV2& mesh, const unsigned int& iterations, std::vector<AnimationBenchmarkResult>& results);
+	static void HierarchyTraversal(MeshV2& mesh, const unsigned int& iterations, std::vector<AnimationBenchmarkResult>& results);
+
+	static unsigned int TraverseHierarchy(MeshV2& mesh, const aiAnimation& animation, const aiNode* pNode, const aiMatrix4x4& parentTransform);
+
+	static void Measure(AnimationBenchmarkResult& result, const unsigned int& iterations, const std::function<void()>& iteration);
+
+	static void WriteJson(const std::string& outputPath, const MeshV2& mesh, const unsigned int& iterations, const std::vector<AnimationBenchmarkResult>& results);
+
+};
@@ -0,0 +1,19 @@
+#include <string>
+
+#include "AnimationBenchmark.h"
+
+// Entry point of the AnimationBenchmark target; no window or GL context is created.
+// usage: AnimationBenchmark [model path] [output json path] [iterations]
+int main(int argc, char* argv[])
+{
+	std::string ExePath = argv[0];
+	ExePath = ExePath.substr(0, ExePath.find_last_of('\\'));
+
+	std::string modelPath = argc > 1 ? argv[1] : ExePath + "\\Models\\Character.fbx";
+	std::string outputPath = argc > 2 ? argv[2] : ExePath + "\\animation_benchmark.json";
+	unsigned int iterations = argc > 3 ? std::stoul(argv[3]) : ANIMATION_BENCHMARK_ITERATIONS;
+
+	AnimationBenchmark::Run(modelPath, outputPath, iterations);
+
+	return 0;
+}
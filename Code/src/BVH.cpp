@@ -0,0 +1,444 @@
+#include "BVH.h"
+
+#include <algorithm>
+
+#include "Debug.h"
+
+BVH::BVH()
+{
+}
+
+/// <summary>
+/// 
+/// </summary>
+/// <param name="box">World space bounds of the object</param>
+/// <param name="userData">Returned by queries when the object passes</param>
+/// <returns>Leaf index; used for Refit/Remove</returns>
+/// 
+int BVH::Insert(const AABB& box, void* userData)
+{
+	int leaf = AllocateNode();
+
+	glm::vec3 margin = box.GetExtents() * BVH_FAT_MARGIN;
+	mNodes[leaf].mBox = AABB(box.mMin - margin, box.mMax + margin);
+	mNodes[leaf].mUserData = userData;
+
+	InsertLeaf(leaf);
+	mLeafCount++;
+
+	return leaf;
+}
+
+void BVH::Remove(const int& leaf)
+{
+	if (leaf < 0 || leaf >= (int)mNodes.size() || !mNodes[leaf].IsLeaf())
+		Debug::ThrowException("BVH => invalid leaf index! (" + STRING(leaf) + ")");
+
+	RemoveLeaf(leaf);
+	FreeNode(leaf);
+	mLeafCount--;
+}
+
+/// <summary>
+/// Updates the bounds of a moved object and refits every ancestor
+/// </summary>
+/// 
+void BVH::Refit(const int& leaf, const AABB& box)
+{
+	if (leaf < 0 || leaf >= (int)mNodes.size() || !mNodes[leaf].IsLeaf())
+		Debug::ThrowException("BVH => invalid leaf index! (" + STRING(leaf) + ")");
+
+	// small moves stay inside the fattened box and need no tree update at all
+	if (mNodes[leaf].mBox.Contains(box))
+		return;
+
+	RemoveLeaf(leaf);
+
+	glm::vec3 margin = box.GetExtents() * BVH_FAT_MARGIN;
+	mNodes[leaf].mBox = AABB(box.mMin - margin, box.mMax + margin);
+
+	InsertLeaf(leaf);
+}
+
+/// <summary>
+/// Top-down build (median split along the longest axis of the box centers). Inserting objects one by one in spatial order,
+/// e.g. the segments of a curve, degenerates the tree into a list; this gives a balanced tree which can still be
+/// refitted and modified afterwards.
+/// </summary>
+/// <param name="leaves">Output, leaf index of every box (same order as boxes)</param>
+/// 
+void BVH::Build(const std::vector<AABB>& boxes, const std::vector<void*>& userData, std::vector<int>& leaves)
+{
+	if (boxes.size() != userData.size())
+		Debug::ThrowException("BVH => box and user data count differ! (" + STRING(boxes.size()) + " != " + STRING(userData.size()) + ")");
+
+	mNodes.clear();
+	mNodes.reserve(boxes.size() * 2);
+	mRoot = BVH_NULL_NODE;
+	mFreeList = BVH_NULL_NODE;
+	mLeafCount = boxes.size();
+
+	leaves.resize(boxes.size());
+
+	for (unsigned int i = 0; i < boxes.size(); i++)
+	{
+		int leaf = AllocateNode();
+
+		glm::vec3 margin = boxes[i].GetExtents() * BVH_FAT_MARGIN;
+		mNodes[leaf].mBox = AABB(boxes[i].mMin - margin, boxes[i].mMax + margin);
+		mNodes[leaf].mUserData = userData[i];
+
+		leaves[i] = leaf;
+	}
+
+	if (boxes.empty())
+		return;
+
+	std::vector<int> order = leaves;
+	mRoot = BuildRange(order, 0, order.size(), BVH_NULL_NODE);
+}
+
+void BVH::QueryFrustum(const Frustum& frustum, std::vector<void*>& output, CullStats& stats) const
+{
+	output.clear();
+
+	stats.mTested += mLeafCount;
+
+	if (mRoot == BVH_NULL_NODE)
+		return;
+
+	mStack.clear();
+	mStack.push_back(mRoot);
+
+	while (!mStack.empty())
+	{
+		int index = mStack.back();
+		mStack.pop_back();
+
+		const BVHNode& node = mNodes[index];
+
+		stats.mNodeTests++;
+		FrustumTestResult result = frustum.TestAABB(node.mBox);
+
+		if (result == FRUSTUM_OUTSIDE)
+			continue;
+
+		if (result == FRUSTUM_INSIDE)
+		{
+			// whole subtree visible, no more plane tests needed
+			CollectLeaves(index, output);
+			continue;
+		}
+
+		if (node.IsLeaf())
+		{
+			output.push_back(node.mUserData);
+		}
+		else
+		{
+			mStack.push_back(node.mLeft);
+			mStack.push_back(node.mRight);
+		}
+	}
+
+	stats.mCulled += mLeafCount - output.size();
+}
+
+/// <summary>
+/// Finds the object closest to the point; subtrees are visited nearest box first and skipped once their box
+/// is farther than the best object found so far
+/// </summary>
+/// <param name="leafDistance">Squared distance of the object of a leaf to the point (may return anything larger than bestDistanceSquared if it is farther)</param>
+/// <returns>Smallest squared distance returned by leafDistance (maxDistanceSquared if no leaf was closer)</returns>
+/// 
+float BVH::QueryClosest(const glm::vec3& point, const std::function<float(void* userData, const float& bestDistanceSquared)>& leafDistance,
+	const float& maxDistanceSquared) const
+{
+	float best = maxDistanceSquared;
+
+	if (mRoot == BVH_NULL_NODE)
+		return best;
+
+	// per thread, mStack belongs to QueryFrustum
+	thread_local std::vector<int> stack;
+	stack.clear();
+	stack.push_back(mRoot);
+
+	while (!stack.empty())
+	{
+		const BVHNode& node = mNodes[stack.back()];
+		stack.pop_back();
+
+		if (node.mBox.DistanceSquared(point) >= best)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			best = glm::min(best, leafDistance(node.mUserData, best));
+			continue;
+		}
+
+		float leftDistance = mNodes[node.mLeft].mBox.DistanceSquared(point);
+		float rightDistance = mNodes[node.mRight].mBox.DistanceSquared(point);
+
+		// the nearer child is popped first
+		if (leftDistance < rightDistance)
+		{
+			stack.push_back(node.mRight);
+			stack.push_back(node.mLeft);
+		}
+		else
+		{
+			stack.push_back(node.mLeft);
+			stack.push_back(node.mRight);
+		}
+	}
+
+	return best;
+}
+
+/// <summary>
+/// Passes every leaf whose box (grown by margin) the ray enters before the current bound to leafHit
+/// </summary>
+/// <param name="leafHit">Distance along the ray at which the object of the leaf is hit, or maxDistance if it isn't</param>
+/// <returns>Closest hit distance (maxDistance if nothing was hit)</returns>
+/// 
+float BVH::QueryRay(const glm::vec3& origin, const glm::vec3& direction, const float& maxDistance, const float& margin,
+	const std::function<float(void* userData, const float& maxDistance)>& leafHit) const
+{
+	float best = maxDistance;
+
+	if (mRoot == BVH_NULL_NODE)
+		return best;
+
+	glm::vec3 inverseDirection = 1.0f / direction;
+
+	thread_local std::vector<int> stack;
+	stack.clear();
+	stack.push_back(mRoot);
+
+	float tEnter;
+
+	while (!stack.empty())
+	{
+		const BVHNode& node = mNodes[stack.back()];
+		stack.pop_back();
+
+		if (!node.mBox.IntersectRay(origin, inverseDirection, best, margin, tEnter))
+			continue;
+
+		if (node.IsLeaf())
+			best = glm::min(best, leafHit(node.mUserData, best));
+		else
+		{
+			stack.push_back(node.mLeft);
+			stack.push_back(node.mRight);
+		}
+	}
+
+	return best;
+}
+
+const AABB& BVH::GetBox(const int& leaf) const
+{
+	return mNodes[leaf].mBox;
+}
+
+unsigned int BVH::GetLeafCount() const
+{
+	return mLeafCount;
+}
+
+int BVH::AllocateNode()
+{
+	if (mFreeList == BVH_NULL_NODE)
+	{
+		mNodes.emplace_back();
+		return mNodes.size() - 1;
+	}
+
+	int node = mFreeList;
+	mFreeList = mNodes[node].mParent;
+	mNodes[node] = BVHNode();
+
+	return node;
+}
+
+void BVH::FreeNode(const int& node)
+{
+	mNodes[node] = BVHNode();
+	mNodes[node].mParent = mFreeList;
+	mFreeList = node;
+}
+
+void BVH::InsertLeaf(const int& leaf)
+{
+	if (mRoot == BVH_NULL_NODE)
+	{
+		mRoot = leaf;
+		mNodes[leaf].mParent = BVH_NULL_NODE;
+		return;
+	}
+
+	const AABB leafBox = mNodes[leaf].mBox;
+
+	// find the best sibling (surface area heuristic, same as Box2D's dynamic tree)
+	int index = mRoot;
+	while (!mNodes[index].IsLeaf())
+	{
+		const BVHNode& node = mNodes[index];
+
+		float area = node.mBox.SurfaceArea();
+		float combinedArea = AABB::Merge(node.mBox, leafBox).SurfaceArea();
+
+		// cost of creating a new parent for this node and the new leaf
+		float cost = 2.0f * combinedArea;
+
+		// minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		auto descendCost = [&](const int& child)
+		{
+			const BVHNode& c = mNodes[child];
+			float mergedArea = AABB::Merge(c.mBox, leafBox).SurfaceArea();
+
+			return c.IsLeaf() ? mergedArea + inheritanceCost : (mergedArea - c.mBox.SurfaceArea()) + inheritanceCost;
+		};
+
+		float costLeft = descendCost(node.mLeft);
+		float costRight = descendCost(node.mRight);
+
+		if (cost < costLeft && cost < costRight)
+			break;
+
+		index = (costLeft < costRight) ? node.mLeft : node.mRight;
+	}
+
+	int sibling = index;
+	int oldParent = mNodes[sibling].mParent;
+	int newParent = AllocateNode(); // may reallocate mNodes, so no references are kept across this call
+
+	mNodes[newParent].mParent = oldParent;
+	mNodes[newParent].mBox = AABB::Merge(leafBox, mNodes[sibling].mBox);
+	mNodes[newParent].mLeft = sibling;
+	mNodes[newParent].mRight = leaf;
+	mNodes[sibling].mParent = newParent;
+	mNodes[leaf].mParent = newParent;
+
+	if (oldParent == BVH_NULL_NODE)
+	{
+		mRoot = newParent;
+	}
+	else
+	{
+		if (mNodes[oldParent].mLeft == sibling)
+			mNodes[oldParent].mLeft = newParent;
+		else
+			mNodes[oldParent].mRight = newParent;
+	}
+
+	RefitAncestors(oldParent);
+}
+
+void BVH::RemoveLeaf(const int& leaf)
+{
+	if (leaf == mRoot)
+	{
+		mRoot = BVH_NULL_NODE;
+		return;
+	}
+
+	int parent = mNodes[leaf].mParent;
+	int grandParent = mNodes[parent].mParent;
+	int sibling = (mNodes[parent].mLeft == leaf) ? mNodes[parent].mRight : mNodes[parent].mLeft;
+
+	if (grandParent == BVH_NULL_NODE)
+	{
+		mRoot = sibling;
+		mNodes[sibling].mParent = BVH_NULL_NODE;
+	}
+	else
+	{
+		if (mNodes[grandParent].mLeft == parent)
+			mNodes[grandParent].mLeft = sibling;
+		else
+			mNodes[grandParent].mRight = sibling;
+
+		mNodes[sibling].mParent = grandParent;
+	}
+
+	FreeNode(parent);
+	RefitAncestors(grandParent);
+}
+
+void BVH::RefitAncestors(int node)
+{
+	while (node != BVH_NULL_NODE)
+	{
+		BVHNode& n = mNodes[node];
+		n.mBox = AABB::Merge(mNodes[n.mLeft].mBox, mNodes[n.mRight].mBox);
+
+		node = n.mParent;
+	}
+}
+
+int BVH::BuildRange(std::vector<int>& leaves, const unsigned int& first, const unsigned int& last, const int& parent)
+{
+	if (last - first == 1)
+	{
+		mNodes[leaves[first]].mParent = parent;
+		return leaves[first];
+	}
+
+	AABB centers;
+
+	for (unsigned int i = first; i < last; i++)
+	{
+		centers.Expand(mNodes[leaves[i]].mBox.GetCenter());
+	}
+
+	glm::vec3 size = centers.mMax - centers.mMin;
+	int axis = (size.x > size.y && size.x > size.z) ? 0 : (size.y > size.z ? 1 : 2);
+
+	unsigned int middle = (first + last) / 2;
+	std::nth_element(leaves.begin() + first, leaves.begin() + middle, leaves.begin() + last, [&](const int& a, const int& b)
+	{
+		return mNodes[a].mBox.GetCenter()[axis] < mNodes[b].mBox.GetCenter()[axis];
+	});
+
+	int node = AllocateNode();
+	mNodes[node].mParent = parent;
+
+	int left = BuildRange(leaves, first, middle, node);
+	int right = BuildRange(leaves, middle, last, node);
+
+	mNodes[node].mLeft = left;
+	mNodes[node].mRight = right;
+	mNodes[node].mBox = AABB::Merge(mNodes[left].mBox, mNodes[right].mBox);
+
+	return node;
+}
+
+void BVH::CollectLeaves(const int& node, std::vector<void*>& output) const
+{
+	// separate stack, mStack is still in use by QueryFrustum
+	std::vector<int>& stack = mCollectStack;
+	stack.clear();
+	stack.push_back(node);
+
+	while (!stack.empty())
+	{
+		const BVHNode& n = mNodes[stack.back()];
+		stack.pop_back();
+
+		if (n.IsLeaf())
+		{
+			output.push_back(n.mUserData);
+		}
+		else
+		{
+			stack.push_back(n.mLeft);
+			stack.push_back(n.mRight);
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "BoundingBox.h"
+#include "Frustum.h"
+
+#define BVH_NULL_NODE -1
+#define BVH_FAT_MARGIN 0.1f // leaf boxes are enlarged by this fraction of their extents
+
+struct BVHNode
+{
+	AABB mBox;
+	int mParent = BVH_NULL_NODE; // next free node while the node is in the free list
+	int mLeft = BVH_NULL_NODE;
+	int mRight = BVH_NULL_NODE;
+	void* mUserData = nullptr;
+
+	bool IsLeaf() const
+	{
+		return mLeft == BVH_NULL_NODE;
+	}
+};
+
+struct CullStats
+{
+	unsigned int mTested = 0; // objects that went through culling
+	unsigned int mCulled = 0; // objects rejected by the frustum
+	unsigned int mOccluded = 0; // objects inside the frustum but hidden behind occluders
+	unsigned int mDrawn = 0; // objects submitted for drawing
+	unsigned int mNodeTests = 0; // frustum/box tests actually executed (inner nodes included)
+};
+
+// Dynamic AABB tree; leaves are inserted with a surface area heuristic and only reinserted once an object leaves its fattened box
+class BVH
+{
+public:
+
+	BVH();
+
+	int Insert(const AABB& box, void* userData);
+	void Remove(const int& leaf);
+	void Refit(const int& leaf, const AABB& box);
+	void Build(const std::vector<AABB>& boxes, const std::vector<void*>& userData, std::vector<int>& leaves); // replaces the whole tree
+
+	void QueryFrustum(const Frustum& frustum, std::vector<void*>& output, CullStats& stats) const;
+
+	// Both queries are safe to run from several threads at once (as long as the tree isn't modified)
+	float QueryClosest(const glm::vec3& point, const std::function<float(void* userData, const float& bestDistanceSquared)>& leafDistance,
+		const float& maxDistanceSquared = std::numeric_limits<float>::max()) const;
+	float QueryRay(const glm::vec3& origin, const glm::vec3& direction, const float& maxDistance, const float& margin,
+		const std::function<float(void* userData, const float& maxDistance)>& leafHit) const;
+
+	const AABB& GetBox(const int& leaf) const;
+	unsigned int GetLeafCount() const;
+
+private:
+
+	int AllocateNode();
+	void FreeNode(const int& node);
+
+	void InsertLeaf(const int& leaf);
+	void RemoveLeaf(const int& leaf);
+	void RefitAncestors(int node);
+	int BuildRange(std::vector<int>& leaves, const unsigned int& first, const unsigned int& last, const int& parent);
+
+	void CollectLeaves(const int& node, std::vector<void*>& output) const;
+
+	std::vector<BVHNode> mNodes;
+	int mRoot = BVH_NULL_NODE;
+	int mFreeList = BVH_NULL_NODE;
+	unsigned int mLeafCount = 0;
+
+	mutable std::vector<int> mStack;
+	mutable std::vector<int> mCollectStack;
+
+};
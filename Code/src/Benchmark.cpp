@@ -0,0 +1,839 @@
+#include "Benchmark.h"
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <charconv>
+#include <deque>
+#include <thread>
+
+#include "Debug.h"
+#include "TimeControl.h"
+#include "InstanceGroup.h"
+#include "BVH.h"
+#include "Frustum.h"
+#include "Spline.h"
+#include "SplineFollowers.h"
+#include "Parser.h"
+#include "BinaryPointFile.h"
+#include "ThreadPool.h"
+#include "Objekt.h"
+#include "Renderer.h"
+
+#define BENCHMARK_FRAME_COUNT 100
+
+// Scene object of the renderer benchmark; has its own transform, but draws the geometry of a shared Objekt
+class SharedMeshObject : public Drawable
+{
+public:
+
+	SharedMeshObject(Objekt& source, const glm::mat4& matrix)
+		:
+		mSource(source),
+		mTransform(matrix)
+	{
+	}
+
+	const bool& IsActive() const { return mActive; }
+	void SetActive(const bool& value) { mActive = value; }
+	void Draw() { mSource.Draw(); }
+
+	Transform& GetTransform() { return mTransform; }
+	AABB GetLocalBounds() const { return mSource.GetLocalBounds(); }
+	unsigned int GetMaterialID() const { return mSource.GetMaterialID(); }
+
+private:
+
+	Objekt& mSource;
+	Transform mTransform;
+	bool mActive = true;
+
+};
+
+/// <summary>
+/// Compares one draw call per instance (what N Objekt instances do) against a single instanced draw call
+/// </summary>
+/// <param name="window">Window whose context is current</param>
+/// <param name="mesh">Mesh which is drawn; its vertex and index data are shared by every instance</param>
+/// <param name="shader">Shader used for the separate draw calls (general.glsl)</param>
+/// <param name="instancedShader">Shader used for the instanced draw call (instanced.glsl)</param>
+/// 
+void Benchmark::InstancedDraws(GLFWwindow* window, MeshV2& mesh, Shader& shader, Shader& instancedShader)
+{
+	const unsigned int instanceCounts[] = { 1, 100, 10000 };
+
+	glfwSwapInterval(0);
+
+	std::vector<aiMatrix4x4> boneTransforms;
+	mesh.GetBoneTransforms(0.0, boneTransforms, 0);
+
+	mesh.UploadBoneTransforms(boneTransforms);
+
+	const glm::vec3 lightColor = { 0.9f, 0.95f, 1.0f };
+	shader.SetUniform(shader.GetUniformHandle<glm::vec3>("uLightColor"), lightColor);
+	instancedShader.SetUniform(instancedShader.GetUniformHandle<glm::vec3>("uLightColor"), lightColor);
+
+	UniformBlock<CameraBlock> cameraBlock(CAMERA_BLOCK_BINDING);
+	UniformBlock<ObjectBlock> objectBlock(OBJECT_BLOCK_BINDING);
+
+	InstanceGroup group(mesh);
+	unsigned int boneOffset = group.AddBonePalette(boneTransforms);
+
+	std::vector<glm::mat4> models;
+
+	printf("-------------------\n");
+	printf("Instancing benchmark (%d frames per run)\n\n", BENCHMARK_FRAME_COUNT);
+
+	for (const auto& instanceCount : instanceCounts)
+	{
+		FillGrid(instanceCount, mesh.GetTransform().GetMatrix(), models);
+
+		float gridSize = std::ceil(std::sqrt((float)instanceCount)) * 2.5f;
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f, gridSize * 0.5f, gridSize), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(45.0f, 1.0f, 0.1f, gridSize * 4.0f);
+
+		SetCamera(cameraBlock, view, projection);
+
+		group.ClearInstances();
+		for (const auto& model : models)
+		{
+			group.AddInstance(model, boneOffset);
+		}
+
+		// one draw call and one object block update per instance, same as Renderer::Draw does for Objekt
+		double separateTime = MeasureFrames(window, BENCHMARK_FRAME_COUNT, [&]()
+		{
+			shader.Bind();
+			objectBlock.Bind();
+			mesh.GetVAO().Bind();
+			mesh.GetVB().Bind<VertexV2>(0);
+			mesh.GetIB().Bind();
+
+			for (const auto& model : models)
+			{
+				objectBlock.Data().mModel = model;
+				objectBlock.Data().mNormalMatrix = glm::transpose(glm::inverse(model));
+				objectBlock.Upload();
+
+				glDrawElements(mesh.GetVAO().GetDrawingMode(), mesh.GetIB().GetIndicesCount(), GL_UNSIGNED_INT, 0);
+			}
+		});
+
+		double instancedTime = MeasureFrames(window, BENCHMARK_FRAME_COUNT, [&]()
+		{
+			group.Draw(instancedShader);
+		});
+
+		double drawnInstances = (double)instanceCount * BENCHMARK_FRAME_COUNT;
+
+		printf("%6u instances:\tseparate %12.0f instances/s (%8.3f ms/frame)\tinstanced %12.0f instances/s (%8.3f ms/frame)\n",
+			instanceCount,
+			drawnInstances / separateTime, separateTime * 1000.0 / BENCHMARK_FRAME_COUNT,
+			drawnInstances / instancedTime, instancedTime * 1000.0 / BENCHMARK_FRAME_COUNT);
+	}
+
+	printf("-------------------\n");
+}
+
+/// <summary>
+/// Draws a grid of objects through Renderer::Draw with a growing number of draw list threads
+/// </summary>
+/// <param name="window">Window whose context is current</param>
+/// <param name="object">Object whose mesh every grid cell draws</param>
+/// <param name="shader">Shader the renderer binds before submitting</param>
+/// <param name="objectCount">Objects in the scene</param>
+/// 
+void Benchmark::RendererDraw(GLFWwindow* window, Objekt& object, Shader& shader, const unsigned int& objectCount)
+{
+	glfwSwapInterval(0);
+
+	std::vector<glm::mat4> models;
+	FillGrid(objectCount, object.GetTransform().GetMatrix(), models);
+
+	std::deque<SharedMeshObject> objects;
+	for (const auto& model : models)
+	{
+		objects.emplace_back(object, model);
+	}
+
+	float gridSize = std::ceil(std::sqrt((float)objectCount)) * 2.5f;
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, gridSize * 0.5f, gridSize), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(45.0f, 1.0f, 0.1f, gridSize * 4.0f);
+
+	UniformBlock<CameraBlock> cameraBlock(CAMERA_BLOCK_BINDING);
+	SetCamera(cameraBlock, view, projection);
+
+	// the thread calling Draw builds a draw list as well, so a pool with N workers uses N + 1 threads
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	unsigned int maxWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+
+	std::vector<unsigned int> workerCounts;
+	for (unsigned int workers = 1; workers < maxWorkers; workers *= 2)
+	{
+		workerCounts.push_back(workers);
+	}
+	workerCounts.push_back(maxWorkers);
+
+	printf("-------------------\n");
+	printf("Renderer benchmark (%u objects, %d frames per run)\n\n", objectCount, BENCHMARK_FRAME_COUNT);
+
+	for (const auto& workers : workerCounts)
+	{
+		ThreadPool pool(workers);
+		Renderer renderer(shader, &pool);
+
+		for (auto& sceneObject : objects)
+		{
+			renderer.AddDrawableObject(sceneObject);
+		}
+
+		renderer.SetViewProjection(projection * view);
+
+		// time spent inside Draw (draw list building and GL submission) separate from the whole frame, which includes the GPU
+		double drawTime = 0.0;
+		unsigned int drawCount = 0;
+		TimeControl drawTimer;
+
+		double frameTime = MeasureFrames(window, BENCHMARK_FRAME_COUNT, [&]()
+		{
+			drawTimer.Start();
+			renderer.Draw();
+			drawTime += drawTimer.End();
+			drawCount++;
+		});
+
+		printf("%2u threads:\tDraw %8.3f ms/frame\tframe %8.3f ms/frame\t(%u drawn)\n",
+			workers + 1,
+			drawTime * 1000.0 / drawCount,
+			frameTime * 1000.0 / BENCHMARK_FRAME_COUNT,
+			renderer.GetStats().mDrawn);
+	}
+
+	printf("-------------------\n");
+}
+
+double Benchmark::MeasureFrames(GLFWwindow* window, const unsigned int& frameCount, const std::function<void()>& drawFrame)
+{
+	// warm-up frame so buffer uploads are not part of the measurement
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	drawFrame();
+	glFinish();
+
+	TimeControl timer;
+	timer.Start();
+
+	for (unsigned int i = 0; i < frameCount; i++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		drawFrame();
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+	}
+
+	glFinish();
+
+	return timer.End();
+}
+
+// Quad facing +z; occluders are rasterized with back face culling
+void Benchmark::AddWall(OcclusionCuller& culler, const glm::vec3& center, const glm::vec2& size)
+{
+	glm::vec3 halfX{ size.x * 0.5f, 0.0f, 0.0f };
+	glm::vec3 halfY{ 0.0f, size.y * 0.5f, 0.0f };
+
+	std::vector<glm::vec3> vertices = { center - halfX - halfY, center + halfX - halfY, center + halfX + halfY, center - halfX + halfY };
+	std::vector<unsigned int> indices = { 0, 1, 2, 0, 2, 3 };
+
+	culler.AddOccluder(vertices, indices);
+}
+
+void Benchmark::FillGrid(const unsigned int& instanceCount, const glm::mat4& meshTransform, std::vector<glm::mat4>& output)
+{
+	output.clear();
+	output.reserve(instanceCount);
+
+	unsigned int side = (unsigned int)std::ceil(std::sqrt((float)instanceCount));
+	float halfSize = (side - 1) * 2.5f * 0.5f;
+
+	for (unsigned int i = 0; i < instanceCount; i++)
+	{
+		glm::vec3 position{ (i % side) * 2.5f - halfSize, 0.0f, (i / side) * -2.5f + halfSize };
+		output.push_back(glm::translate(glm::mat4(1.0f), position) * meshTransform);
+	}
+}
+
+/// <summary>
+/// Culls a grid of boxes inside a walled interior without a GL context and reports how many draws survive each stage
+/// </summary>
+/// <param name="depthDumpPath">PGM file the occlusion depth buffer is written to</param>
+/// 
+void Benchmark::OcclusionCulling(const std::string& depthDumpPath)
+{
+	const unsigned int gridSide = 64;
+	const float spacing = 2.0f;
+
+	OcclusionCuller culler;
+
+	// partition walls with doorways, similar to the rooms of an interior level
+	for (unsigned int wall = 1; wall <= 4; wall++)
+	{
+		float z = wall * -25.0f;
+		float doorway = (wall % 2) ? -10.0f : 12.0f;
+
+		AddWall(culler, { doorway - 35.0f, 5.0f, z }, { 66.0f, 14.0f });
+		AddWall(culler, { doorway + 35.0f, 5.0f, z }, { 66.0f, 14.0f });
+	}
+
+	BVH bvh;
+	std::vector<AABB> boxes;
+	boxes.reserve(gridSide * gridSide);
+
+	for (unsigned int i = 0; i < gridSide * gridSide; i++)
+	{
+		glm::vec3 position{ (i % gridSide) * spacing - gridSide * spacing * 0.5f, 0.0f, (i / gridSide) * -spacing - 2.0f };
+		boxes.push_back({ position - glm::vec3(0.5f), position + glm::vec3(0.5f) });
+	}
+
+	for (auto& box : boxes)
+	{
+		bvh.Insert(box, &box);
+	}
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 1.7f, 0.0f), glm::vec3(0.0f, 1.7f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 viewProjection = glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, 500.0f) * view;
+
+	Frustum frustum(viewProjection);
+	std::vector<void*> visible;
+	CullStats stats;
+
+	TimeControl timer;
+	timer.Start();
+
+	for (unsigned int frame = 0; frame < BENCHMARK_FRAME_COUNT; frame++)
+	{
+		stats = CullStats();
+
+		bvh.QueryFrustum(frustum, visible, stats);
+		culler.Render(viewProjection);
+
+		for (const auto& box : visible)
+		{
+			if (!culler.IsVisible(*static_cast<AABB*>(box)))
+				stats.mOccluded++;
+		}
+	}
+
+	double time = timer.End();
+
+	stats.mDrawn = stats.mTested - stats.mCulled - stats.mOccluded;
+
+	printf("-------------------\n");
+	printf("Occlusion culling benchmark (%ux%u depth buffer, %u occluder triangles, %u threads)\n\n", culler.GetWidth(), culler.GetHeight(), culler.GetTriangleCount(), ThreadPool::GetShared().GetThreadCount() + 1);
+	printf("objects: %u\tfrustum culled: %u\toccluded: %u (%.1f%% of the frustum visible ones)\tdrawn: %u\n",
+		stats.mTested, stats.mCulled, stats.mOccluded, 100.0 * stats.mOccluded / std::max(1u, stats.mTested - stats.mCulled), stats.mDrawn);
+	printf("%.3f ms/frame (frustum query, occluder rasterization and occlusion tests)\n", time * 1000.0 / BENCHMARK_FRAME_COUNT);
+	printf("-------------------\n");
+
+	culler.DumpDepth(depthDumpPath);
+}
+
+/// <summary>
+/// Closest point and ray queries against a long spline: brute force over every segment (on a subset of the queries)
+/// against the segment BVH, serial and batched on the thread pool
+/// </summary>
+/// <param name="queryCount">Number of query points (and rays)</param>
+/// 
+void Benchmark::SplineQueries(const unsigned int& queryCount)
+{
+	const unsigned int controlPointCount = 20000;
+	const unsigned int bruteForceCount = std::max(1u, queryCount / 100);
+	const float rayRadius = 0.5f;
+
+	// random walk with a slight drift, so the curve folds back on itself a bit but spreads over a large volume
+	std::vector<glm::vec3> controlPoints(controlPointCount);
+	glm::vec3 point(0.0f);
+	srand(7);
+
+	for (auto& controlPoint : controlPoints)
+	{
+		point += glm::vec3(rand() / (float)RAND_MAX - 0.45f, rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f) * 4.0f;
+		controlPoint = point;
+	}
+
+	// GPU evaluation, the queries only need the segments
+	CubicBSpline spline(controlPoints, 0, 0.0f, SPLINE_EVALUATION_GPU);
+	AABB bounds = spline.GetLocalBounds();
+
+	std::vector<glm::vec3> points(queryCount);
+	std::vector<glm::vec3> directions(queryCount);
+
+	for (unsigned int i = 0; i < queryCount; i++)
+	{
+		glm::vec3 random(rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, rand() / (float)RAND_MAX);
+		points[i] = bounds.mMin + random * (bounds.mMax - bounds.mMin);
+
+		// rays aimed near a random control point, so most of them hit
+		directions[i] = controlPoints[rand() % controlPointCount] + glm::vec3(0.5f) - points[i];
+	}
+
+	std::vector<SplineQueryResult> results(queryCount);
+	TimeControl timer;
+
+	// brute force: every segment of the curve
+	std::vector<float> bruteForce(bruteForceCount);
+	timer.Start();
+
+	for (unsigned int i = 0; i < bruteForceCount; i++)
+	{
+		bruteForce[i] = spline.FindClosestPointBruteForce(points[i]).mDistance;
+	}
+
+	double bruteForceTime = timer.End();
+
+	timer.Start();
+
+	for (unsigned int i = 0; i < queryCount; i++)
+	{
+		results[i] = spline.FindClosestPoint(points[i]);
+	}
+
+	double serialTime = timer.End();
+
+	float maxError = 0.0f;
+
+	for (unsigned int i = 0; i < bruteForceCount; i++)
+	{
+		maxError = std::max(maxError, std::abs(results[i].mDistance - bruteForce[i]));
+	}
+
+	timer.Start();
+	spline.FindClosestPoints(points.data(), queryCount, results.data());
+	double parallelTime = timer.End();
+
+	timer.Start();
+	spline.Raycast(points.data(), directions.data(), queryCount, rayRadius, results.data());
+	double rayTime = timer.End();
+
+	unsigned int hits = 0;
+
+	for (const auto& result : results)
+	{
+		hits += result.mValid;
+	}
+
+	printf("-------------------\n");
+	printf("Spline query benchmark (%u segments, %u queries, %u threads)\n\n", spline.GetSegmentCount(), queryCount, ThreadPool::GetShared().GetThreadCount() + 1);
+	printf("closest point, brute force:\t%.0f queries/s (%u queries)\n", bruteForceCount / bruteForceTime, bruteForceCount);
+	printf("closest point, BVH:\t\t%.0f queries/s (max difference to brute force %g)\n", queryCount / serialTime, maxError);
+	printf("closest point, BVH batch:\t%.0f queries/s\n", queryCount / parallelTime);
+	printf("raycast, BVH batch:\t\t%.0f queries/s (radius %.2f, %u hits)\n", queryCount / rayTime, rayRadius, hits);
+	printf("-------------------\n");
+}
+
+/// <summary>
+/// Draws the same curves sampled on the CPU (line strips) and tessellated on the GPU (one patch of 4 control points per segment).
+/// Reports the time to build and upload them, the uploaded bytes, and frame times with static curves and with one control point
+/// of every curve moving each frame.
+/// </summary>
+/// <param name="window">Window whose context is current</param>
+/// <param name="sampledShader">Shader for the line strips (general.glsl without skinning)</param>
+/// <param name="tessellationShader">Shader for the patches (spline.glsl)</param>
+/// <param name="curveCount">Number of curves</param>
+/// 
+void Benchmark::SplineDrawing(GLFWwindow* window, Shader& sampledShader, Shader& tessellationShader, const unsigned int& curveCount)
+{
+	const unsigned int controlPointCount = 64; // per curve
+	const unsigned int sampleRate = 1000; // per curve, CPU sampling only
+	const unsigned int editedPoint = controlPointCount / 2;
+
+	glfwSwapInterval(0);
+
+	int viewportWidth, viewportHeight;
+	glfwGetFramebufferSize(window, &viewportWidth, &viewportHeight);
+
+	// a random walk per curve, every curve sits in its own cell of a grid
+	std::vector<std::vector<glm::vec3>> controlPoints(curveCount);
+	srand(11);
+
+	for (auto& points : controlPoints)
+	{
+		glm::vec3 point(0.0f);
+		points.resize(controlPointCount);
+
+		for (auto& controlPoint : points)
+		{
+			point += glm::vec3(rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f);
+			controlPoint = point;
+		}
+	}
+
+	unsigned int side = (unsigned int)std::ceil(std::sqrt((float)curveCount));
+	float gridSize = side * 10.0f;
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, gridSize * 0.5f, gridSize), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(45.0f, (float)viewportWidth / std::max(viewportHeight, 1), 0.1f, gridSize * 4.0f);
+
+	UniformBlock<CameraBlock> cameraBlock(CAMERA_BLOCK_BINDING);
+	SetCamera(cameraBlock, view, projection);
+
+	printf("-------------------\n");
+	printf("Spline drawing benchmark (%u curves, %u control points each, %u samples per curve on the CPU, %d frames per run)\n\n",
+		curveCount, controlPointCount, sampleRate, BENCHMARK_FRAME_COUNT);
+
+	for (const auto& evaluation : { SPLINE_EVALUATION_CPU, SPLINE_EVALUATION_GPU })
+	{
+		Shader& shader = (evaluation == SPLINE_EVALUATION_GPU) ? tessellationShader : sampledShader;
+
+		TimeControl timer;
+		timer.Start();
+
+		std::deque<CubicBSpline> curves;
+
+		for (unsigned int i = 0; i < curveCount; i++)
+		{
+			curves.emplace_back(controlPoints[i], sampleRate, 0.0f, evaluation);
+			curves.back().GetTransform().SetPosition({ (i % side) * 10.0f - gridSize * 0.5f, 0.0f, (i / side) * -10.0f + gridSize * 0.5f });
+		}
+
+		glFinish();
+		double buildTime = timer.End();
+
+		size_t bufferSize = 0;
+
+		for (const auto& curve : curves)
+		{
+			bufferSize += curve.GetBufferSize();
+		}
+
+		auto drawCurves = [&]()
+		{
+			shader.Bind();
+
+			// all curves use the default pixels per segment
+			if (evaluation == SPLINE_EVALUATION_GPU)
+				curves.front().SetTessellationUniforms(shader, viewportWidth, viewportHeight);
+
+			for (auto& curve : curves)
+			{
+				curve.Draw();
+			}
+		};
+
+		double staticTime = MeasureFrames(window, BENCHMARK_FRAME_COUNT, drawCurves);
+
+		// CPU sampling re-evaluates and uploads the segments around the moved point, GPU evaluation only its control point
+		double editTime = 0.0;
+		unsigned int editCount = 0;
+		TimeControl editTimer;
+
+		double animatedTime = MeasureFrames(window, BENCHMARK_FRAME_COUNT, [&]()
+		{
+			glm::vec3 offset(0.0f, std::sin(editCount * 0.1f), 0.0f);
+
+			editTimer.Start();
+
+			for (unsigned int i = 0; i < curveCount; i++)
+			{
+				curves[i].SetControlPoint(editedPoint, controlPoints[i][editedPoint] + offset);
+			}
+
+			editTime += editTimer.End();
+			editCount++;
+
+			drawCurves();
+		});
+
+		printf("%s:\tbuild %8.2f ms\t%8.2f MB on the GPU\tstatic %8.3f ms/frame\tanimated %8.3f ms/frame (edits %8.3f ms)\n",
+			(evaluation == SPLINE_EVALUATION_GPU) ? "GPU tessellation" : "CPU sampling    ",
+			buildTime * 1000.0,
+			bufferSize / (1024.0 * 1024.0),
+			staticTime * 1000.0 / BENCHMARK_FRAME_COUNT,
+			animatedTime * 1000.0 / BENCHMARK_FRAME_COUNT,
+			editTime * 1000.0 / editCount);
+	}
+
+	printf("-------------------\n");
+}
+
+/// <summary>
+/// Moves instances along a spline: one Transform per object (evaluate the frame, SetPosition/SetOrientation, copy the matrix
+/// into the group) against the batched SplineFollowers update. Only the CPU side is measured.
+/// </summary>
+/// <param name="mesh">Mesh of the instances</param>
+/// <param name="followerCount">Number of objects on the path</param>
+/// 
+void Benchmark::PathFollowing(MeshV2& mesh, const unsigned int& followerCount)
+{
+	const float deltaTime = 1.0f / 60.0f;
+
+	std::vector<glm::vec3> controlPoints;
+
+	for (unsigned int i = 0; i < 64; i++)
+	{
+		float angle = i * 0.4f;
+		controlPoints.push_back({ std::cos(angle) * 50.0f, std::sin(angle * 0.5f) * 10.0f, std::sin(angle) * 50.0f + i });
+	}
+
+	CubicBSpline spline(controlPoints, 0, 0.0f, SPLINE_EVALUATION_GPU);
+	InstanceGroup instances(mesh);
+	SplineFollowers followers(spline, instances);
+
+	std::vector<Transform> transforms(followerCount);
+	float length = spline.GetLength();
+
+	for (unsigned int i = 0; i < followerCount; i++)
+	{
+		followers.AddFollower(length * i / followerCount, 1.0f + (i % 16) * 0.5f);
+	}
+
+	TimeControl timer;
+
+	// separate objects, each evaluates its own frame from scratch
+	timer.Start();
+
+	for (unsigned int frame = 0; frame < BENCHMARK_FRAME_COUNT; frame++)
+	{
+		for (unsigned int i = 0; i < followerCount; i++)
+		{
+			const SplineFollower& follower = followers.GetFollowers()[i];
+			float distance = std::fmod(follower.mDistance + follower.mSpeed * deltaTime * (frame + 1), length);
+
+			SplineFrame splineFrame = spline.EvaluateAtDistance(distance);
+
+			transforms[i].SetPosition(splineFrame.mPosition);
+			transforms[i].SetOrientation(glm::mat4(splineFrame.GetRotation()));
+			instances.SetInstanceTransform(i, transforms[i].GetMatrix());
+		}
+	}
+
+	double separateTime = timer.End();
+
+	timer.Start();
+
+	for (unsigned int frame = 0; frame < BENCHMARK_FRAME_COUNT; frame++)
+	{
+		followers.Update(deltaTime);
+	}
+
+	double batchTime = timer.End();
+
+	printf("-------------------\n");
+	printf("Path following benchmark (%u instances, %u threads)\n\n", followerCount, ThreadPool::GetShared().GetThreadCount() + 1);
+	printf("Transform per object:\t%.3f ms/frame\n", separateTime * 1000.0 / BENCHMARK_FRAME_COUNT);
+	printf("SplineFollowers:\t%.3f ms/frame (%.1fx)\n", batchTime * 1000.0 / BENCHMARK_FRAME_COUNT, separateTime / batchTime);
+	printf("-------------------\n");
+}
+
+/// <summary>
+/// Parsing throughput of a control point file: getline + strtof per line against Parser::ReadFile (memory mapped, parallel)
+/// and Parser::ReadFileChunked (blocks, one thread); then the file is converted to a binary point file (filePath.bin) and loaded
+/// </summary>
+/// <param name="filePath">Control point file; written first if generateMegabytes isn't 0</param>
+/// <param name="generateMegabytes">Size of the generated file (random points)</param>
+/// 
+void Benchmark::ParseControlPoints(const std::string& filePath, const unsigned int& generateMegabytes)
+{
+	if (generateMegabytes > 0)
+		WriteControlPointFile(filePath, (size_t)generateMegabytes << 20);
+
+	double megabytes = std::filesystem::file_size(filePath) / (1024.0 * 1024.0);
+	TimeControl timer;
+
+	// the line by line approach the parser replaced
+	timer.Start();
+
+	std::ifstream file(filePath);
+	std::string line;
+	std::getline(file, line);
+
+	size_t lineCount = 0;
+	glm::vec3 sum(0.0f);
+
+	while (std::getline(file, line))
+	{
+		const char* position = line.c_str();
+		char* end = nullptr;
+
+		for (int i = 0; i < 3; i++)
+		{
+			sum[i] += strtof(position, &end);
+			position = end;
+		}
+
+		lineCount++;
+	}
+
+	double lineTime = timer.End();
+
+	timer.Start();
+
+	std::vector<glm::vec3> points;
+	Parser::ReadFile(filePath, points);
+
+	double blockTime = timer.End();
+
+	points.clear();
+	points.shrink_to_fit();
+
+	timer.Start();
+
+	size_t chunkedCount = Parser::ReadFileChunked(filePath, 1 << 16, 3, [&](const std::vector<glm::vec3>& chunk)
+	{
+		sum += chunk.back();
+	});
+
+	double chunkedTime = timer.End();
+
+	// the same points converted once, then loaded without parsing
+	std::string binaryPath = filePath + ".bin";
+
+	timer.Start();
+	BinaryPointFile::ConvertText(filePath, binaryPath);
+	double convertTime = timer.End();
+
+	timer.Start();
+	Parser::ReadFile(binaryPath, points);
+	double binaryTime = timer.End();
+
+	double binaryMegabytes = std::filesystem::file_size(binaryPath) / (1024.0 * 1024.0);
+
+	printf("-------------------\n");
+	printf("Control point parser benchmark (%.1f MB, %zu points)\n\n", megabytes, chunkedCount);
+	printf("getline + strtof:\t%.1f MB/s (%zu lines)\n", megabytes / lineTime, lineCount);
+	printf("ReadFile (mapped, %u threads):\t%.1f MB/s\n", ThreadPool::GetShared().GetThreadCount() + 1, megabytes / blockTime);
+	printf("ReadFileChunked:\t%.1f MB/s\n", megabytes / chunkedTime);
+	printf("conversion to binary:\t%.3f s\n", convertTime);
+	printf("ReadFile (binary, %.1f MB):\t%.1f MB/s, %.1fx faster than the text file\n", binaryMegabytes, binaryMegabytes / binaryTime, blockTime / binaryTime);
+	printf("(checksum %g)\n", sum.x + sum.y + sum.z);
+	printf("-------------------\n");
+}
+
+// random points in [-1000, 1000] with 4 decimals, until the file has about byteCount bytes
+void Benchmark::WriteControlPointFile(const std::string& filePath, const size_t& byteCount)
+{
+	std::ofstream file(filePath, std::ios::binary);
+
+	if (!file.is_open())
+		Debug::ThrowException("Can't open file '" + filePath + "' for writing!");
+
+	// the count isn't known yet, the header is reserved and written at the end (the parser skips the padding)
+	const int headerWidth = 20;
+	file << std::string(headerWidth, ' ') << "\n";
+
+	std::vector<char> block(1 << 20);
+	size_t written = headerWidth + 1;
+	size_t pointCount = 0;
+
+	while (written < byteCount)
+	{
+		char* position = block.data();
+		char* end = block.data() + block.size() - 64;
+
+		while (position < end && written + (position - block.data()) < byteCount)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				float value = rand() / (float)RAND_MAX * 2000.0f - 1000.0f;
+				position = std::to_chars(position, end + 64, value, std::chars_format::fixed, 4).ptr;
+				*position++ = i < 2 ? ' ' : '\n';
+			}
+
+			pointCount++;
+		}
+
+		file.write(block.data(), position - block.data());
+		written += position - block.data();
+	}
+
+	std::string header = STRING(pointCount);
+	file.seekp(0);
+	file << std::string(headerWidth - header.size(), ' ') << header;
+}
+
+/// <summary>
+/// Draws a fixed number of frames into an offscreen framebuffer (no swap, so no vsync) and reports the frame times.
+/// Every frame is finished with glFinish, so the times include the GPU (or software rasterizer) work.
+/// </summary>
+/// <param name="target">Framebuffer the frames are drawn into</param>
+/// <param name="frameCount">Number of measured frames</param>
+/// <param name="dumpInterval">Every n-th frame is written to dumpPath_<frame>.ppm; 0 disables the dumps</param>
+/// <param name="dumpPath">Path prefix of the dumped images</param>
+/// <param name="drawFrame">Draws one frame, gets the frame index</param>
+/// 
+void Benchmark::OffscreenFrames(Framebuffer& target, const unsigned int& frameCount, const unsigned int& dumpInterval, const std::string& dumpPath, const std::function<void(const unsigned int&)>& drawFrame)
+{
+	if (frameCount == 0)
+		return;
+
+	std::vector<double> frameTimes;
+	frameTimes.reserve(frameCount);
+
+	target.Bind();
+
+	// warm-up frame so shader and buffer uploads are not part of the measurement
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	drawFrame(0);
+	glFinish();
+
+	TimeControl totalTimer;
+	totalTimer.Start();
+
+	for (unsigned int i = 0; i < frameCount; i++)
+	{
+		TimeControl frameTimer;
+		frameTimer.Start();
+
+		target.Bind();
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		drawFrame(i);
+		glFinish();
+
+		frameTimes.push_back(frameTimer.End() * 1000.0);
+
+		// read back outside of the measured frame
+		if (dumpInterval != 0 && i % dumpInterval == 0)
+		{
+			char frameSuffix[16];
+			snprintf(frameSuffix, sizeof(frameSuffix), "_%04u.ppm", i);
+
+			target.WritePPM(dumpPath + frameSuffix);
+		}
+	}
+
+	double totalTime = totalTimer.End();
+
+	target.Unbind();
+
+	double mean = 0.0;
+	for (const auto& frameTime : frameTimes)
+		mean += frameTime;
+	mean /= frameTimes.size();
+
+	std::sort(frameTimes.begin(), frameTimes.end());
+
+	printf("-------------------\n");
+	printf("Offscreen benchmark (%ux%u, %u frames)\n\n", target.GetWidth(), target.GetHeight(), frameCount);
+	printf("renderer: %s\n", (const char*)glGetString(GL_RENDERER));
+	printf("frame time [ms]: mean %.3f\tmedian %.3f\tp95 %.3f\tmin %.3f\tmax %.3f\n",
+		mean, frameTimes[frameTimes.size() / 2], frameTimes[(frameTimes.size() * 95) / 100], frameTimes.front(), frameTimes.back());
+	printf("%.1f frames/s (including image dumps)\n", frameCount / totalTime);
+	printf("-------------------\n");
+}
+
+void Benchmark::SetCamera(UniformBlock<CameraBlock>& cameraBlock, const glm::mat4& view, const glm::mat4& projection)
+{
+	CameraBlock& block = cameraBlock.Data();
+	block.mView = view;
+	block.mProjection = projection;
+	block.mViewPos = glm::inverse(view)[3];
+
+	cameraBlock.Upload();
+	cameraBlock.Bind();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "MeshV2.h"
+#include "UniformBuffer.h"
+#include "OcclusionCuller.h"
+#include "Framebuffer.h"
+
+struct GLFWwindow;
+class Objekt;
+
+class Benchmark
+{
+public:
+
+	static void InstancedDraws(GLFWwindow* window, MeshV2& mesh, Shader& shader, Shader& instancedShader);
+	static void RendererDraw(GLFWwindow* window, Objekt& object, Shader& shader, const unsigned int& objectCount);
+	static void OcclusionCulling(const std::string& depthDumpPath);
+	static void SplineQueries(const unsigned int& queryCount);
+	static void SplineDrawing(GLFWwindow* window, Shader& sampledShader, Shader& tessellationShader, const unsigned int& curveCount);
+	static void PathFollowing(MeshV2& mesh, const unsigned int& followerCount);
+	static void ParseControlPoints(const std::string& filePath, const unsigned int& generateMegabytes);
+	static void OffscreenFrames(Framebuffer& target, const unsigned int& frameCount, const unsigned int& dumpInterval, const std::string& dumpPath, const std::function<void(const unsigned int&)>& drawFrame);
+
+private:
+
+	static double MeasureFrames(GLFWwindow* window, const unsigned int& frameCount, const std::function<void()>& drawFrame);
+	static void FillGrid(const unsigned int& instanceCount, const glm::mat4& meshTransform, std::vector<glm::mat4>& output);
+	static void SetCamera(UniformBlock<CameraBlock>& cameraBlock, const glm::mat4& view, const glm::mat4& projection);
+	static void AddWall(OcclusionCuller& culler, const glm::vec3& center, const glm::vec2& size);
+	static void WriteControlPointFile(const std::string& filePath, const size_t& byteCount);
+
+};
@@ -0,0 +1,251 @@
+#include "BinaryPointFile.h"
+
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <filesystem>
+
+#include "Debug.h"
+#include "Parser.h"
+
+#define BINARY_POINT_CONVERT_CHUNK 65536 // points parsed and written at once by ConvertText
+
+// Writes the header with the payload right after it (rounded up to the alignment), then the points in chunks.
+// Everything goes to filePath.tmp, which only replaces filePath once Finish succeeds; an interrupted write removes it.
+class BinaryPointWriter
+{
+public:
+
+	BinaryPointWriter(const std::string& filePath, const PointPrecision& precision)
+		:
+		mPath(filePath),
+		mTemporaryPath(filePath + ".tmp"),
+		mPrecision(precision)
+	{
+		if (precision != POINT_PRECISION_FLOAT32 && precision != POINT_PRECISION_FLOAT64)
+			Debug::ThrowException("BinaryPointFile => invalid precision! (" + STRING(precision) + ")");
+
+		mFile.open(mTemporaryPath, std::ios::binary);
+
+		if (!mFile.is_open())
+			Debug::ThrowException("Can't open file '" + mTemporaryPath + "' for writing!");
+
+		std::memcpy(mHeader.mMagic, BINARY_POINT_FILE_MAGIC, sizeof(mHeader.mMagic));
+		mHeader.mPrecision = precision;
+		mHeader.mPayloadOffset = (sizeof(BinaryPointHeader) + BINARY_POINT_FILE_ALIGNMENT - 1) / BINARY_POINT_FILE_ALIGNMENT * BINARY_POINT_FILE_ALIGNMENT;
+
+		for (int i = 0; i < 3; i++)
+		{
+			mHeader.mMin[i] = std::numeric_limits<double>::max();
+			mHeader.mMax[i] = std::numeric_limits<double>::lowest();
+		}
+
+		// placeholder, the count and bounds are only known at the end
+		std::vector<char> padding(mHeader.mPayloadOffset, 0);
+		mFile.write(padding.data(), padding.size());
+	}
+
+	void Append(const glm::vec3* points, const size_t& count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				mHeader.mMin[axis] = std::min(mHeader.mMin[axis], (double)points[i][axis]);
+				mHeader.mMax[axis] = std::max(mHeader.mMax[axis], (double)points[i][axis]);
+			}
+		}
+
+		if (mPrecision == POINT_PRECISION_FLOAT32)
+			mFile.write((const char*)points, count * sizeof(glm::vec3));
+		else
+		{
+			mWide.resize(count * 3);
+
+			for (size_t i = 0; i < count * 3; i++)
+			{
+				mWide[i] = (&points[0].x)[i];
+			}
+
+			mFile.write((const char*)mWide.data(), mWide.size() * sizeof(double));
+		}
+
+		mHeader.mCount += count;
+	}
+
+	void Finish()
+	{
+		if (mHeader.mCount == 0)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				mHeader.mMin[i] = 0.0;
+				mHeader.mMax[i] = 0.0;
+			}
+		}
+
+		mFile.seekp(0);
+		mFile.write((const char*)&mHeader, sizeof(BinaryPointHeader));
+		mFile.close();
+
+		if (mFile.fail())
+			Debug::ThrowException("BinaryPointFile => writing '" + mTemporaryPath + "' failed!");
+
+		std::error_code error;
+		std::filesystem::rename(mTemporaryPath, mPath, error);
+
+		if (error)
+			Debug::ThrowException("BinaryPointFile => couldn't replace '" + mPath + "'! (" + error.message() + ")");
+
+		mFinished = true;
+	}
+
+	~BinaryPointWriter()
+	{
+		if (mFinished)
+			return;
+
+		mFile.close();
+
+		std::error_code error;
+		std::filesystem::remove(mTemporaryPath, error);
+	}
+
+private:
+
+	std::string mPath;
+	std::string mTemporaryPath;
+	bool mFinished = false;
+
+	std::ofstream mFile;
+	PointPrecision mPrecision;
+	BinaryPointHeader mHeader;
+	std::vector<double> mWide;
+
+};
+
+BinaryPointFile::BinaryPointFile(const std::string& filePath)
+	:
+	mOwnedFile(std::make_unique<MappedFile>(filePath)),
+	mFile(*mOwnedFile)
+{
+	ReadHeader(filePath);
+}
+
+BinaryPointFile::BinaryPointFile(const MappedFile& file, const std::string& filePath)
+	:
+	mFile(file)
+{
+	ReadHeader(filePath);
+}
+
+void BinaryPointFile::ReadHeader(const std::string& filePath)
+{
+	if (!mFile.IsMapped())
+		Debug::ThrowException("Can't open binary point file '" + filePath + "'!");
+
+	if (!IsBinary(mFile))
+		Debug::ThrowException("BinaryPointFile => '" + filePath + "' is not a binary point file!");
+
+	std::memcpy(&mHeader, mFile.GetData(), sizeof(BinaryPointHeader));
+
+	if (mHeader.mVersion != BINARY_POINT_FILE_VERSION)
+		Debug::ThrowException("BinaryPointFile => unsupported version " + STRING(mHeader.mVersion) + " in '" + filePath + "'!");
+
+	if (mHeader.mPrecision != POINT_PRECISION_FLOAT32 && mHeader.mPrecision != POINT_PRECISION_FLOAT64)
+		Debug::ThrowException("BinaryPointFile => invalid precision " + STRING(mHeader.mPrecision) + " in '" + filePath + "'!");
+
+	uint64_t size = mFile.GetSize();
+	uint64_t pointSize = 3ull * mHeader.mPrecision;
+
+	// checked without overflowing for any count in the header
+	if (mHeader.mPayloadOffset < sizeof(BinaryPointHeader) || mHeader.mPayloadOffset % BINARY_POINT_FILE_ALIGNMENT != 0 ||
+		mHeader.mPayloadOffset > size || mHeader.mCount > (size - mHeader.mPayloadOffset) / pointSize)
+		Debug::ThrowException("BinaryPointFile => '" + filePath + "' is truncated or has an invalid header! (" + STRING(mHeader.mCount) + " points)");
+
+	mCount = (size_t)mHeader.mCount;
+	mPayload = mFile.GetData() + mHeader.mPayloadOffset;
+}
+
+const BinaryPointHeader& BinaryPointFile::GetHeader() const
+{
+	return mHeader;
+}
+
+const size_t& BinaryPointFile::GetCount() const
+{
+	return mCount;
+}
+
+const glm::vec3* BinaryPointFile::GetPoints() const
+{
+	if (mHeader.mPrecision != POINT_PRECISION_FLOAT32)
+		return nullptr;
+
+	return (const glm::vec3*)mPayload;
+}
+
+glm::vec3 BinaryPointFile::GetPoint(const size_t& index) const
+{
+	glm::vec3 point;
+	CopyPoints(index, 1, &point);
+
+	return point;
+}
+
+void BinaryPointFile::CopyPoints(const size_t& first, const size_t& count, glm::vec3* output) const
+{
+	if (first > mCount || count > mCount - first)
+		Debug::ThrowException("BinaryPointFile => points out of range! (first = " + STRING(first) + ", count = " + STRING(count) + ")");
+
+	if (mHeader.mPrecision == POINT_PRECISION_FLOAT32)
+	{
+		std::memcpy(output, mPayload + first * sizeof(glm::vec3), count * sizeof(glm::vec3));
+		return;
+	}
+
+	const double* source = (const double*)mPayload + first * 3;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		output[i] = glm::vec3(source[i * 3], source[i * 3 + 1], source[i * 3 + 2]);
+	}
+}
+
+bool BinaryPointFile::IsBinary(const MappedFile& file)
+{
+	return file.GetSize() >= sizeof(BinaryPointHeader) && std::memcmp(file.GetData(), BINARY_POINT_FILE_MAGIC, sizeof(BinaryPointHeader::mMagic)) == 0;
+}
+
+void BinaryPointFile::Write(const std::string& filePath, const std::vector<glm::vec3>& points, const PointPrecision& precision)
+{
+	BinaryPointWriter writer(filePath, precision);
+	writer.Append(points.data(), points.size());
+	writer.Finish();
+}
+
+/// <summary>
+/// Converts a text control point file (see Parser) chunk by chunk, so the text file can be larger than memory.
+/// The text is parsed as float, float64 output only widens those values.
+/// </summary>
+/// <returns>Number of converted points</returns>
+/// 
+size_t BinaryPointFile::ConvertText(const std::string& textPath, const std::string& binaryPath, const PointPrecision& precision)
+{
+	std::error_code error;
+
+	if (textPath == binaryPath || std::filesystem::equivalent(textPath, binaryPath, error))
+		Debug::ThrowException("BinaryPointFile => the binary file would overwrite the text file! ('" + textPath + "')");
+
+	BinaryPointWriter writer(binaryPath, precision);
+
+	size_t count = Parser::ReadFileChunked(textPath, BINARY_POINT_CONVERT_CHUNK, 0, [&](const std::vector<glm::vec3>& chunk)
+	{
+		writer.Append(chunk.data(), chunk.size());
+	});
+
+	writer.Finish();
+
+	return count;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+
+#define BINARY_POINT_FILE_MAGIC "CTRLPTS" // 7 characters and the terminating zero fill mMagic
+#define BINARY_POINT_FILE_VERSION 1
+#define BINARY_POINT_FILE_ALIGNMENT 64 // the payload starts at a multiple of this
+
+enum PointPrecision
+{
+	POINT_PRECISION_FLOAT32 = 4,
+	POINT_PRECISION_FLOAT64 = 8
+};
+
+// Little endian, like every platform the project runs on
+struct BinaryPointHeader
+{
+	char mMagic[8] = { 0 };
+	uint32_t mVersion = BINARY_POINT_FILE_VERSION;
+	uint32_t mPrecision = POINT_PRECISION_FLOAT32; // bytes per coordinate
+	uint64_t mCount = 0;
+	uint64_t mPayloadOffset = 0; // x, y, z of every point, tightly packed
+	double mMin[3] = { 0.0, 0.0, 0.0 }; // bounds of the points
+	double mMax[3] = { 0.0, 0.0, 0.0 };
+	uint8_t mReserved[48] = { 0 };
+};
+
+static_assert(sizeof(BinaryPointHeader) == 128, "BinaryPointHeader layout is part of the file format");
+
+// Control points stored as raw floats behind a small header. The file is memory mapped; float32 points are used straight
+// from the mapping (glm::vec3 has the same layout), so loading costs no more than touching the pages.
+class BinaryPointFile
+{
+public:
+
+	BinaryPointFile(const std::string& filePath); // throws if the file isn't a valid binary point file
+	BinaryPointFile(const MappedFile& file, const std::string& filePath); // uses an existing mapping, which has to outlive this object
+
+	const BinaryPointHeader& GetHeader() const;
+	const size_t& GetCount() const;
+	const glm::vec3* GetPoints() const; // float32 files only, nullptr otherwise
+	glm::vec3 GetPoint(const size_t& index) const; // any precision
+
+	void CopyPoints(const size_t& first, const size_t& count, glm::vec3* output) const; // converts float64 files
+
+	static bool IsBinary(const MappedFile& file); // checks the magic only
+	static void Write(const std::string& filePath, const std::vector<glm::vec3>& points, const PointPrecision& precision = POINT_PRECISION_FLOAT32);
+	static size_t ConvertText(const std::string& textPath, const std::string& binaryPath, const PointPrecision& precision = POINT_PRECISION_FLOAT32); // streams, any file size
+
+private:
+
+	void ReadHeader(const std::string& filePath);
+
+	std::unique_ptr<MappedFile> mOwnedFile; // null if the mapping is borrowed
+	const MappedFile& mFile;
+	BinaryPointHeader mHeader;
+	size_t mCount = 0;
+	const char* mPayload = nullptr;
+
+};
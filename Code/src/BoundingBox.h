@@ -0,0 +1,94 @@
+#pragma once
+
+#include <limits>
+
+#include <glm/glm.hpp>
+
+struct AABB
+{
+	glm::vec3 mMin{ std::numeric_limits<float>::max() };
+	glm::vec3 mMax{ std::numeric_limits<float>::lowest() };
+
+	AABB()
+	{
+	}
+
+	AABB(const glm::vec3& min, const glm::vec3& max)
+		:
+		mMin(min),
+		mMax(max)
+	{
+	}
+
+	bool IsValid() const
+	{
+		return mMin.x <= mMax.x && mMin.y <= mMax.y && mMin.z <= mMax.z;
+	}
+
+	glm::vec3 GetCenter() const
+	{
+		return (mMin + mMax) * 0.5f;
+	}
+
+	glm::vec3 GetExtents() const
+	{
+		return (mMax - mMin) * 0.5f;
+	}
+
+	float SurfaceArea() const
+	{
+		glm::vec3 d = mMax - mMin;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	void Expand(const glm::vec3& point)
+	{
+		mMin = glm::min(mMin, point);
+		mMax = glm::max(mMax, point);
+	}
+
+	bool Contains(const AABB& other) const
+	{
+		return mMin.x <= other.mMin.x && mMin.y <= other.mMin.y && mMin.z <= other.mMin.z &&
+			mMax.x >= other.mMax.x && mMax.y >= other.mMax.y && mMax.z >= other.mMax.z;
+	}
+
+	// 0 for points inside the box
+	float DistanceSquared(const glm::vec3& point) const
+	{
+		glm::vec3 d = glm::max(glm::max(mMin - point, point - mMax), glm::vec3(0.0f));
+		return glm::dot(d, d);
+	}
+
+	// Slab test; the box is grown by margin on every side. tEnter is clamped to 0 when the ray starts inside.
+	bool IntersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, const float& maxDistance, const float& margin, float& tEnter) const
+	{
+		glm::vec3 t0 = (mMin - glm::vec3(margin) - origin) * inverseDirection;
+		glm::vec3 t1 = (mMax + glm::vec3(margin) - origin) * inverseDirection;
+
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+
+		tEnter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+		float tExit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+
+		return tEnter <= tExit;
+	}
+
+	static AABB Merge(const AABB& a, const AABB& b)
+	{
+		return { glm::min(a.mMin, b.mMin), glm::max(a.mMax, b.mMax) };
+	}
+
+	// Box enclosing this box after transformation (center/extents form, no need to transform all 8 corners)
+	AABB Transformed(const glm::mat4& matrix) const
+	{
+		glm::vec3 center = glm::vec3(matrix * glm::vec4(GetCenter(), 1.0f));
+		glm::vec3 extents = GetExtents();
+
+		glm::mat3 absolute(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+		glm::vec3 newExtents = absolute * extents;
+
+		return { center - newExtents, center + newExtents };
+	}
+};
@@ -5,7 +5,7 @@
 Camera::Camera()
 	:
 	mView(glm::lookAt(mPosition, mPosition + mFront, mUp)),
-	mShaderUniformName("view")
+	mShaderBlockName("Camera")
 {
 	Debug::Print("Camera default constructor (Shader* mShader not set!)");
 }
@@ -16,8 +16,13 @@ Camera::Camera(const glm::vec3& position, const glm::vec3& front, const glm::vec
 	mFront(front),
 	mUp(up),
 	mView(glm::lookAt(position, position + front, up)),
-	mShader(shader)
+	mShader(shader),
+	mShaderBlockName("Camera")
 {
+	if (mShader != nullptr)
+		mShader->BindUniformBlock(mShaderBlockName, CAMERA_BLOCK_BINDING);
+
+	UpdateShaderUniform();
 }
 
 void Camera::SetMoveSpeed(const float& newSpeed)
@@ -25,10 +30,20 @@ void Camera::SetMoveSpeed(const float& newSpeed)
 	mMoveSpeed = newSpeed;
 }
 
-void Camera::SetShader(const std::string& uniformName, Shader* shader)
+void Camera::SetShader(const std::string& blockName, Shader* shader)
 {
 	mShader = shader;
-	mShaderUniformName = uniformName;
+	mShaderBlockName = blockName;
+
+	if (mShader != nullptr)
+		mShader->BindUniformBlock(mShaderBlockName, CAMERA_BLOCK_BINDING);
+
+	UpdateShaderUniform();
+}
+
+void Camera::SetProjection(const glm::mat4& projection)
+{
+	mCameraBlock.Data().mProjection = projection;
 
 	UpdateShaderUniform();
 }
@@ -38,6 +53,12 @@ Transform& Camera::GetView()
 	return mView;
 }
 
+glm::mat4 Camera::GetViewProjection() const
+{
+	const CameraBlock& block = mCameraBlock.Data();
+	return block.mProjection * block.mView;
+}
+
 void Camera::Rotate(const glm::vec3& rotation)
 {
 	mView.Rotate(rotation);
@@ -73,15 +94,13 @@ void Camera::ResetTransform()
 	UpdateShaderUniform();
 }
 
+// Camera data lives in a uniform block shared by every shader, so an update is a single buffer write
 void Camera::UpdateShaderUniform()
 {
-	if (mShader != nullptr)
-	{
-		mShader->SetUniformMatrix4f(mShaderUniformName, mView.GetMatrix());
-		mShader->SetUniform3fv("uViewPos", mView.GetPosition() * -1.0f);
-	}
-	else
-	{
-		Debug::ThrowException("Shader not set for Camera!");
-	}
+	CameraBlock& block = mCameraBlock.Data();
+	block.mView = mView.GetMatrix();
+	block.mViewPos = glm::vec4(mView.GetPosition() * -1.0f, 1.0f);
+
+	mCameraBlock.Upload();
+	mCameraBlock.Bind();
 }
@@ -5,6 +5,7 @@
 
 #include "Transform.h"
 #include "Shader.h"
+#include "UniformBuffer.h"
 
 class Camera
 {
@@ -14,9 +15,11 @@ public:
 	Camera(const glm::vec3& position, const glm::vec3& front, const glm::vec3& up, Shader* shader = nullptr);
 
 	void SetMoveSpeed(const float& newSpeed);
-	void SetShader(const std::string& uniformName, Shader* shader);
+	void SetShader(const std::string& blockName, Shader* shader);
+	void SetProjection(const glm::mat4& projection);
 
 	Transform& GetView();
+	glm::mat4 GetViewProjection() const;
 
 	void Rotate(const glm::vec3& rotation);
 	void SetOrientation(const glm::vec3& rotation);
@@ -38,7 +41,9 @@ private:
 
 	Transform mView;
 
-	Shader* mShader;
-	std::string mShaderUniformName;
+	UniformBlock<CameraBlock> mCameraBlock{ CAMERA_BLOCK_BINDING };
+
+	Shader* mShader = nullptr;
+	std::string mShaderBlockName;
 
 };
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "DrawList.h"
+
+#include <algorithm>
+#include <cstring>
+
+DrawList::DrawList()
+{
+}
+
+void DrawList::Clear()
+{
+	mCommands.clear();
+	mConstants.clear();
+}
+
+/// <summary>
+/// 
+/// </summary>
+/// <param name="stride">Distance between two packed ObjectBlocks; the uniform buffer offset alignment rounded up to fit one block</param>
+/// 
+void DrawList::SetConstantsStride(const unsigned int& stride)
+{
+	mConstantsStride = std::max<unsigned int>(stride, sizeof(ObjectBlock));
+}
+
+void DrawList::Add(Drawable& object, const uint64_t& sortKey, const unsigned int& lod, const ObjectBlock& constants)
+{
+	unsigned int index = (unsigned int)mCommands.size();
+
+	mCommands.push_back({ sortKey, &object, lod, index });
+
+	mConstants.resize(mConstants.size() + mConstantsStride);
+	std::memcpy(mConstants.data() + (size_t)index * mConstantsStride, &constants, sizeof(ObjectBlock));
+}
+
+void DrawList::Sort()
+{
+	std::sort(mCommands.begin(), mCommands.end(), [](const DrawCommand& a, const DrawCommand& b) { return a.mSortKey < b.mSortKey; });
+}
+
+const std::vector<DrawCommand>& DrawList::GetCommands() const
+{
+	return mCommands;
+}
+
+const std::vector<unsigned char>& DrawList::GetConstants() const
+{
+	return mConstants;
+}
+
+unsigned int DrawList::GetSize() const
+{
+	return (unsigned int)mCommands.size();
+}
+
+// Material in the top 24 bits (fewest state changes), then lod, then depth front to back (less overdraw)
+uint64_t DrawList::MakeSortKey(const unsigned int& materialID, const unsigned int& lod, const float& depth)
+{
+	// bit pattern of a non-negative float increases with its value
+	float clampedDepth = std::max(depth, 0.0f);
+	uint32_t depthBits;
+	std::memcpy(&depthBits, &clampedDepth, sizeof(depthBits));
+
+	return ((uint64_t)(materialID & 0xFFFFFF) << 40) | ((uint64_t)(lod & 0xFF) << 32) | depthBits;
+}
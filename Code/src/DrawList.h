@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Drawable.h"
+#include "UniformBuffer.h"
+
+struct DrawCommand
+{
+	uint64_t mSortKey = 0; // material | lod | depth, see DrawList::MakeSortKey
+	Drawable* mObject = nullptr;
+	unsigned int mLod = 0;
+	unsigned int mConstantsIndex = 0; // index into the owning list's constants, global index after merging
+};
+
+// Commands and packed object constants recorded by one worker thread; touches no GL state
+class DrawList
+{
+public:
+
+	DrawList();
+
+	void Clear();
+	void SetConstantsStride(const unsigned int& stride);
+
+	void Add(Drawable& object, const uint64_t& sortKey, const unsigned int& lod, const ObjectBlock& constants);
+	void Sort();
+
+	const std::vector<DrawCommand>& GetCommands() const;
+	const std::vector<unsigned char>& GetConstants() const;
+	unsigned int GetSize() const;
+
+	static uint64_t MakeSortKey(const unsigned int& materialID, const unsigned int& lod, const float& depth);
+
+private:
+
+	std::vector<DrawCommand> mCommands;
+	std::vector<unsigned char> mConstants; // ObjectBlocks, mConstantsStride bytes apart
+	unsigned int mConstantsStride = sizeof(ObjectBlock);
+
+};
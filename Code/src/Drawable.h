@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Transform.h"
+#include "BoundingBox.h"
 
 class Drawable
 {
@@ -13,5 +14,28 @@ public:
 
 	virtual void SetActive(const bool& value) = 0;
 	virtual void Draw() = 0;
+
+	// Objects without levels of detail ignore the index
+	virtual void DrawLod(const unsigned int&)
+	{
+		Draw();
+	}
+
+	virtual unsigned int GetLodCount() const
+	{
+		return 1;
+	}
+
+	// Draws with equal material IDs are submitted next to each other
+	virtual unsigned int GetMaterialID() const
+	{
+		return 0;
+	}
 	virtual Transform& GetTransform() = 0;
+
+	// Bounds in object space; an invalid box means the object is never culled
+	virtual AABB GetLocalBounds() const
+	{
+		return AABB();
+	}
 };
\ No newline at end of file
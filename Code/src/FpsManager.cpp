@@ -42,10 +42,12 @@ void FpsManager::Begin()
 
 bool FpsManager::TimeToGo()
 {
-	if(mTimer.End() < mWaitTime)
+	double elapsed = mTimer.End();
+
+	if (elapsed < mWaitTime)
 		return false;
 	
-	mCurrentFps = 1.0 / mTimer.End();
+	mCurrentFps = 1.0 / elapsed;
 
 	return true;
 }
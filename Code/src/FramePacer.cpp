@@ -0,0 +1,233 @@
+#include "FramePacer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <time.h>
+#include <cerrno>
+#endif
+
+#include "Debug.h"
+
+// default time before the deadline at which sleeping stops; covers the usual oversleep of the OS timer
+#define FRAME_PACER_SPIN_MARGIN_PRECISE 0.0002
+#define FRAME_PACER_SPIN_MARGIN_COARSE 0.002
+
+double PacingStats::GetJitter() const
+{
+	return std::sqrt(mFrameTimeVariance);
+}
+
+/// <summary>
+/// 
+/// </summary>
+/// <param name="targetFps">Frames per second Wait paces to</param>
+/// <param name="fixedTimestep">Step consumed by StepSimulation; in seconds</param>
+/// 
+FramePacer::FramePacer(const unsigned int& targetFps, const double& fixedTimestep)
+	:
+	mPeriod(1.0 / targetFps),
+	mFixedTimestep(fixedTimestep),
+	mSpinMargin(FRAME_PACER_SPIN_MARGIN_PRECISE)
+{
+	if (targetFps == 0 || fixedTimestep <= 0.0)
+		Debug::ThrowException("FramePacer => invalid target fps or timestep!");
+
+#ifdef _WIN32
+	// high resolution timers exist since Windows 10 1803; older versions only get the default ~1ms (often 15.6ms) resolution
+	mTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+	if (!mTimer)
+	{
+		mTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+		mSpinMargin = FRAME_PACER_SPIN_MARGIN_COARSE;
+	}
+#endif
+}
+
+FramePacer::~FramePacer()
+{
+#ifdef _WIN32
+	if (mTimer)
+		CloseHandle(mTimer);
+#endif
+}
+
+void FramePacer::SetTargetFps(const unsigned int& targetFps)
+{
+	if (targetFps == 0)
+		Debug::ThrowException("FramePacer => invalid target fps!");
+
+	mPeriod = 1.0 / targetFps;
+}
+
+void FramePacer::SetSpinMargin(const double& seconds)
+{
+	mSpinMargin = seconds;
+}
+
+/// <summary>
+/// Call once at the start of every frame
+/// </summary>
+/// <returns>Time since the previous frame started; in seconds</returns>
+/// 
+double FramePacer::BeginFrame()
+{
+	PacerClock::time_point now = PacerClock::now();
+
+	if (!mStarted)
+	{
+		mStarted = true;
+		mLastFrameStart = now;
+		mDeadline = now + std::chrono::duration_cast<PacerClock::duration>(std::chrono::duration<double>(mPeriod));
+
+		return 0.0;
+	}
+
+	double frameTime = std::chrono::duration<double>(now - mLastFrameStart).count();
+	mLastFrameStart = now;
+	mLastFrameTime = frameTime;
+
+	mAccumulator += (frameTime < FRAME_PACER_MAX_FRAME_TIME) ? frameTime : FRAME_PACER_MAX_FRAME_TIME;
+
+	// running mean and variance (Welford)
+	mStats.mFrames++;
+	double delta = frameTime - mStats.mMeanFrameTime;
+	mStats.mMeanFrameTime += delta / mStats.mFrames;
+	mStats.mFrameTimeVariance += (delta * (frameTime - mStats.mMeanFrameTime) - mStats.mFrameTimeVariance) / mStats.mFrames;
+
+	if (frameTime > mStats.mMaxFrameTime)
+		mStats.mMaxFrameTime = frameTime;
+
+	return frameTime;
+}
+
+// Blocks until the current frame's deadline; deadlines advance by whole periods, so short hiccups don't shift the cadence
+void FramePacer::Wait()
+{
+	if (!mStarted)
+		BeginFrame();
+
+	PacerClock::duration period = std::chrono::duration_cast<PacerClock::duration>(std::chrono::duration<double>(mPeriod));
+	PacerClock::time_point now = PacerClock::now();
+
+	if (now >= mDeadline)
+	{
+		mStats.mMissedDeadlines++;
+
+		// more than a whole period behind: start a new cadence instead of rushing through the missed frames
+		mDeadline = (now - mDeadline > period) ? now + period : mDeadline + period;
+		return;
+	}
+
+	PacerClock::time_point sleepUntil = mDeadline - std::chrono::duration_cast<PacerClock::duration>(std::chrono::duration<double>(mSpinMargin));
+
+	if (now < sleepUntil)
+		SleepUntil(sleepUntil);
+
+	while (PacerClock::now() < mDeadline)
+	{
+		std::this_thread::yield();
+	}
+
+	double wakeError = std::chrono::duration<double>(PacerClock::now() - mDeadline).count();
+
+	mStats.mWaits++;
+	mStats.mMeanWakeError += (wakeError - mStats.mMeanWakeError) / mStats.mWaits;
+
+	if (wakeError > mStats.mMaxWakeError)
+		mStats.mMaxWakeError = wakeError;
+
+	mDeadline += period;
+}
+
+/// <summary>
+/// Consumes one fixed timestep from the accumulator; call in a loop until it returns false
+/// </summary>
+/// 
+bool FramePacer::StepSimulation()
+{
+	if (mAccumulator < mFixedTimestep)
+		return false;
+
+	mAccumulator -= mFixedTimestep;
+
+	return true;
+}
+
+const double& FramePacer::GetFixedTimestep() const
+{
+	return mFixedTimestep;
+}
+
+// Fraction of a timestep left in the accumulator; for interpolating between the last two simulation states
+double FramePacer::GetInterpolationAlpha() const
+{
+	return mAccumulator / mFixedTimestep;
+}
+
+unsigned int FramePacer::GetCurrentFps() const
+{
+	return (mLastFrameTime > 0.0) ? (unsigned int)(1.0 / mLastFrameTime + 0.5) : 0;
+}
+
+const PacingStats& FramePacer::GetStats() const
+{
+	return mStats;
+}
+
+void FramePacer::ResetStats()
+{
+	mStats = PacingStats();
+}
+
+void FramePacer::PrintStats() const
+{
+	printf("Frame pacing: %u frames, mean %.3f ms, jitter %.3f ms, max %.3f ms, missed deadlines %u, wake error mean %.1f us / max %.1f us\n",
+		mStats.mFrames, mStats.mMeanFrameTime * 1000.0, mStats.GetJitter() * 1000.0, mStats.mMaxFrameTime * 1000.0,
+		mStats.mMissedDeadlines, mStats.mMeanWakeError * 1000000.0, mStats.mMaxWakeError * 1000000.0);
+}
+
+void FramePacer::SleepUntil(const PacerClock::time_point& wakeTime)
+{
+	double seconds = std::chrono::duration<double>(wakeTime - PacerClock::now()).count();
+
+	if (seconds <= 0.0)
+		return;
+
+#ifdef _WIN32
+	if (mTimer)
+	{
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -(LONGLONG)(seconds * 10000000.0); // negative = relative, in 100ns units
+
+		if (SetWaitableTimerEx(mTimer, &dueTime, 0, nullptr, nullptr, nullptr, 0))
+		{
+			WaitForSingleObject(mTimer, INFINITE);
+			return;
+		}
+	}
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+#else
+	// absolute CLOCK_MONOTONIC deadline, so an interrupted sleep can simply be resumed
+	timespec target;
+	clock_gettime(CLOCK_MONOTONIC, &target);
+
+	long long nanoseconds = target.tv_nsec + (long long)(seconds * 1000000000.0);
+	target.tv_sec += (time_t)(nanoseconds / 1000000000);
+	target.tv_nsec = (long)(nanoseconds % 1000000000);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, nullptr) == EINTR)
+	{
+	}
+#endif
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+
+#define FRAME_PACER_MAX_FRAME_TIME 0.25 // longer frames are clamped before entering the accumulator (breakpoints, window dragging)
+
+struct PacingStats
+{
+	unsigned int mFrames = 0;
+	unsigned int mWaits = 0;
+	unsigned int mMissedDeadlines = 0; // frames which were already late when Wait was called
+
+	// frame time measured between two BeginFrame calls; in seconds
+	double mMeanFrameTime = 0.0;
+	double mFrameTimeVariance = 0.0; // jitter = sqrt(variance)
+	double mMaxFrameTime = 0.0;
+
+	// how late Wait returned compared to the deadline; in seconds
+	double mMeanWakeError = 0.0;
+	double mMaxWakeError = 0.0;
+
+	double GetJitter() const;
+};
+
+// Paces frames to a target rate by sleeping until shortly before the deadline and spinning only for the rest.
+// Also keeps a fixed timestep accumulator for the simulation.
+class FramePacer
+{
+public:
+
+	FramePacer(const unsigned int& targetFps, const double& fixedTimestep = 1.0 / 60.0);
+	~FramePacer();
+
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	void SetTargetFps(const unsigned int& targetFps);
+	void SetSpinMargin(const double& seconds);
+
+	double BeginFrame();
+	void Wait();
+
+	bool StepSimulation();
+	const double& GetFixedTimestep() const;
+	double GetInterpolationAlpha() const;
+
+	unsigned int GetCurrentFps() const;
+	const PacingStats& GetStats() const;
+	void ResetStats();
+	void PrintStats() const;
+
+private:
+
+	using PacerClock = std::chrono::steady_clock;
+
+	void SleepUntil(const PacerClock::time_point& wakeTime);
+
+	double mPeriod; // in seconds
+	double mFixedTimestep;
+	double mAccumulator = 0.0;
+	double mSpinMargin;
+
+	PacerClock::time_point mDeadline;
+	PacerClock::time_point mLastFrameStart;
+	bool mStarted = false;
+
+	double mLastFrameTime = 0.0;
+
+	PacingStats mStats;
+
+	void* mTimer = nullptr; // waitable timer handle on Windows
+
+};
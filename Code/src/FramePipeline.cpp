@@ -0,0 +1,163 @@
+#include "FramePipeline.h"
+
+#include "Debug.h"
+#include "TimeControl.h"
+#include "Profiler.h"
+
+#define FRAME_PIPELINE_AVERAGE_WEIGHT 0.05
+
+/// <summary>
+/// 
+/// </summary>
+/// <param name="simulate">Called on the simulation thread; must only write to the given frame</param>
+/// 
+FramePipeline::FramePipeline(const SimulateFunction& simulate)
+	:
+	mSimulate(simulate)
+{
+	for (auto& state : mStates)
+	{
+		state = SLOT_FREE;
+	}
+
+	mThread = std::thread(&FramePipeline::SimulationLoop, this);
+}
+
+FramePipeline::~FramePipeline()
+{
+	Stop();
+}
+
+// Queues the input of the next frame; the simulation starts as soon as a slot is free
+void FramePipeline::Submit(const SimulationInput& input)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mInputs.push(input);
+	}
+
+	mStateChanged.notify_all();
+}
+
+/// <summary>
+/// Blocks until the oldest not yet rendered frame is simulated
+/// </summary>
+/// <returns>Frame which stays valid until ReleaseFrame</returns>
+/// 
+const SimulationFrame& FramePipeline::AcquireFrame()
+{
+	if (mRenderingSlot != -1)
+		Debug::ThrowException("FramePipeline => previous frame wasn't released!");
+
+	TimeControl timer;
+	timer.Start();
+
+	PROFILE_SCOPE("FramePipeline::AcquireFrame");
+
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	unsigned int slot = mNextRenderedIndex % FRAME_PIPELINE_DEPTH;
+
+	mStateChanged.wait(lock, [this, slot]() { return mStates[slot] == SLOT_READY || mStopping; });
+
+	if (mStates[slot] != SLOT_READY)
+		Debug::ThrowException("FramePipeline => stopped while waiting for a frame!");
+
+	mStates[slot] = SLOT_RENDERING;
+	mRenderingSlot = (int)slot;
+
+	mAverageWaitTime += (timer.End() - mAverageWaitTime) * FRAME_PIPELINE_AVERAGE_WEIGHT;
+
+	return mFrames[slot];
+}
+
+void FramePipeline::ReleaseFrame()
+{
+	if (mRenderingSlot == -1)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		mStates[mRenderingSlot] = SLOT_FREE;
+		mRenderingSlot = -1;
+		mNextRenderedIndex++;
+	}
+
+	mStateChanged.notify_all();
+}
+
+// Finishes the frame currently being simulated and joins the simulation thread
+void FramePipeline::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+
+	mStateChanged.notify_all();
+
+	if (mThread.joinable())
+		mThread.join();
+}
+
+double FramePipeline::GetAverageSimulationTime() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mAverageSimulationTime;
+}
+
+// Time the render thread spent waiting for the simulation; close to zero when rendering is the bottleneck
+double FramePipeline::GetAverageWaitTime() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mAverageWaitTime;
+}
+
+void FramePipeline::SimulationLoop()
+{
+	Profiler::SetThreadName("Simulation");
+
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	while (true)
+	{
+		unsigned int slot = mNextSimulatedIndex % FRAME_PIPELINE_DEPTH;
+
+		mStateChanged.wait(lock, [this, slot]() { return mStopping || (!mInputs.empty() && mStates[slot] == SLOT_FREE); });
+
+		if (mStopping)
+			return;
+
+		SimulationInput input = mInputs.front();
+		mInputs.pop();
+
+		mStates[slot] = SLOT_SIMULATING;
+
+		SimulationFrame& frame = mFrames[slot];
+		frame.mIndex = mNextSimulatedIndex;
+		frame.mInput = input;
+
+		// the slot belongs to this thread until it is marked as ready, so it is written without holding the lock
+		lock.unlock();
+
+		TimeControl timer;
+		timer.Start();
+
+		{
+			PROFILE_SCOPE("FramePipeline::Simulate");
+			mSimulate(input, frame);
+		}
+
+		frame.mSimulationTime = timer.End();
+
+		lock.lock();
+
+		mAverageSimulationTime += (frame.mSimulationTime - mAverageSimulationTime) * FRAME_PIPELINE_AVERAGE_WEIGHT;
+
+		mStates[slot] = SLOT_READY;
+		mNextSimulatedIndex++;
+
+		mStateChanged.notify_all();
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include <glm/glm.hpp>
+
+#define FRAME_PIPELINE_DEPTH 3 // one frame being rendered, one ready, one being simulated
+
+// Everything the simulation needs from the render thread; copied, so input callbacks can keep writing their variables
+struct SimulationInput
+{
+	double mTime = 0.0; // in seconds
+	unsigned int mStartAnimation = 0;
+	unsigned int mEndAnimation = 0;
+	float mBlendFactor = 0.0f;
+};
+
+struct SimulationFrame
+{
+	unsigned long long mIndex = 0;
+	SimulationInput mInput;
+	std::vector<glm::mat4> mBonePalette;
+	double mSimulationTime = 0.0; // seconds spent simulating this frame
+};
+
+// Runs the simulation of frame N + 1 on its own thread while the render thread draws frame N.
+// Frames live in a ring of FRAME_PIPELINE_DEPTH slots and are handed over explicitly:
+// Submit -> (simulation thread) -> AcquireFrame -> ReleaseFrame.
+class FramePipeline
+{
+public:
+
+	using SimulateFunction = std::function<void(const SimulationInput& input, SimulationFrame& frame)>;
+
+	FramePipeline(const SimulateFunction& simulate);
+	~FramePipeline();
+
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+	void Submit(const SimulationInput& input);
+
+	const SimulationFrame& AcquireFrame();
+	void ReleaseFrame();
+
+	void Stop();
+
+	double GetAverageSimulationTime() const;
+	double GetAverageWaitTime() const;
+
+private:
+
+	enum SlotState
+	{
+		SLOT_FREE,
+		SLOT_SIMULATING,
+		SLOT_READY,
+		SLOT_RENDERING
+	};
+
+	void SimulationLoop();
+
+	SimulateFunction mSimulate;
+
+	SimulationFrame mFrames[FRAME_PIPELINE_DEPTH];
+	SlotState mStates[FRAME_PIPELINE_DEPTH];
+
+	std::queue<SimulationInput> mInputs;
+	unsigned long long mNextSimulatedIndex = 0;
+	unsigned long long mNextRenderedIndex = 0;
+	int mRenderingSlot = -1;
+
+	mutable std::mutex mMutex; // also guards the averages
+	std::condition_variable mStateChanged;
+	bool mStopping = false;
+
+	// exponential moving averages, in seconds
+	double mAverageSimulationTime = 0.0;
+	double mAverageWaitTime = 0.0;
+
+	std::thread mThread;
+
+};
@@ -0,0 +1,112 @@
+#include "Framebuffer.h"
+
+#include <fstream>
+
+#include "Debug.h"
+
+Framebuffer::Framebuffer(const unsigned int& width, const unsigned int& height)
+	:
+	mWidth(width),
+	mHeight(height)
+{
+	if (width == 0 || height == 0)
+		Debug::ThrowException("Framebuffer => invalid size! (" + STRING(width) + "x" + STRING(height) + ")");
+
+	glGenFramebuffers(1, &mRendererID);
+	glBindFramebuffer(GL_FRAMEBUFFER, mRendererID);
+
+	glGenRenderbuffers(1, &mColorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, mColorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, mWidth, mHeight);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mColorBuffer);
+
+	glGenRenderbuffers(1, &mDepthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, mDepthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mWidth, mHeight);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthBuffer);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+		Debug::ThrowException("Framebuffer => incomplete framebuffer! (status = " + STRING(status) + ")");
+}
+
+Framebuffer::~Framebuffer()
+{
+	glDeleteRenderbuffers(1, &mDepthBuffer);
+	glDeleteRenderbuffers(1, &mColorBuffer);
+	glDeleteFramebuffers(1, &mRendererID);
+}
+
+void Framebuffer::Bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mRendererID);
+	glViewport(0, 0, mWidth, mHeight);
+}
+
+void Framebuffer::Unbind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::ReadPixels(std::vector<unsigned char>& output) const
+{
+	output.resize((size_t)mWidth * mHeight * 4);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, mRendererID);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, mWidth, mHeight, GL_RGBA, GL_UNSIGNED_BYTE, output.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+/// <summary>
+/// Writes the color buffer as a binary PPM (top row first)
+/// </summary>
+///
+void Framebuffer::WritePPM(const std::string& filePath) const
+{
+	std::vector<unsigned char> pixels;
+	ReadPixels(pixels);
+
+	std::ofstream file(filePath, std::ios::binary);
+
+	if (!file.is_open())
+		Debug::ThrowException("Framebuffer => couldn't open file '" + filePath + "' for writing!");
+
+	file << "P6\n" << mWidth << " " << mHeight << "\n255\n";
+
+	std::vector<unsigned char> row(mWidth * 3);
+
+	for (unsigned int y = mHeight; y-- > 0;)
+	{
+		const unsigned char* source = &pixels[(size_t)y * mWidth * 4];
+
+		for (unsigned int x = 0; x < mWidth; x++)
+		{
+			row[x * 3 + 0] = source[x * 4 + 0];
+			row[x * 3 + 1] = source[x * 4 + 1];
+			row[x * 3 + 2] = source[x * 4 + 2];
+		}
+
+		file.write((const char*)row.data(), row.size());
+	}
+}
+
+const unsigned int& Framebuffer::GetRendererID() const
+{
+	return mRendererID;
+}
+
+const unsigned int& Framebuffer::GetWidth() const
+{
+	return mWidth;
+}
+
+const unsigned int& Framebuffer::GetHeight() const
+{
+	return mHeight;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+// Offscreen render target: RGBA8 color and 24 bit depth renderbuffers. Used instead of the default framebuffer
+// when there is no visible window (headless benchmarks).
+class Framebuffer
+{
+public:
+
+	Framebuffer(const unsigned int& width, const unsigned int& height);
+	~Framebuffer();
+
+	Framebuffer(const Framebuffer&) = delete;
+	Framebuffer& operator=(const Framebuffer&) = delete;
+
+	void Bind() const; // also sets the viewport to the framebuffer size
+	void Unbind() const;
+
+	void ReadPixels(std::vector<unsigned char>& output) const; // RGBA, bottom row first
+	void WritePPM(const std::string& filePath) const;
+
+	const unsigned int& GetRendererID() const;
+	const unsigned int& GetWidth() const;
+	const unsigned int& GetHeight() const;
+
+private:
+
+	unsigned int mRendererID = 0;
+	unsigned int mColorBuffer = 0;
+	unsigned int mDepthBuffer = 0;
+
+	unsigned int mWidth;
+	unsigned int mHeight;
+
+};
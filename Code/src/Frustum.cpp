@@ -0,0 +1,103 @@
+#include "Frustum.h"
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+Frustum::Frustum()
+	:
+	Frustum(glm::mat4(1.0f))
+{
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	Update(viewProjection);
+}
+
+/// <summary>
+/// Extracts the planes from the combined matrix (Gribb/Hartmann); normals point inside the frustum
+/// </summary>
+/// <param name="viewProjection">projection * view</param>
+/// 
+void Frustum::Update(const glm::mat4& viewProjection)
+{
+	glm::mat4 m = glm::transpose(viewProjection); // rows of viewProjection
+
+	glm::vec4 planes[6] =
+	{
+		m[3] + m[0], // left
+		m[3] - m[0], // right
+		m[3] + m[1], // bottom
+		m[3] - m[1], // top
+		m[3] + m[2], // near
+		m[3] - m[2]  // far
+	};
+
+	for (int i = 0; i < 8; i++)
+	{
+		// padding planes always pass (0 * x + 1 >= 0)
+		glm::vec4 plane = (i < 6) ? planes[i] / glm::length(glm::vec3(planes[i])) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+		mPlaneX[i] = plane.x;
+		mPlaneY[i] = plane.y;
+		mPlaneZ[i] = plane.z;
+		mPlaneW[i] = plane.w;
+	}
+}
+
+FrustumTestResult Frustum::TestAABB(const AABB& box) const
+{
+	glm::vec3 center = box.GetCenter();
+	glm::vec3 extents = box.GetExtents();
+
+#ifdef FRUSTUM_USE_SSE
+	const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+	const __m128 ex = _mm_set1_ps(extents.x), ey = _mm_set1_ps(extents.y), ez = _mm_set1_ps(extents.z);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	bool intersects = false;
+
+	for (int i = 0; i < 8; i += 4)
+	{
+		__m128 px = _mm_load_ps(mPlaneX + i);
+		__m128 py = _mm_load_ps(mPlaneY + i);
+		__m128 pz = _mm_load_ps(mPlaneZ + i);
+		__m128 pw = _mm_load_ps(mPlaneW + i);
+
+		// signed distance of the center
+		__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)), _mm_add_ps(_mm_mul_ps(pz, cz), pw));
+
+		// projected radius of the box onto the plane normal
+		__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, px), ex), _mm_mul_ps(_mm_andnot_ps(signMask, py), ey)), _mm_mul_ps(_mm_andnot_ps(signMask, pz), ez));
+
+		if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), zero)) != 0)
+			return FRUSTUM_OUTSIDE;
+
+		if (_mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(distance, radius), zero)) != 0)
+			intersects = true;
+	}
+
+	return intersects ? FRUSTUM_INTERSECTS : FRUSTUM_INSIDE;
+#else
+	bool intersects = false;
+
+	for (int i = 0; i < 6; i++)
+	{
+		float distance = mPlaneX[i] * center.x + mPlaneY[i] * center.y + mPlaneZ[i] * center.z + mPlaneW[i];
+		float radius = std::fabs(mPlaneX[i]) * extents.x + std::fabs(mPlaneY[i]) * extents.y + std::fabs(mPlaneZ[i]) * extents.z;
+
+		if (distance + radius < 0.0f)
+			return FRUSTUM_OUTSIDE;
+
+		if (distance - radius < 0.0f)
+			intersects = true;
+	}
+
+	return intersects ? FRUSTUM_INTERSECTS : FRUSTUM_INSIDE;
+#endif
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "BoundingBox.h"
+
+enum FrustumTestResult
+{
+	FRUSTUM_OUTSIDE = 0,
+	FRUSTUM_INTERSECTS = 1,
+	FRUSTUM_INSIDE = 2
+};
+
+class Frustum
+{
+public:
+
+	Frustum();
+	Frustum(const glm::mat4& viewProjection);
+
+	void Update(const glm::mat4& viewProjection);
+
+	FrustumTestResult TestAABB(const AABB& box) const;
+
+private:
+
+	// 6 planes stored as structure of arrays (padded to 8), so 4 planes are tested at once with SSE
+	alignas(16) float mPlaneX[8];
+	alignas(16) float mPlaneY[8];
+	alignas(16) float mPlaneZ[8];
+	alignas(16) float mPlaneW[8];
+
+};
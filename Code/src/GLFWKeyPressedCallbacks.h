@@ -2,12 +2,14 @@
 
 #include <GLFW/glfw3.h>
 
-Camera* pCallbackCamera = nullptr;
+#include "Profiler.h"
 
-Shader* pCallbackShader = nullptr;
+Camera* pCallbackCamera = nullptr;
 
 unsigned int currentSelectedBone = 0;
 
+bool debugBoneView = false;
+
 unsigned int* pCallbackCurrentSelectedAnimation = nullptr;
 
 MeshV2* pCallbackActiveMesh = nullptr;
@@ -15,6 +17,8 @@ MeshV2* pCallbackActiveMesh = nullptr;
 float* pCallbackBlendFactor = nullptr;
 float blendFactorMultiplier = 1.0f;
 
+std::string profileTracePath = "profile_trace.json"; // set to a path next to the executable in main
+
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
@@ -24,9 +28,12 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
             currentSelectedBone = 0;
 
         printf("Currently selected bone index: %u\n", currentSelectedBone);
+    }
+    else if (key == GLFW_KEY_V && action == GLFW_PRESS)
+    {
+        debugBoneView = !debugBoneView;
 
-        if (pCallbackShader)
-            pCallbackShader->SetUniform1i("uDisplayBoneIndex", currentSelectedBone);
+        printf("Bone debug view: %s\n", debugBoneView ? "on" : "off");
     }
     else if (key == GLFW_KEY_ENTER && action == GLFW_PRESS)
     {
@@ -77,6 +84,19 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
             blendFactorMultiplier *= -1.0f;
         }
     }
+    else if (key == GLFW_KEY_P && action == GLFW_PRESS)
+    {
+        if (!Profiler::IsCapturing())
+        {
+            printf("Profiler capture started\n");
+            Profiler::BeginCapture();
+        }
+        else
+        {
+            Profiler::EndCapture();
+            Profiler::WriteChromeTrace(profileTracePath);
+        }
+    }
     else if (key == GLFW_KEY_N && action == GLFW_PRESS)
     {
         (*pCallbackCurrentSelectedAnimation)++;
@@ -3,6 +3,7 @@
 #include <GL/glew.h>
 
 #include "Debug.h"
+#include "Profiler.h"
 
 #define INITIAL_BUFFER_SIZE 4 * 1024 * 1024; // 4 in bytes
 
@@ -37,6 +38,8 @@ IndexBuffer::~IndexBuffer()
 
 void IndexBuffer::FillBuffer(const void* data, const unsigned int& count, const unsigned int& usage)
 {
+	PROFILE_SCOPE("IndexBuffer::FillBuffer");
+
 	AdjustBufferSize(count * sizeof(unsigned int), usage);
 
 	InsertDataWithOffset(data, count, 0);
@@ -100,7 +103,7 @@ void IndexBuffer::AdjustBufferSize(const unsigned int& newSize, const unsigned i
 
 	if (mBufferCapacity == 0)
 	{
-		mBufferCapacity = INITIAL_BUFFER_SIZE;
+		mBufferCapacity = (mInitialCapacity != 0) ? mInitialCapacity : INITIAL_BUFFER_SIZE;
 		sizeChanged = true;
 	}
 
@@ -128,6 +131,16 @@ void IndexBuffer::AdjustBufferSize(const unsigned int& newSize, const unsigned i
 	}
 }
 
+/// <summary>
+/// 
+/// </summary>
+/// <param name="capacity">In bytes; ignored once the buffer is allocated</param>
+/// 
+void IndexBuffer::SetInitialCapacity(const unsigned int& capacity)
+{
+	mInitialCapacity = capacity;
+}
+
 void IndexBuffer::Bind() const
 {
 	if (mCount == 0)
@@ -13,6 +13,7 @@ public:
 	unsigned int AppendData(const void* data, const unsigned int& count);
 
 	void AdjustBufferSize(const unsigned int& newSize, const unsigned int& usage);
+	void SetInitialCapacity(const unsigned int& capacity); // size of the first allocation; in bytes (0 = INITIAL_BUFFER_SIZE)
 
 	void Bind() const;
 	void Unbind() const;
@@ -30,6 +31,7 @@ private:
 	unsigned int mUsage;
 
 	unsigned int mCount = 0;
+	unsigned int mInitialCapacity = 0; // in bytes
 	unsigned int mBufferCapacity = 0; // free space + used up space (= initial size); in bytes
 	unsigned int mBufferSize = 0; // used up space; in bytes
 };
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "InstanceGroup.h"
+
+#include "Debug.h"
+#include "Transform.h"
+#include "MeshV2.h"
+#include "Objekt.h"
+#include "Profiler.h"
+
+void InstanceData::SetModel(const glm::mat4& model)
+{
+	mModel = model;
+
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+
+	for (int i = 0; i < 3; i++)
+	{
+		mNormalMatrix[i] = glm::vec4(normalMatrix[i], 0.0f);
+	}
+}
+
+InstanceGroup::InstanceGroup(const VertexBuffer& meshVB, const unsigned int& vertexStride, const IndexBuffer& meshIB, const VertexBufferLayout& meshLayout, const bool& skinned)
+	:
+	mMeshVB(meshVB),
+	mMeshIB(meshIB),
+	mVertexStride(vertexStride),
+	mSkinned(skinned)
+{
+	// model matrix, normal matrix and bone offset, same order as InstanceData
+	VertexBufferLayout instanceLayout;
+	instanceLayout.Push<float>(4);
+	instanceLayout.Push<float>(4);
+	instanceLayout.Push<float>(4);
+	instanceLayout.Push<float>(4);
+	instanceLayout.Push<float>(4);
+	instanceLayout.Push<float>(4);
+	instanceLayout.Push<float>(4);
+	instanceLayout.Push<unsigned int>(1);
+
+	mVAO.SetLayout(meshLayout, false);
+	mVAO.SetDrawingMode(GL_TRIANGLES);
+	mVAO.SetUsage(GL_STATIC_DRAW);
+	mVAO.AddBuffer(mMeshVB, mMeshIB);
+	mVAO.AddInstanceBuffer(instanceLayout, INSTANCE_BINDING_INDEX, INSTANCE_ATTRIBUTE_LOCATION);
+
+	glGenBuffers(1, &mBonePaletteID);
+}
+
+InstanceGroup::InstanceGroup(const MeshV2& mesh)
+	:
+	InstanceGroup(mesh.GetVB(), sizeof(VertexV2), mesh.GetIB(), mesh.GetVAO().GetLayout(), true)
+{
+}
+
+InstanceGroup::InstanceGroup(const Objekt& obj)
+	:
+	InstanceGroup(obj.GetMesh().GetVB(), sizeof(Vertex), obj.GetMesh().GetIB(), obj.GetVAO().GetLayout(), false)
+{
+}
+
+InstanceGroup::~InstanceGroup()
+{
+	glDeleteBuffers(1, &mBonePaletteID);
+}
+
+unsigned int InstanceGroup::AddInstance(const glm::mat4& model, const unsigned int& boneOffset)
+{
+	InstanceData data;
+	data.SetModel(model);
+	data.mBoneOffset = boneOffset;
+
+	mInstances.push_back(data);
+	mInstancesDirty = true;
+
+	return mInstances.size() - 1;
+}
+
+void InstanceGroup::SetInstanceTransform(const unsigned int& instanceIndex, const glm::mat4& model)
+{
+	if (instanceIndex >= mInstances.size())
+		Debug::ThrowException("Instance index out of range! (index = " + STRING(instanceIndex) + ")");
+
+	mInstances[instanceIndex].SetModel(model);
+	mInstancesDirty = true;
+}
+
+void InstanceGroup::SetInstanceBoneOffset(const unsigned int& instanceIndex, const unsigned int& boneOffset)
+{
+	if (instanceIndex >= mInstances.size())
+		Debug::ThrowException("Instance index out of range! (index = " + STRING(instanceIndex) + ")");
+
+	mInstances[instanceIndex].mBoneOffset = boneOffset;
+	mInstancesDirty = true;
+}
+
+/// <summary>
+/// Marks the range as modified and returns it; the pointer is valid until instances are added or cleared
+/// </summary>
+/// 
+InstanceData* InstanceGroup::MapInstances(const unsigned int& first, const unsigned int& count)
+{
+	if (first + count > mInstances.size())
+		Debug::ThrowException("Instance range out of range! (first = " + STRING(first) + ", count = " + STRING(count) + ")");
+
+	mInstancesDirty = true;
+
+	return mInstances.data() + first;
+}
+
+void InstanceGroup::ClearInstances()
+{
+	mInstances.clear();
+	mInstancesDirty = true;
+}
+
+/// <summary>
+/// Appends a bone palette which can be shared by any number of instances
+/// </summary>
+/// <param name="bones">Final bone transformations (as returned by MeshV2::GetBoneTransforms)</param>
+/// <returns>Bone offset to be passed to AddInstance/SetInstanceBoneOffset</returns>
+/// 
+unsigned int InstanceGroup::AddBonePalette(const std::vector<aiMatrix4x4>& bones)
+{
+	unsigned int offset = mBonePalette.size();
+
+	mBonePalette.resize(offset + bones.size());
+	UpdateBonePalette(offset, bones);
+
+	return offset;
+}
+
+void InstanceGroup::UpdateBonePalette(const unsigned int& boneOffset, const std::vector<aiMatrix4x4>& bones)
+{
+	if (boneOffset + bones.size() > mBonePalette.size())
+		Debug::ThrowException("Bone palette out of range! (offset = " + STRING(boneOffset) + ")");
+
+	for (unsigned int i = 0; i < bones.size(); i++)
+	{
+		mBonePalette[boneOffset + i] = Transform::aiMatrix4x4ToGlm(&bones[i]);
+	}
+
+	mBonePaletteDirty = true;
+}
+
+unsigned int InstanceGroup::GetInstanceCount() const
+{
+	return mInstances.size();
+}
+
+const bool& InstanceGroup::IsSkinned() const
+{
+	return mSkinned;
+}
+
+void InstanceGroup::Draw(Shader& shader)
+{
+	PROFILE_SCOPE("InstanceGroup::Draw");
+	PROFILE_GPU_SCOPE("InstanceGroup::Draw");
+
+	if (mInstances.empty())
+		return;
+
+	UploadInstances();
+	UploadBonePalette();
+
+	if (mHandleShaderID != shader.GetRendererID())
+	{
+		mSkinnedHandle = shader.GetUniformHandle<int>("uSkinned");
+		mHandleShaderID = shader.GetRendererID();
+	}
+
+	shader.Bind();
+	shader.SetUniform(mSkinnedHandle, mSkinned ? 1 : 0);
+
+	mVAO.Bind();
+	mMeshVB.Bind(0, mVertexStride);
+	mInstanceVBO.Bind<InstanceData>(INSTANCE_BINDING_INDEX);
+	mMeshIB.Bind();
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BONE_PALETTE_BINDING, mBonePaletteID);
+
+	glDrawElementsInstanced(mVAO.GetDrawingMode(), mMeshIB.GetIndicesCount(), GL_UNSIGNED_INT, nullptr, mInstances.size());
+}
+
+void InstanceGroup::UploadInstances()
+{
+	if (!mInstancesDirty)
+		return;
+
+	mInstanceVBO.FillBuffer(mInstances.data(), mInstances.size() * sizeof(InstanceData), GL_STATIC_DRAW);
+
+	mInstancesDirty = false;
+}
+
+void InstanceGroup::UploadBonePalette()
+{
+	if (!mBonePaletteDirty && mBonePaletteCapacity != 0)
+		return;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mBonePaletteID);
+
+	// the palette must never be empty, otherwise the (unsized) shader array has nothing to read from
+	unsigned int count = mBonePalette.empty() ? 1 : mBonePalette.size();
+
+	if (count > mBonePaletteCapacity)
+	{
+		mBonePaletteCapacity = count;
+		glBufferData(GL_SHADER_STORAGE_BUFFER, mBonePaletteCapacity * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	if (!mBonePalette.empty())
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, mBonePalette.size() * sizeof(glm::mat4), mBonePalette.data());
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	mBonePaletteDirty = false;
+}
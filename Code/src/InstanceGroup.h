@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <assimp/matrix4x4.h>
+
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+#include "Shader.h"
+
+class MeshV2;
+class Objekt;
+
+#define INSTANCE_BINDING_INDEX 1 // vertex buffer binding index used for the per-instance buffer
+#define INSTANCE_ATTRIBUTE_LOCATION 6 // first attribute location of the per-instance data (see instanced.glsl)
+#define BONE_PALETTE_BINDING 0 // shader storage binding of the bone palette buffer
+
+struct InstanceData
+{
+	glm::mat4 mModel{ 1.0f };
+	glm::vec4 mNormalMatrix[3] = { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f } }; // columns, w unused
+	unsigned int mBoneOffset = 0; // index of the first bone matrix of this instance inside the bone palette
+	unsigned int mPadding[3] = { 0 };
+
+	void SetModel(const glm::mat4& model); // also computes the normal matrix, once per instance instead of once per vertex
+};
+
+// Draws many copies of one mesh with a single glDrawElementsInstanced call.
+// Vertex and index data are borrowed from the mesh (stored only once), only the
+// per-instance data (model matrix + bone palette offset) lives in the group.
+class InstanceGroup
+{
+public:
+
+	InstanceGroup(const VertexBuffer& meshVB, const unsigned int& vertexStride, const IndexBuffer& meshIB, const VertexBufferLayout& meshLayout, const bool& skinned);
+	InstanceGroup(const MeshV2& mesh);
+	InstanceGroup(const Objekt& obj);
+	~InstanceGroup();
+
+	unsigned int AddInstance(const glm::mat4& model, const unsigned int& boneOffset = 0);
+	void SetInstanceTransform(const unsigned int& instanceIndex, const glm::mat4& model);
+	void SetInstanceBoneOffset(const unsigned int& instanceIndex, const unsigned int& boneOffset);
+	InstanceData* MapInstances(const unsigned int& first, const unsigned int& count); // for writing many instances at once
+	void ClearInstances();
+
+	unsigned int AddBonePalette(const std::vector<aiMatrix4x4>& bones);
+	void UpdateBonePalette(const unsigned int& boneOffset, const std::vector<aiMatrix4x4>& bones);
+
+	unsigned int GetInstanceCount() const;
+	const bool& IsSkinned() const;
+
+	void Draw(Shader& shader);
+
+private:
+
+	void UploadInstances();
+	void UploadBonePalette();
+
+	VertexArray mVAO;
+	VertexBuffer mInstanceVBO;
+
+	const VertexBuffer& mMeshVB;
+	const IndexBuffer& mMeshIB;
+	unsigned int mVertexStride;
+
+	bool mSkinned;
+	bool mInstancesDirty = false;
+	bool mBonePaletteDirty = false;
+
+	std::vector<InstanceData> mInstances;
+	std::vector<glm::mat4> mBonePalette;
+	unsigned int mBonePaletteID = 0;
+	unsigned int mBonePaletteCapacity = 0; // in matrices
+
+	unsigned int mHandleShaderID = 0; // shader for which mSkinnedHandle was resolved
+	UniformHandle<int> mSkinnedHandle;
+
+};
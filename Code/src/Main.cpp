@@ -15,6 +15,7 @@
 #include <string>
 
 #include "Shader.h"
+#include "ShaderVariants.h"
 #include "VertexArray.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
@@ -29,33 +30,109 @@
 #include "Camera.h"
 
 #include "FpsManager.h"
+#include "FramePacer.h"
 #include "OpenGLDebugMessageCallback.h"
 #include "GLFWKeyPressedCallbacks.h"
 #include "Parser.h"
 #include "Debug.h"
+#include "Benchmark.h"
+#include "FramePipeline.h"
+#include "Profiler.h"
+#include "Framebuffer.h"
+#include "SplineStream.h"
+#include "BinaryPointFile.h"
+#include "TimeControl.h"
 
 // change directory to yours
 
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
 
-GLFWwindow* InitWindow();
+#define HEADLESS_FRAME_COUNT 300
+#define HEADLESS_TIMESTEP (1.0f / 60.0f)
+
+GLFWwindow* InitWindow(const bool& headless = false, const std::string& contextApi = "native");
+bool HasArgument(int argc, char* argv[], const std::string& name);
+std::string GetArgument(int argc, char* argv[], const std::string& name, const std::string& defaultValue);
 
 int main(int argc, char* argv[])
 {
     std::string ExePath = argv[0];
     ExePath = ExePath.substr(0, ExePath.find_last_of('\\'));
+    profileTracePath = ExePath + "\\profile_trace.json";
 
-    GLFWwindow* window = InitWindow();
+    // runs entirely on the CPU, so no window is needed
+    if (argc > 1 && std::string(argv[1]) == "--bench-occlusion")
+    {
+        Benchmark::OcclusionCulling(ExePath + "\\occlusion_depth.pgm");
+        return 0;
+    }
 
-    Shader shader(ExePath + "\\Shaders\\general.glsl");
+    // usage: --bench-parser <control point file> [--generate-mb N] (writes a random file of N MB first)
+    if (argc > 2 && std::string(argv[1]) == "--bench-parser")
+    {
+        Benchmark::ParseControlPoints(argv[2], std::stoul(GetArgument(argc, argv, "--generate-mb", "0")));
+        return 0;
+    }
 
-    pCallbackShader = &shader;
+    // converts a text control point file to the binary format Parser::ReadFile also accepts
+    // usage: --convert-points <text file> <binary file> [--precision 32|64]
+    if (argc > 3 && std::string(argv[1]) == "--convert-points")
+    {
+        PointPrecision precision = GetArgument(argc, argv, "--precision", "32") == "64" ? POINT_PRECISION_FLOAT64 : POINT_PRECISION_FLOAT32;
 
-    // Objekt obj("FirstObject", ExePath + "\\Models\\Character.fbx", shader);
+        TimeControl timer;
+        timer.Start();
+
+        size_t pointCount = BinaryPointFile::ConvertText(argv[2], argv[3], precision);
+
+        printf("%zu points converted in %.3f s\n", pointCount, timer.End());
+        return 0;
+    }
+
+    // evaluates a control point file of any size chunk by chunk into a binary sample file, no window is needed
+    // usage: --stream-spline <control point file> [--samples N] [--output path]
+    if (argc > 2 && std::string(argv[1]) == "--stream-spline")
+    {
+        unsigned int samplesPerSegment = std::stoul(GetArgument(argc, argv, "--samples", STRING(SPLINE_STREAM_SAMPLES_PER_SEGMENT)));
+        SplineStream::Run(argv[2], GetArgument(argc, argv, "--output", ExePath + "\\spline_samples.bin"), samplesPerSegment);
+        return 0;
+    }
+
+    // --headless draws a fixed number of frames into an offscreen framebuffer behind a hidden window and exits;
+    // --context egl/osmesa picks the context creation API (osmesa gives Mesa's software rasterizer on machines without a GPU)
+    bool headless = HasArgument(argc, argv, "--headless");
+
+    GLFWwindow* window = InitWindow(headless, GetArgument(argc, argv, "--context", "native"));
+
+    ShaderVariants shaderVariants(ExePath + "\\Shaders\\general.glsl");
 
     MeshV2 mesh(ExePath + "\\Models\\Character.fbx");
     pCallbackActiveMesh = &mesh;
+
+    // production variant only pays for the bone influences the mesh uses; bone debug view is a separate variant
+    // usage: [--lighting unlit|lambert|phong]
+    ShaderVariantKey variantKey;
+    variantKey.mBoneInfluences = ShaderVariants::MinimalBoneInfluences(mesh.GetMaxBoneInfluences());
+
+    std::string lighting = GetArgument(argc, argv, "--lighting", "phong");
+    if (lighting == "unlit")
+        variantKey.mLighting = LIGHTING_UNLIT;
+    else if (lighting == "lambert")
+        variantKey.mLighting = LIGHTING_LAMBERT;
+    else if (lighting != "phong")
+        Debug::Print("Unknown lighting model '" + lighting + "', using phong");
+
+    ShaderVariantKey debugVariantKey = variantKey;
+    debugVariantKey.mDebugBoneView = true;
+
+    Shader& shader = shaderVariants.Get(variantKey);
+    UniformHandle<int> displayBoneHandle;
+
+    // the debug variant is compiled in the background; frames are drawn with the production variant until it is ready
+    shaderVariants.Request(debugVariantKey);
+
+    // Objekt obj("FirstObject", ExePath + "\\Models\\Character.fbx", shader);
     
     Renderer renderer(shader);
 
@@ -64,21 +141,94 @@ int main(int argc, char* argv[])
     Camera camera;
     pCallbackCamera = &camera;
 
-    camera.SetShader("view", &shader);
+    camera.SetShader("Camera", &shader);
 
     camera.SetPosition({ 0.0f, -1.0f, -3.0f });
 
     Transform projection(glm::perspective(45.0f, 1.0f, 0.1f, 1000.0f));
 
+    camera.SetProjection(projection.GetMatrix());
+
     shader.Bind();
-    shader.SetUniformMatrix4f("projection", projection.GetMatrix());
 
-    shader.SetUniform1i("uDisplayBoneIndex", 0);
-    shader.SetUniform3fv("uLightColor", {0.9f, 0.95f, 1.0f});
+    // uniform locations are resolved once, the frame loop only sets values
+    const glm::vec3 lightColor = { 0.9f, 0.95f, 1.0f };
+    shader.SetUniform(shader.GetUniformHandle<glm::vec3>("uLightColor"), lightColor);
+
+    if (headless)
+    {
+        unsigned int frameCount = std::stoul(GetArgument(argc, argv, "--frames", STRING(HEADLESS_FRAME_COUNT)));
+        unsigned int dumpInterval = std::stoul(GetArgument(argc, argv, "--dump-every", "0"));
+
+        Framebuffer target(WINDOW_WIDTH, WINDOW_HEIGHT);
+        std::vector<aiMatrix4x4> boneTransforms;
+
+        Benchmark::OffscreenFrames(target, frameCount, dumpInterval, ExePath + "\\offscreen_frame", [&](const unsigned int& frame)
+        {
+            // fixed time step, so every run draws the same poses
+            mesh.GetBoneTransoformsBlending(frame * HEADLESS_TIMESTEP, boneTransforms, 0, 1, 0.5f);
+            mesh.UploadBoneTransforms(boneTransforms);
+            mesh.Draw(shader);
+        });
+
+        glfwTerminate();
+        return 0;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--bench-instancing")
+    {
+        Shader instancedShader(ExePath + "\\Shaders\\instanced.glsl");
+
+        Benchmark::InstancedDraws(window, mesh, shader, instancedShader);
+
+        glfwTerminate();
+        return 0;
+    }
+
+    // usage: --bench-renderer [--objects N]
+    if (argc > 1 && std::string(argv[1]) == "--bench-renderer")
+    {
+        Objekt object("BenchmarkObject", ExePath + "\\Models\\Character.fbx", shader);
+
+        Benchmark::RendererDraw(window, object, shader, std::stoul(GetArgument(argc, argv, "--objects", "20000")));
+
+        glfwTerminate();
+        return 0;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--bench-path-following")
+    {
+        Benchmark::PathFollowing(mesh, std::stoul(GetArgument(argc, argv, "--instances", "10000")));
+
+        glfwTerminate();
+        return 0;
+    }
+
+    // usage: --bench-spline-drawing [--curves N]
+    if (argc > 1 && std::string(argv[1]) == "--bench-spline-drawing")
+    {
+        // line strips of CPU sampled curves only need the positions, no skinning or lighting
+        ShaderVariantKey lineKey;
+        lineKey.mBoneInfluences = 0;
+        lineKey.mLighting = LIGHTING_UNLIT;
+
+        Shader tessellationShader(ExePath + "\\Shaders\\spline.glsl");
+
+        Benchmark::SplineDrawing(window, shaderVariants.Get(lineKey), tessellationShader, std::stoul(GetArgument(argc, argv, "--curves", "1000")));
+
+        glfwTerminate();
+        return 0;
+    }
 
-    FpsManager fpsManager(60);
-    TimeControl timer;
-    timer.Start();
+    if (argc > 1 && std::string(argv[1]) == "--bench-spline-queries")
+    {
+        Benchmark::SplineQueries(std::stoul(GetArgument(argc, argv, "--queries", "100000")));
+
+        glfwTerminate();
+        return 0;
+    }
+
+    FramePacer framePacer(60);
     double startTime = 0.0;
     double timePassed = 0.0;
 
@@ -90,12 +240,23 @@ int main(int argc, char* argv[])
 
     float timeBetweenPoints = 0.016f; // in seconds
 
-    std::vector<aiMatrix4x4> boneTransforms;
+    // animation of frame N + 1 is computed on the simulation thread while frame N is drawn here
+    FramePipeline framePipeline([&mesh](const SimulationInput& input, SimulationFrame& frame)
+    {
+        static thread_local std::vector<aiMatrix4x4> boneTransforms;
+
+        mesh.GetBoneTransoformsBlending(input.mTime, boneTransforms, input.mStartAnimation, input.mEndAnimation, input.mBlendFactor);
+        MeshV2::ToBonePalette(boneTransforms, frame.mBonePalette);
+    });
+
+    framePipeline.Submit({ timePassed, selectedAnimation, (selectedAnimation + 1) % 3, blendingFactor });
 
     /* Loop until the user closes the window */
     while (!glfwWindowShouldClose(window))
     {
-        fpsManager.Begin();
+        framePacer.BeginFrame();
+
+        PROFILE_SCOPE("Frame");
 
         /* Render here */
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -112,39 +273,73 @@ int main(int argc, char* argv[])
             // std::cout << "Position = " << Debug::GlmString(transform.GetPosition()).c_str() << "; Rotation = " << Debug::GlmString(transform.GetOrientation()) << std::endl;
         }
 
+        // renderer.SetViewProjection(camera.GetViewProjection());
         // renderer.Draw();
 
-        timePassed += timer.End();
+        // animation advances in fixed steps, independent of the frame rate
+        while (framePacer.StepSimulation())
+        {
+            timePassed += framePacer.GetFixedTimestep();
+        }
 
         // Debug::Print("Time passed: " + STRING(timePassed));
 
-        mesh.GetBoneTransoformsBlending(timePassed, boneTransforms, selectedAnimation, (selectedAnimation + 1) % 3, blendingFactor);
-        for (int i = 0; i < boneTransforms.size(); i++)
+        framePipeline.Submit({ timePassed, selectedAnimation, (selectedAnimation + 1) % 3, blendingFactor });
+
+        // the palette is copied into the bones uniform block, so the slot can go straight back to the simulation
+        const SimulationFrame& frame = framePipeline.AcquireFrame();
+        mesh.UploadBonePalette(frame.mBonePalette);
+        framePipeline.ReleaseFrame();
+
+        shaderVariants.Poll();
+
+        if (debugBoneView)
         {
-            shader.SetUniformMatrix4f("uBones[" + STRING(i) + "]", Transform::aiMatrix4x4ToGlm(&boneTransforms[i]));
-        }
+            // production variant is used until the debug variant has finished compiling
+            Shader& debugShader = shaderVariants.GetReadyOrFallback(debugVariantKey, variantKey);
 
-        mesh.Draw(shader);
+            if (&debugShader != &shader && !displayBoneHandle.IsValid())
+            {
+                debugShader.SetUniform(debugShader.GetUniformHandle<glm::vec3>("uLightColor"), lightColor);
+                displayBoneHandle = debugShader.GetUniformHandle<int>("uDisplayBoneIndex");
+            }
+
+            debugShader.SetUniform(displayBoneHandle, (int)currentSelectedBone);
+            mesh.Draw(debugShader);
+        }
+        else
+        {
+            mesh.Draw(shader);
+        }
 
         /* Swap front and back buffers */
         glfwSwapBuffers(window);
 
-        timer.Start();
+        Profiler::EndFrame();
 
-        do 
-        {
-            /* Poll for and process events */
-            glfwPollEvents();
-        } while (!fpsManager.TimeToGo()); // should eventually replace while loop with sleep
+        // sleeps until the next frame is due instead of polling events in a loop
+        framePacer.Wait();
+
+        /* Poll for and process events */
+        glfwPollEvents();
 
-        // std::cout << "FPS: " << fpsManager.GetCurrentFps() << std::endl;
+        // std::cout << "FPS: " << framePacer.GetCurrentFps() << std::endl;
+    }
+
+    framePipeline.Stop();
+    framePacer.PrintStats();
+
+    if (Profiler::IsCapturing())
+    {
+        Profiler::EndCapture();
+        Profiler::WriteChromeTrace(profileTracePath);
     }
 
     glfwTerminate();
     return 0;
 }
 
-GLFWwindow* InitWindow()
+GLFWwindow* InitWindow(const bool& headless, const std::string& contextApi)
 {
     GLFWwindow* window;
     /* Initialize the library */
@@ -156,6 +351,17 @@ GLFWwindow* InitWindow()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
 
+    // the window only provides the context, headless frames go to a Framebuffer
+    if (headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    if (contextApi == "egl")
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    else if (contextApi == "osmesa")
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    else if (contextApi != "native")
+        printf("WARNING: Unknown context API '%s', using the native one\n", contextApi.c_str());
+
     /* Create a windowed mode window and its OpenGL context */
     window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Hello World", NULL, NULL);
     if (!window)
@@ -172,12 +378,17 @@ GLFWwindow* InitWindow()
 
     // glfwSwapInterval(1);
 
+    if (headless)
+        glfwSwapInterval(0);
+
     if (glewInit() != GLEW_OK)
     {
         std::cout << "ERROR: GLEW unable to be initialized!" << std::endl;
         exit(-1);
     }
 
+    Shader::EnableParallelCompilation();
+
     glEnable(GL_DEBUG_OUTPUT);
     glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
     glDebugMessageCallback(MessageCallback, NULL);
@@ -187,4 +398,27 @@ GLFWwindow* InitWindow()
     glEnable(GL_DEPTH_TEST);
 
     return window;
-}
\ No newline at end of file
+}
+
+bool HasArgument(int argc, char* argv[], const std::string& name)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (name == argv[i])
+            return true;
+    }
+
+    return false;
+}
+
+// value of "name value" on the command line
+std::string GetArgument(int argc, char* argv[], const std::string& name, const std::string& defaultValue)
+{
+    for (int i = 1; i < argc - 1; i++)
+    {
+        if (name == argv[i])
+            return argv[i + 1];
+    }
+
+    return defaultValue;
+}
@@ -0,0 +1,113 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filePath)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER size;
+
+	if (!GetFileSizeEx(file, &size) || (unsigned long long)size.QuadPart > SIZE_MAX)
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	// nothing to map in an empty file
+	if (size.QuadPart == 0)
+		mMapped = true;
+	else
+	{
+		mSize = (size_t)size.QuadPart;
+		mMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		// a 32 bit process can fail to find enough address space for large files
+		if (mMapping)
+			mData = (const char*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+
+		mMapped = mData != nullptr;
+	}
+
+	CloseHandle(file);
+#else
+	int file = open(filePath.c_str(), O_RDONLY);
+
+	if (file < 0)
+		return;
+
+	struct stat status;
+
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		return;
+	}
+
+	if (status.st_size == 0)
+		mMapped = true;
+	else
+	{
+		void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (data != MAP_FAILED)
+		{
+			mData = (const char*)data;
+			mSize = status.st_size;
+			mMapped = true;
+
+			// read in big steps, every page is needed
+			madvise(data, mSize, MADV_WILLNEED);
+		}
+	}
+
+	close(file);
+#endif
+
+	if (!mMapped)
+	{
+		mData = nullptr;
+		mSize = 0;
+	}
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (mData)
+		UnmapViewOfFile(mData);
+
+	if (mMapping)
+		CloseHandle(mMapping);
+#else
+	if (mData)
+		munmap((void*)mData, mSize);
+#endif
+}
+
+bool MappedFile::IsMapped() const
+{
+	return mMapped;
+}
+
+const char* MappedFile::GetData() const
+{
+	return mData;
+}
+
+const size_t& MappedFile::GetSize() const
+{
+	return mSize;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are loaded by the OS on first access, so several threads
+// can read different parts of a large file without copying it into a buffer first.
+class MappedFile
+{
+public:
+
+	MappedFile(const std::string& filePath);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsMapped() const; // false if the file couldn't be opened or mapped (an empty file is mapped, with no data)
+
+	const char* GetData() const;
+	const size_t& GetSize() const;
+
+private:
+
+	const char* mData = nullptr;
+	size_t mSize = 0;
+	bool mMapped = false;
+
+	void* mMapping = nullptr; // file mapping handle on Windows
+
+};
@@ -102,3 +102,8 @@ const Transform& Mesh::GetTransform() const
 {
     return mTransformMatrix;
 }
+
+AABB Mesh::GetBoundingBox() const
+{
+    return { {mBoundingBox[0].min, mBoundingBox[1].min, mBoundingBox[2].min}, {mBoundingBox[0].max, mBoundingBox[1].max, mBoundingBox[2].max} };
+}
@@ -7,11 +7,12 @@
 #include "Vertex.h"
 
 #include "Transform.h"
+#include "BoundingBox.h"
 
 struct MinMax
 {
 	double min = std::numeric_limits<double>::max();
-	double max = std::numeric_limits<double>::min();
+	double max = std::numeric_limits<double>::lowest();
 };
 
 class Mesh
@@ -28,6 +29,7 @@ public:
 	const std::vector<unsigned int> GetIndices() const;
 
 	const Transform& GetTransform() const;
+	AABB GetBoundingBox() const;
 	
 private:
 
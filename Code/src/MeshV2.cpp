@@ -2,13 +2,18 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+
+#include "Profiler.h"
+
 MeshV2::MeshV2()
 {
 }
 
-MeshV2::MeshV2(const std::string& filePath)
+MeshV2::MeshV2(const std::string& filePath, const bool& headless)
 	:
-	mFilePath(filePath)
+	mFilePath(filePath),
+	mHeadless(headless)
 {
     Initialize();
 }
@@ -21,6 +26,27 @@ void MeshV2::Initialize()
 	Init(mFilePath);
 }
 
+bool MeshV2::IsHeadless() const
+{
+    return mHeadless;
+}
+
+void MeshV2::SetHeadless(const bool& headless)
+{
+    if (mPScene != nullptr)
+        Debug::ThrowException("MeshV2 => Headless mode has to be set before the mesh is loaded!");
+
+    mHeadless = headless;
+}
+
+MeshV2::GpuResources& MeshV2::GetGpuResources() const
+{
+    if (mGpu == nullptr)
+        Debug::ThrowException("MeshV2 => Mesh has no GL resources (headless or not loaded)!");
+
+    return *mGpu;
+}
+
 const std::string& MeshV2::GetFilePath() const
 {
     return mFilePath;
@@ -500,28 +526,37 @@ void MeshV2::LoadMesh(aiMesh* mesh)
     {
         double min = 100000.0;
         double max = -10000.0;
-    } mBoundingBox[3];
+    } boundingBox[3];
 
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
         mVertices.push_back({ {mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z}, {mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z}, {mVertexToBonesVector[i]} });
+
+        unsigned int influences = 0;
+        while (influences < MAX_NUM_OF_BONES_PER_VERTEX && mVertexToBonesVector[i].mWeights[influences] != 0.0f)
+            influences++;
+
+        if (influences > mMaxBoneInfluences)
+            mMaxBoneInfluences = influences;
         // std::cout << mesh->mNormals[i].x << " || " << mesh->mNormals[i].y << " || " << mesh->mNormals[i].z << std::endl;
 
-        if (mesh->mVertices[i].x < mBoundingBox[0].min) mBoundingBox[0].min = mesh->mVertices[i].x;
-        if (mesh->mVertices[i].x > mBoundingBox[0].max) mBoundingBox[0].max = mesh->mVertices[i].x;
-        if (mesh->mVertices[i].y < mBoundingBox[1].min) mBoundingBox[1].min = mesh->mVertices[i].y;
-        if (mesh->mVertices[i].y > mBoundingBox[1].max) mBoundingBox[1].max = mesh->mVertices[i].y;
-        if (mesh->mVertices[i].z < mBoundingBox[2].min) mBoundingBox[2].min = mesh->mVertices[i].z;
-        if (mesh->mVertices[i].z > mBoundingBox[2].max) mBoundingBox[2].max = mesh->mVertices[i].z;
+        if (mesh->mVertices[i].x < boundingBox[0].min) boundingBox[0].min = mesh->mVertices[i].x;
+        if (mesh->mVertices[i].x > boundingBox[0].max) boundingBox[0].max = mesh->mVertices[i].x;
+        if (mesh->mVertices[i].y < boundingBox[1].min) boundingBox[1].min = mesh->mVertices[i].y;
+        if (mesh->mVertices[i].y > boundingBox[1].max) boundingBox[1].max = mesh->mVertices[i].y;
+        if (mesh->mVertices[i].z < boundingBox[2].min) boundingBox[2].min = mesh->mVertices[i].z;
+        if (mesh->mVertices[i].z > boundingBox[2].max) boundingBox[2].max = mesh->mVertices[i].z;
     }
 
 
+    mBoundingBox = AABB({ boundingBox[0].min, boundingBox[1].min, boundingBox[2].min }, { boundingBox[0].max, boundingBox[1].max, boundingBox[2].max });
+
     double center[3];
-    center[0] = (mBoundingBox[0].min + mBoundingBox[0].max) / 2;
-    center[1] = (mBoundingBox[1].min + mBoundingBox[1].max) / 2;
-    center[2] = (mBoundingBox[2].min + mBoundingBox[2].max) / 2;
+    center[0] = (boundingBox[0].min + boundingBox[0].max) / 2;
+    center[1] = (boundingBox[1].min + boundingBox[1].max) / 2;
+    center[2] = (boundingBox[2].min + boundingBox[2].max) / 2;
 
-    double M = std::max<double>(mBoundingBox[0].max - mBoundingBox[0].min, std::max<double>(mBoundingBox[1].max - mBoundingBox[1].min, mBoundingBox[2].max - mBoundingBox[2].min));
+    double M = std::max<double>(boundingBox[0].max - boundingBox[0].min, std::max<double>(boundingBox[1].max - boundingBox[1].min, boundingBox[2].max - boundingBox[2].min));
 
     double scaleVal = 2.0l / M;
     mTransform.Scale(glm::vec3(scaleVal, scaleVal, scaleVal));
@@ -537,13 +572,19 @@ void MeshV2::LoadMesh(aiMesh* mesh)
 
     void* ptr = (void*)(mVertices.data());
 
+    // CPU side data is all a headless mesh needs (animation benchmarks, tools)
+    if (mHeadless)
+        return;
+
+    mGpu = std::make_unique<GpuResources>();
+
     ConfigureVAOLayout();
 
-    mVBO.FillBuffer(mVertices.data(), mVertices.size() * sizeof(VertexV2), GL_STATIC_DRAW);
-    mIBO.FillBuffer(mIndices.data(), mIndices.size(), GL_STATIC_DRAW);
+    mGpu->mVBO.FillBuffer(mVertices.data(), mVertices.size() * sizeof(VertexV2), GL_STATIC_DRAW);
+    mGpu->mIBO.FillBuffer(mIndices.data(), mIndices.size(), GL_STATIC_DRAW);
 
-    mVBO.Bind<VertexV2>(0);
-    mVAO.AddBuffer(mVBO, mIBO);
+    mGpu->mVBO.Bind<VertexV2>(0);
+    mGpu->mVAO.AddBuffer(mGpu->mVBO, mGpu->mIBO);
 }
 
 void MeshV2::SelectNextAnimation()
@@ -559,8 +600,40 @@ Transform& MeshV2::GetTransform()
     return mTransform;
 }
 
+const VertexArray& MeshV2::GetVAO() const
+{
+    return GetGpuResources().mVAO;
+}
+
+const VertexBuffer& MeshV2::GetVB() const
+{
+    return GetGpuResources().mVBO;
+}
+
+const IndexBuffer& MeshV2::GetIB() const
+{
+    return GetGpuResources().mIBO;
+}
+
+unsigned int MeshV2::GetBoneCount() const
+{
+    return mBoneInfo.size();
+}
+
+const unsigned int& MeshV2::GetMaxBoneInfluences() const
+{
+    return mMaxBoneInfluences;
+}
+
+const AABB& MeshV2::GetBoundingBox() const
+{
+    return mBoundingBox;
+}
+
 void MeshV2::GetBoneTransforms(const double& timeInSeconds, std::vector<aiMatrix4x4>& transforms, const unsigned int& animationIndex)
 {
+    PROFILE_SCOPE("MeshV2::GetBoneTransforms");
+
     if (animationIndex >= mPScene->mNumAnimations)
         Debug::ThrowException("Animation index out of range!");
 
@@ -582,6 +655,8 @@ void MeshV2::GetBoneTransforms(const double& timeInSeconds, std::vector<aiMatrix
 
 void MeshV2::GetBoneTransoformsBlending(const float& animationTimeSec, std::vector<aiMatrix4x4>& transforms, const unsigned int& startAnimIndex, const unsigned int& endAnimIndex, const float& blendFactor)
 {
+    PROFILE_SCOPE("MeshV2::GetBoneTransoformsBlending");
+
     if (startAnimIndex >= mPScene->mNumAnimations)
     {
         printf("Invalid start animation index %d, max is %d\n", startAnimIndex, mPScene->mNumAnimations);
@@ -618,6 +693,58 @@ void MeshV2::GetBoneTransoformsBlending(const float& animationTimeSec, std::vect
     }
 }
 
+/// <summary>
+/// Writes the whole bone palette into the bones uniform block with a single buffer update
+/// </summary>
+/// <param name="transforms">Bone transformations returned by GetBoneTransforms/GetBoneTransoformsBlending</param>
+/// 
+void MeshV2::UploadBoneTransforms(const std::vector<aiMatrix4x4>& transforms)
+{
+    PROFILE_SCOPE("MeshV2::UploadBoneTransforms");
+
+    GpuResources& gpu = GetGpuResources();
+
+    unsigned int count = (transforms.size() < MAX_BONES) ? transforms.size() : MAX_BONES;
+
+    BonesBlock& block = gpu.mBonesBlock.Data();
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        block.mBones[i] = Transform::aiMatrix4x4ToGlm(&transforms[i]);
+    }
+
+    gpu.mBonesBlock.Upload(count * sizeof(glm::mat4));
+    gpu.mBonesBlock.Bind();
+}
+
+/// <summary>
+/// Same as UploadBoneTransforms, for palettes already converted with ToBonePalette (e.g. on another thread)
+/// </summary>
+/// 
+void MeshV2::UploadBonePalette(const std::vector<glm::mat4>& palette)
+{
+    PROFILE_SCOPE("MeshV2::UploadBonePalette");
+
+    GpuResources& gpu = GetGpuResources();
+
+    unsigned int count = (palette.size() < MAX_BONES) ? palette.size() : MAX_BONES;
+
+    std::copy(palette.begin(), palette.begin() + count, gpu.mBonesBlock.Data().mBones);
+
+    gpu.mBonesBlock.Upload(count * sizeof(glm::mat4));
+    gpu.mBonesBlock.Bind();
+}
+
+void MeshV2::ToBonePalette(const std::vector<aiMatrix4x4>& transforms, std::vector<glm::mat4>& palette)
+{
+    palette.resize(transforms.size());
+
+    for (size_t i = 0; i < transforms.size(); i++)
+    {
+        palette[i] = Transform::aiMatrix4x4ToGlm(&transforms[i]);
+    }
+}
+
 void MeshV2::PrintAnimations(const aiScene* pScene)
 {
     if (pScene->HasAnimations())
@@ -664,21 +791,39 @@ void MeshV2::ConfigureVAOLayout()
         layout.Push<float>(MAX_NUM_OF_BONES_PER_VERTEX);
     }
 
-    mVAO.Bind();
-    mVAO.SetLayout(layout, false);
-    mVAO.SetDrawingMode(GL_TRIANGLES);
-    mVAO.SetUsage(GL_STATIC_DRAW);
+    mGpu->mVAO.Bind();
+    mGpu->mVAO.SetLayout(layout, false);
+    mGpu->mVAO.SetDrawingMode(GL_TRIANGLES);
+    mGpu->mVAO.SetUsage(GL_STATIC_DRAW);
 }
 
 void MeshV2::Draw(Shader& shader)
 {
+    PROFILE_SCOPE("MeshV2::Draw");
+    PROFILE_GPU_SCOPE("MeshV2::Draw");
+
+    GpuResources& gpu = GetGpuResources();
+
     shader.Bind();
-    shader.SetUniformMatrix4f("model", mTransform.GetMatrix());
-    
 
-    mVAO.Bind();
-    mVBO.Bind<VertexV2>(0);
-    mIBO.Bind();
+    const glm::mat4& model = mTransform.GetMatrix();
+    ObjectBlock& object = gpu.mObjectBlock.Data();
+
+    if (!mObjectBlockValid || object.mModel != model)
+    {
+        object.mModel = model;
+        object.mNormalMatrix = glm::transpose(glm::inverse(model));
+        gpu.mObjectBlock.Upload();
+        mObjectBlockValid = true;
+    }
+
+    gpu.mObjectBlock.Bind();
+    gpu.mBonesBlock.Bind();
+
+
+    gpu.mVAO.Bind();
+    gpu.mVBO.Bind<VertexV2>(0);
+    gpu.mIBO.Bind();
 
-    glDrawElements(mVAO.GetDrawingMode(), mIBO.GetIndicesCount(), GL_UNSIGNED_INT, 0);
+    glDrawElements(gpu.mVAO.GetDrawingMode(), gpu.mIBO.GetIndicesCount(), GL_UNSIGNED_INT, 0);
 }
\ No newline at end of file
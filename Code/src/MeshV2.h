@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
@@ -16,6 +17,8 @@
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
 #include "Shader.h"
+#include "UniformBuffer.h"
+#include "BoundingBox.h"
 
 #define MAX_NUM_OF_BONES_PER_VERTEX 8 // for the mixamo rig, 6 is enough, but i made it pretty flexible
 #define ARRAY_SIZE_IN_ELEMENTS(a) (sizeof(a)/sizeof(a[0]))
@@ -88,10 +91,13 @@ class MeshV2
 public:
 
 	MeshV2();
-	MeshV2(const std::string& filePath);
+	MeshV2(const std::string& filePath, const bool& headless = false); // headless meshes never touch GL (no context needed)
 
 	void Initialize();
 
+	bool IsHeadless() const;
+	void SetHeadless(const bool& headless);
+
 	const std::string& GetFilePath() const;
 	void SetFilePath(const std::string& filePath);
 
@@ -104,9 +110,20 @@ public:
 
 	Transform& GetTransform();
 
+	const VertexArray& GetVAO() const;
+	const VertexBuffer& GetVB() const;
+	const IndexBuffer& GetIB() const;
+	unsigned int GetBoneCount() const;
+	const unsigned int& GetMaxBoneInfluences() const;
+	const AABB& GetBoundingBox() const;
+
 	void GetBoneTransforms(const double& timeInSeconds, std::vector<aiMatrix4x4>& transforms, const unsigned int& animationIndex);
 	void GetBoneTransoformsBlending(const float& animationTimeSec, std::vector<aiMatrix4x4>& Transforms, const unsigned int& startAnimIndex, const unsigned int& endAnimIndex, const float& blendFactor);
 
+	void UploadBoneTransforms(const std::vector<aiMatrix4x4>& transforms);
+	void UploadBonePalette(const std::vector<glm::mat4>& palette);
+	static void ToBonePalette(const std::vector<aiMatrix4x4>& transforms, std::vector<glm::mat4>& palette);
+
 private:
 
 	void ParseScene(const aiScene* pScene);
@@ -146,20 +163,37 @@ private:
 
 	void ConfigureVAOLayout();
 
+	friend class AnimationBenchmark;
+
+	// GL objects live in their own block so a headless mesh can skip creating them
+	struct GpuResources
+	{
+		VertexArray mVAO;
+		VertexBuffer mVBO;
+		IndexBuffer mIBO;
+
+		UniformBlock<ObjectBlock> mObjectBlock{ OBJECT_BLOCK_BINDING };
+		UniformBlock<BonesBlock> mBonesBlock{ BONES_BLOCK_BINDING };
+	};
+
+	GpuResources& GetGpuResources() const;
+
 	std::string mFilePath;
 
 	std::vector<VertexBoneData> mVertexToBonesVector; // mapping from vertex to bones (which bones affect a certain vertex)
 	std::vector<int> mMeshBaseVector; // Offset for each mesh (when there are more than one mesh for a model)
 	std::map<std::string, unsigned int> mBoneNameToIndexMap; // Mapping bone name to its index
 
-	VertexArray mVAO;
-	VertexBuffer mVBO;
-	IndexBuffer mIBO;
+	bool mHeadless = false;
+	std::unique_ptr<GpuResources> mGpu;
+	bool mObjectBlockValid = false;
 
 	Transform mTransform;
 	aiMatrix4x4 mGlobalInverseTransform;
 
 	unsigned int mActiveAnimation = 0;
+	unsigned int mMaxBoneInfluences = 0; // highest number of bones affecting a single vertex
+	AABB mBoundingBox; // bind pose bounds in model space
 
 	std::vector<unsigned int> mIndices;
 	std::vector<VertexV2> mVertices;
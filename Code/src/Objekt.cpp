@@ -1,5 +1,7 @@
 #include "Objekt.h"
 
+#include "Profiler.h"
+
 Objekt::Objekt(const std::string& name, const std::string& meshFilePath, Shader& shader)
 	:
 	mName(name),
@@ -23,6 +25,8 @@ Objekt::~Objekt()
 
 void Objekt::Draw()
 {
+	PROFILE_SCOPE("Objekt::Draw");
+
 	mShader.Bind();
 	mVAO.Bind();
 	mMesh.GetVB().Bind<Vertex>(0);
@@ -50,3 +54,23 @@ Transform& Objekt::GetTransform()
 {
 	return mTransform;
 }
+
+unsigned int Objekt::GetMaterialID() const
+{
+	return mShader.GetRendererID();
+}
+
+AABB Objekt::GetLocalBounds() const
+{
+	return mMesh.GetBoundingBox();
+}
+
+const Mesh& Objekt::GetMesh() const
+{
+	return mMesh;
+}
+
+const VertexArray& Objekt::GetVAO() const
+{
+	return mVAO;
+}
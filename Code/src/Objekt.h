@@ -24,6 +24,11 @@ public:
 	static void ToggleActive(Objekt& obj);
 
 	Transform& GetTransform();
+	AABB GetLocalBounds() const;
+	unsigned int GetMaterialID() const;
+
+	const Mesh& GetMesh() const;
+	const VertexArray& GetVAO() const;
 
 private:
 
@@ -0,0 +1,493 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "Debug.h"
+#include "Profiler.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OCCLUSION_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+#define OCCLUSION_NEAR_W 1e-4f
+#define OCCLUSION_CLEAR_DEPTH 1.0f
+
+/// <summary>
+///
+/// </summary>
+/// <param name="width">Depth buffer width in pixels, has to be a multiple of 4</param>
+/// <param name="height">Depth buffer height in pixels</param>
+/// <param name="threadPool">Pool used for setup, rasterization and pyramid build; the shared pool when null</param>
+///
+OcclusionCuller::OcclusionCuller(const unsigned int& width, const unsigned int& height, ThreadPool* threadPool)
+	:
+	mWidth(width),
+	mHeight(height),
+	mTilesX((width + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE),
+	mTilesY((height + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE),
+	mThreadPool(threadPool ? *threadPool : ThreadPool::GetShared())
+{
+	if (width == 0 || height == 0 || width % 4 != 0)
+		Debug::ThrowException("OcclusionCuller => invalid depth buffer size! (" + STRING(width) + "x" + STRING(height) + ")");
+
+	mTileBins.resize(mTilesX * mTilesY);
+
+	unsigned int levelWidth = width;
+	unsigned int levelHeight = height;
+
+	while (true)
+	{
+		mLevels.push_back({ levelWidth, levelHeight, std::vector<float>(levelWidth * levelHeight, OCCLUSION_CLEAR_DEPTH) });
+
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+
+		levelWidth = std::max(1u, (levelWidth + 1) / 2);
+		levelHeight = std::max(1u, (levelHeight + 1) / 2);
+	}
+}
+
+unsigned int OcclusionCuller::AddOccluder(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& model)
+{
+	if (indices.size() % 3 != 0)
+		Debug::ThrowException("OcclusionCuller => occluder index count has to be a multiple of 3!");
+
+	Occluder occluder;
+	occluder.mVertices = vertices;
+	occluder.mIndices = indices;
+	occluder.mModel = model;
+
+	mOccluders.push_back(std::move(occluder));
+
+	return (unsigned int)mOccluders.size() - 1;
+}
+
+unsigned int OcclusionCuller::AddOccluder(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& model)
+{
+	std::vector<glm::vec3> positions;
+	positions.reserve(vertices.size());
+
+	for (const auto& vertex : vertices)
+	{
+		positions.push_back(vertex.pos);
+	}
+
+	return AddOccluder(positions, indices, model);
+}
+
+void OcclusionCuller::SetOccluderTransform(const unsigned int& occluder, const glm::mat4& model)
+{
+	if (occluder >= mOccluders.size())
+		Debug::ThrowException("OcclusionCuller => invalid occluder index! (" + STRING(occluder) + ")");
+
+	mOccluders[occluder].mModel = model;
+}
+
+void OcclusionCuller::SetOccluderActive(const unsigned int& occluder, const bool& active)
+{
+	if (occluder >= mOccluders.size())
+		Debug::ThrowException("OcclusionCuller => invalid occluder index! (" + STRING(occluder) + ")");
+
+	mOccluders[occluder].mActive = active;
+}
+
+/// <summary>
+/// Rasterizes all active occluders and rebuilds the depth pyramid
+/// </summary>
+///
+void OcclusionCuller::Render(const glm::mat4& viewProjection)
+{
+	PROFILE_SCOPE("OcclusionCuller::Render");
+
+	mViewProjection = viewProjection;
+
+	mOccluderTriangles.resize(mOccluders.size());
+
+	mThreadPool.ParallelFor((unsigned int)mOccluders.size(), [this](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			mOccluderTriangles[i].clear();
+
+			if (mOccluders[i].mActive)
+				SetupTriangles(mOccluders[i], mOccluderTriangles[i]);
+		}
+	});
+
+	BinTriangles();
+
+	// every tile is owned by exactly one job, so no synchronization is needed on the depth buffer
+	mThreadPool.ParallelFor(mTilesX * mTilesY, [this](unsigned int begin, unsigned int end)
+	{
+		PROFILE_SCOPE("OcclusionCuller::RasterizeTiles");
+
+		for (unsigned int tile = begin; tile < end; tile++)
+		{
+			RasterizeTile(tile);
+		}
+	});
+
+	BuildHierarchy();
+}
+
+/// <summary>
+/// Conservative test; boxes crossing the near plane or outside of the screen are reported as visible
+/// </summary>
+/// <param name="box">World space box</param>
+/// <returns>False only if the box is completely behind the rasterized occluders</returns>
+///
+bool OcclusionCuller::IsVisible(const AABB& box) const
+{
+	if (!box.IsValid())
+		return true;
+
+	glm::vec3 ndcMin(std::numeric_limits<float>::max());
+	glm::vec3 ndcMax(std::numeric_limits<float>::lowest());
+
+	for (unsigned int corner = 0; corner < 8; corner++)
+	{
+		glm::vec4 point((corner & 1) ? box.mMax.x : box.mMin.x, (corner & 2) ? box.mMax.y : box.mMin.y, (corner & 4) ? box.mMax.z : box.mMin.z, 1.0f);
+		glm::vec4 clip = mViewProjection * point;
+
+		if (clip.w <= OCCLUSION_NEAR_W || clip.z < -clip.w)
+			return true;
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+
+	float nearestDepth = ndcMin.z * 0.5f + 0.5f;
+
+	int minX = (int)std::floor((ndcMin.x * 0.5f + 0.5f) * mWidth);
+	int maxX = (int)std::floor((ndcMax.x * 0.5f + 0.5f) * mWidth);
+	int minY = (int)std::floor((ndcMin.y * 0.5f + 0.5f) * mHeight);
+	int maxY = (int)std::floor((ndcMax.y * 0.5f + 0.5f) * mHeight);
+
+	if (maxX < 0 || maxY < 0 || minX >= (int)mWidth || minY >= (int)mHeight)
+		return true;
+
+	minX = std::max(minX, 0);
+	minY = std::max(minY, 0);
+	maxX = std::min(maxX, (int)mWidth - 1);
+	maxY = std::min(maxY, (int)mHeight - 1);
+
+	// pick the level at which the box covers at most ~5x5 texels; coarser levels reject too little
+	unsigned int level = 0;
+	int size = std::max(maxX - minX, maxY - minY) + 1;
+
+	while ((size >> level) > 4 && level + 1 < mLevels.size())
+	{
+		level++;
+	}
+
+	const DepthLevel& depthLevel = mLevels[level];
+
+	for (int y = minY >> level; y <= (maxY >> level); y++)
+	{
+		for (int x = minX >> level; x <= (maxX >> level); x++)
+		{
+			if (nearestDepth <= depthLevel.mDepth[y * depthLevel.mWidth + x])
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/// <summary>
+/// Writes a depth buffer level as binary PGM; near is white, the cleared background is black
+/// </summary>
+///
+void OcclusionCuller::DumpDepth(const std::string& filePath, const unsigned int& level) const
+{
+	if (level >= mLevels.size())
+		Debug::ThrowException("OcclusionCuller => invalid depth level! (" + STRING(level) + ")");
+
+	const DepthLevel& depthLevel = mLevels[level];
+
+	// perspective depth is squeezed towards 1, so stretch the written range to make the occluders readable
+	float minDepth = OCCLUSION_CLEAR_DEPTH;
+	float maxDepth = 0.0f;
+
+	for (const auto& depth : depthLevel.mDepth)
+	{
+		if (depth < OCCLUSION_CLEAR_DEPTH)
+		{
+			minDepth = std::min(minDepth, depth);
+			maxDepth = std::max(maxDepth, depth);
+		}
+	}
+
+	float range = std::max(maxDepth - minDepth, 1e-6f);
+
+	std::ofstream file(filePath, std::ios::binary);
+
+	if (!file.is_open())
+		Debug::ThrowException("OcclusionCuller => couldn't open file '" + filePath + "' for writing!");
+
+	file << "P5\n" << depthLevel.mWidth << " " << depthLevel.mHeight << "\n255\n";
+
+	std::vector<unsigned char> row(depthLevel.mWidth);
+
+	// PGM rows go top to bottom, the depth buffer bottom to top
+	for (int y = (int)depthLevel.mHeight - 1; y >= 0; y--)
+	{
+		for (unsigned int x = 0; x < depthLevel.mWidth; x++)
+		{
+			float depth = depthLevel.mDepth[y * depthLevel.mWidth + x];
+
+			if (depth >= OCCLUSION_CLEAR_DEPTH)
+				row[x] = 0;
+			else
+				row[x] = (unsigned char)(255.0f - 223.0f * (depth - minDepth) / range);
+		}
+
+		file.write((const char*)row.data(), row.size());
+	}
+
+	Debug::Print("Occlusion depth level " + STRING(level) + " written to '" + filePath + "'");
+}
+
+const unsigned int& OcclusionCuller::GetWidth() const
+{
+	return mWidth;
+}
+
+const unsigned int& OcclusionCuller::GetHeight() const
+{
+	return mHeight;
+}
+
+unsigned int OcclusionCuller::GetLevelCount() const
+{
+	return (unsigned int)mLevels.size();
+}
+
+unsigned int OcclusionCuller::GetTriangleCount() const
+{
+	unsigned int count = 0;
+
+	for (const auto& triangles : mOccluderTriangles)
+	{
+		count += (unsigned int)triangles.size();
+	}
+
+	return count;
+}
+
+// Transforms an occluder to screen space; back facing triangles and triangles crossing the near plane are dropped
+void OcclusionCuller::SetupTriangles(const Occluder& occluder, std::vector<ScreenTriangle>& output) const
+{
+	static thread_local std::vector<glm::vec4> clip;
+
+	glm::mat4 modelViewProjection = mViewProjection * occluder.mModel;
+
+	clip.resize(occluder.mVertices.size());
+
+	for (size_t i = 0; i < occluder.mVertices.size(); i++)
+	{
+		clip[i] = modelViewProjection * glm::vec4(occluder.mVertices[i], 1.0f);
+	}
+
+	for (size_t i = 0; i + 2 < occluder.mIndices.size(); i += 3)
+	{
+		ScreenTriangle triangle;
+		bool valid = true;
+
+		for (unsigned int v = 0; v < 3; v++)
+		{
+			const glm::vec4& c = clip[occluder.mIndices[i + v]];
+
+			// dropping an occluder triangle can only make the result more conservative, so no clipping is done
+			if (c.w <= OCCLUSION_NEAR_W || c.z < -c.w)
+			{
+				valid = false;
+				break;
+			}
+
+			float invW = 1.0f / c.w;
+			triangle.mVertices[v] = {
+				(c.x * invW * 0.5f + 0.5f) * mWidth,
+				(c.y * invW * 0.5f + 0.5f) * mHeight,
+				std::min(c.z * invW * 0.5f + 0.5f, OCCLUSION_CLEAR_DEPTH)
+			};
+		}
+
+		if (!valid)
+			continue;
+
+		const glm::vec3& v0 = triangle.mVertices[0];
+		const glm::vec3& v1 = triangle.mVertices[1];
+		const glm::vec3& v2 = triangle.mVertices[2];
+
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+
+		if (area <= 0.0f)
+			continue;
+
+		triangle.mMinX = std::max(0, (int)std::floor(std::min({ v0.x, v1.x, v2.x })));
+		triangle.mMinY = std::max(0, (int)std::floor(std::min({ v0.y, v1.y, v2.y })));
+		triangle.mMaxX = std::min((int)mWidth - 1, (int)std::ceil(std::max({ v0.x, v1.x, v2.x })));
+		triangle.mMaxY = std::min((int)mHeight - 1, (int)std::ceil(std::max({ v0.y, v1.y, v2.y })));
+
+		if (triangle.mMinX > triangle.mMaxX || triangle.mMinY > triangle.mMaxY)
+			continue;
+
+		output.push_back(triangle);
+	}
+}
+
+void OcclusionCuller::BinTriangles()
+{
+	for (auto& bin : mTileBins)
+	{
+		bin.clear();
+	}
+
+	for (const auto& triangles : mOccluderTriangles)
+	{
+		for (const auto& triangle : triangles)
+		{
+			for (int tileY = triangle.mMinY / OCCLUSION_TILE_SIZE; tileY <= triangle.mMaxY / OCCLUSION_TILE_SIZE; tileY++)
+			{
+				for (int tileX = triangle.mMinX / OCCLUSION_TILE_SIZE; tileX <= triangle.mMaxX / OCCLUSION_TILE_SIZE; tileX++)
+				{
+					mTileBins[tileY * mTilesX + tileX].push_back(&triangle);
+				}
+			}
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTile(const unsigned int& tile)
+{
+	int tileMinX = (tile % mTilesX) * OCCLUSION_TILE_SIZE;
+	int tileMinY = (tile / mTilesX) * OCCLUSION_TILE_SIZE;
+	int tileMaxX = std::min(tileMinX + OCCLUSION_TILE_SIZE, (int)mWidth) - 1;
+	int tileMaxY = std::min(tileMinY + OCCLUSION_TILE_SIZE, (int)mHeight) - 1;
+
+	std::vector<float>& depth = mLevels[0].mDepth;
+
+	for (int y = tileMinY; y <= tileMaxY; y++)
+	{
+		std::fill(depth.begin() + y * mWidth + tileMinX, depth.begin() + y * mWidth + tileMaxX + 1, OCCLUSION_CLEAR_DEPTH);
+	}
+
+	for (const auto& triangle : mTileBins[tile])
+	{
+		RasterizeTriangle(*triangle, std::max(triangle->mMinX, tileMinX), std::max(triangle->mMinY, tileMinY), std::min(triangle->mMaxX, tileMaxX), std::min(triangle->mMaxY, tileMaxY));
+	}
+}
+
+// Half-space rasterization; edge functions and depth are planes in screen space, so each row is just a few additions
+void OcclusionCuller::RasterizeTriangle(const ScreenTriangle& triangle, const int& minX, const int& minY, const int& maxX, const int& maxY)
+{
+	const glm::vec3& v0 = triangle.mVertices[0];
+	const glm::vec3& v1 = triangle.mVertices[1];
+	const glm::vec3& v2 = triangle.mVertices[2];
+
+	// E(p) = A * p.x + B * p.y + C, positive on the inner side of the edge (triangles are counter clockwise)
+	float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = v1.x * v2.y - v1.y * v2.x;
+	float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = v2.x * v0.y - v2.y * v0.x;
+	float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = v0.x * v1.y - v0.y * v1.x;
+
+	float invArea = 1.0f / (c0 + c1 + c2);
+
+	float az = (a1 * (v1.z - v0.z) + a2 * (v2.z - v0.z)) * invArea;
+	float bz = (b1 * (v1.z - v0.z) + b2 * (v2.z - v0.z)) * invArea;
+	float cz = v0.z + (c1 * (v1.z - v0.z) + c2 * (v2.z - v0.z)) * invArea;
+
+	float* depth = mLevels[0].mDepth.data();
+
+	// rows are processed in groups of 4 pixels; tiles and the buffer width are multiples of 4, so the groups never leave the tile
+	int startX = minX & ~3;
+
+#ifdef OCCLUSION_USE_SSE
+	const __m128 pixelOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	const __m128 step0 = _mm_set1_ps(a0 * 4.0f);
+	const __m128 step1 = _mm_set1_ps(a1 * 4.0f);
+	const __m128 step2 = _mm_set1_ps(a2 * 4.0f);
+	const __m128 stepZ = _mm_set1_ps(az * 4.0f);
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		float py = y + 0.5f;
+		__m128 px = _mm_add_ps(_mm_set1_ps((float)startX), pixelOffset);
+
+		__m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), px), _mm_set1_ps(b0 * py + c0));
+		__m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), px), _mm_set1_ps(b1 * py + c1));
+		__m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), px), _mm_set1_ps(b2 * py + c2));
+		__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(az), px), _mm_set1_ps(bz * py + cz));
+
+		float* row = depth + y * mWidth;
+
+		for (int x = startX; x <= maxX; x += 4)
+		{
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+
+			if (_mm_movemask_ps(inside))
+			{
+				__m128 old = _mm_loadu_ps(row + x);
+				__m128 closer = _mm_min_ps(old, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, old)));
+			}
+
+			e0 = _mm_add_ps(e0, step0);
+			e1 = _mm_add_ps(e1, step1);
+			e2 = _mm_add_ps(e2, step2);
+			z = _mm_add_ps(z, stepZ);
+		}
+	}
+#else
+	for (int y = minY; y <= maxY; y++)
+	{
+		float py = y + 0.5f;
+		float* row = depth + y * mWidth;
+
+		for (int x = startX; x <= maxX; x++)
+		{
+			float px = x + 0.5f;
+
+			if (a0 * px + b0 * py + c0 < 0.0f || a1 * px + b1 * py + c1 < 0.0f || a2 * px + b2 * py + c2 < 0.0f)
+				continue;
+
+			row[x] = std::min(row[x], az * px + bz * py + cz);
+		}
+	}
+#endif
+}
+
+// Every texel stores the farthest depth of the 4 texels below it
+void OcclusionCuller::BuildHierarchy()
+{
+	for (size_t level = 1; level < mLevels.size(); level++)
+	{
+		const DepthLevel& source = mLevels[level - 1];
+		DepthLevel& target = mLevels[level];
+
+		mThreadPool.ParallelFor(target.mHeight, [&source, &target](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int y = begin; y < end; y++)
+			{
+				unsigned int y0 = y * 2;
+				unsigned int y1 = std::min(y0 + 1, source.mHeight - 1);
+
+				for (unsigned int x = 0; x < target.mWidth; x++)
+				{
+					unsigned int x0 = x * 2;
+					unsigned int x1 = std::min(x0 + 1, source.mWidth - 1);
+
+					target.mDepth[y * target.mWidth + x] = std::max(
+						std::max(source.mDepth[y0 * source.mWidth + x0], source.mDepth[y0 * source.mWidth + x1]),
+						std::max(source.mDepth[y1 * source.mWidth + x0], source.mDepth[y1 * source.mWidth + x1]));
+				}
+			}
+		}, 16);
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "BoundingBox.h"
+#include "Vertex.h"
+#include "ThreadPool.h"
+
+#define OCCLUSION_TILE_SIZE 32
+#define OCCLUSION_DEFAULT_WIDTH 256
+#define OCCLUSION_DEFAULT_HEIGHT 128
+
+struct Occluder
+{
+	std::vector<glm::vec3> mVertices;
+	std::vector<unsigned int> mIndices;
+	glm::mat4 mModel{ 1.0f };
+	bool mActive = true;
+};
+
+// Rasterizes a few large occluders into a small CPU depth buffer and tests boxes against a max-depth (Hi-Z) pyramid.
+// Works without a GL context.
+class OcclusionCuller
+{
+public:
+
+	OcclusionCuller(const unsigned int& width = OCCLUSION_DEFAULT_WIDTH, const unsigned int& height = OCCLUSION_DEFAULT_HEIGHT, ThreadPool* threadPool = nullptr);
+
+	unsigned int AddOccluder(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& model = glm::mat4(1.0f));
+	unsigned int AddOccluder(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& model = glm::mat4(1.0f));
+
+	void SetOccluderTransform(const unsigned int& occluder, const glm::mat4& model);
+	void SetOccluderActive(const unsigned int& occluder, const bool& active);
+
+	void Render(const glm::mat4& viewProjection);
+
+	bool IsVisible(const AABB& box) const;
+
+	void DumpDepth(const std::string& filePath, const unsigned int& level = 0) const;
+
+	const unsigned int& GetWidth() const;
+	const unsigned int& GetHeight() const;
+	unsigned int GetLevelCount() const;
+	unsigned int GetTriangleCount() const;
+
+private:
+
+	// x, y in pixels; z is depth in [0, 1]
+	struct ScreenTriangle
+	{
+		glm::vec3 mVertices[3];
+		int mMinX, mMinY, mMaxX, mMaxY;
+	};
+
+	struct DepthLevel
+	{
+		unsigned int mWidth;
+		unsigned int mHeight;
+		std::vector<float> mDepth;
+	};
+
+	void SetupTriangles(const Occluder& occluder, std::vector<ScreenTriangle>& output) const;
+	void BinTriangles();
+	void RasterizeTile(const unsigned int& tile);
+	void RasterizeTriangle(const ScreenTriangle& triangle, const int& minX, const int& minY, const int& maxX, const int& maxY);
+	void BuildHierarchy();
+
+	unsigned int mWidth;
+	unsigned int mHeight;
+	unsigned int mTilesX;
+	unsigned int mTilesY;
+
+	ThreadPool& mThreadPool;
+
+	std::vector<Occluder> mOccluders;
+	std::vector<std::vector<ScreenTriangle>> mOccluderTriangles; // per occluder, filled in parallel
+	std::vector<std::vector<const ScreenTriangle*>> mTileBins;
+
+	std::vector<DepthLevel> mLevels; // level 0 is the full resolution depth buffer
+
+	glm::mat4 mViewProjection{ 1.0f };
+
+};
@@ -1,60 +1,400 @@
 #include "Parser.h"
 
-#include <fstream>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <charconv>
+#include <atomic>
+#include <filesystem>
 
 #include "Debug.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "BinaryPointFile.h"
 
+#define PARSER_BINARY_COPY_CHUNK (1u << 18) // points copied from a binary file by one job
+#define PARSER_MIN_LINE_SIZE 6 // "0 0 0\n", the shortest possible point line
+
+static const char* SkipSpaces(const char* position, const char* end)
+{
+	while (position < end && (*position == ' ' || *position == '\t' || *position == '\r'))
+	{
+		position++;
+	}
+
+	return position;
+}
+
+/// <summary>
+/// Appends the points of the file to storeVector. The file is memory mapped and split into line aligned chunks which are
+/// parsed in parallel; if it can't be mapped (e.g. not enough address space in a 32 bit build) it is read in blocks instead.
+/// </summary>
+/// 
 void Parser::ReadFile(const std::string& filePath, std::vector<glm::vec3>& storeVector)
 {
-	std::ifstream file(filePath);
+	MappedFile file(filePath);
+
+	if (file.IsMapped() && BinaryPointFile::IsBinary(file))
+	{
+		BinaryPointFile binary(file, filePath);
+
+		size_t offset = storeVector.size();
+		storeVector.resize(offset + binary.GetCount());
+
+		// the copy is what pages the file in, so it runs in parallel as well
+		ThreadPool::GetShared().ParallelFor((binary.GetCount() + PARSER_BINARY_COPY_CHUNK - 1) / PARSER_BINARY_COPY_CHUNK, [&](unsigned int first, unsigned int last)
+		{
+			size_t begin = (size_t)first * PARSER_BINARY_COPY_CHUNK;
+			size_t end = std::min((size_t)last * PARSER_BINARY_COPY_CHUNK, binary.GetCount());
+
+			binary.CopyPoints(begin, end - begin, storeVector.data() + offset + begin);
+		});
+
+		return;
+	}
+
+	if (file.IsMapped())
+	{
+		const char* begin = file.GetData();
+		const char* end = begin + file.GetSize();
+
+		if (begin == end)
+			Debug::ThrowException("Parser => '" + filePath + "' is empty!");
+
+		const char* headerEnd = (const char*)std::memchr(begin, '\n', end - begin);
+
+		if (headerEnd == nullptr)
+			headerEnd = end;
+
+		size_t pointCount = 0;
+		const char* body = std::min(ParseHeader(begin, headerEnd, pointCount), end);
+
+		ParseParallel(filePath, body, end, pointCount, storeVector);
+		return;
+	}
+
+	size_t pointCount = 0;
+	bool reserved = false;
+
+	ReadBlocks(filePath, pointCount, [&](const glm::vec3* points, const size_t& count)
+	{
+		if (!reserved)
+		{
+			storeVector.reserve(storeVector.size() + pointCount);
+			reserved = true;
+		}
+
+		storeVector.insert(storeVector.end(), points, points + count);
+	});
+}
+
+/// <summary>
+/// Every chunk is parsed into its own vector (sized from the header), then the vectors are appended to output in file order.
+/// Threads take the next unparsed chunk from a shared counter, so a slow chunk doesn't keep the other threads idle.
+/// </summary>
+/// <param name="begin">First point line</param>
+/// <param name="pointCount">Point count from the header; checked against the parsed points</param>
+/// 
+void Parser::ParseParallel(const std::string& filePath, const char* begin, const char* end, const size_t& pointCount, std::vector<glm::vec3>& output)
+{
+	ThreadPool& pool = ThreadPool::GetShared();
+
+	size_t size = end - begin;
+	CheckPointCount(filePath, pointCount, size);
+
+	size_t chunkCount = std::max<size_t>(1, std::min<size_t>((pool.GetThreadCount() + 1) * PARSER_CHUNKS_PER_THREAD, size / PARSER_MIN_CHUNK_SIZE));
+
+	// even split, every boundary moved forward to the start of a line
+	std::vector<const char*> bounds(chunkCount + 1);
+	bounds[0] = begin;
+	bounds[chunkCount] = end;
+
+	for (size_t i = 1; i < chunkCount; i++)
+	{
+		const char* position = std::max(bounds[i - 1], begin + size * i / chunkCount - 1);
+		const char* lineEnd = (const char*)std::memchr(position, '\n', end - position);
+
+		bounds[i] = lineEnd ? lineEnd + 1 : end;
+	}
+
+	output.reserve(output.size() + pointCount);
+
+	std::vector<std::vector<glm::vec3>> chunks(chunkCount);
+	std::atomic<size_t> nextChunk = 0;
+
+	// one job per thread, each keeps taking chunks until none are left
+	pool.ParallelFor(pool.GetThreadCount() + 1, [&](unsigned int, unsigned int)
+	{
+		for (size_t i = nextChunk++; i < chunkCount; i = nextChunk++)
+		{
+			std::vector<glm::vec3>& points = chunks[i];
+			points.reserve((size_t)((double)pointCount * (bounds[i + 1] - bounds[i]) / std::max<size_t>(size, 1)) + 16);
+
+			const char* rest = ParseLines(bounds[i], bounds[i + 1], points);
+
+			// only the last line of the file can be missing its newline
+			if (rest != bounds[i + 1])
+			{
+				std::string line(rest, bounds[i + 1]);
+				line.push_back('\n');
+
+				ParseLines(line.data(), line.data() + line.size(), points);
+			}
+		}
+	});
+
+	size_t parsedCount = 0;
+
+	for (const auto& points : chunks)
+	{
+		parsedCount += points.size();
+	}
+
+	if (parsedCount != pointCount)
+		Debug::ThrowException("Parser => header of '" + filePath + "' says " + STRING(pointCount) + " points, the file has " + STRING(parsedCount) + "!");
+
+	for (auto& points : chunks)
+	{
+		output.insert(output.end(), points.begin(), points.end());
+
+		points.clear();
+		points.shrink_to_fit();
+	}
+}
+
+// the header is only trusted for reserving memory once the file is large enough to hold that many points
+void Parser::CheckPointCount(const std::string& filePath, const size_t& pointCount, const uint64_t& bodySize)
+{
+	if (pointCount > (bodySize + 1) / PARSER_MIN_LINE_SIZE)
+		Debug::ThrowException("Parser => header of '" + filePath + "' says " + STRING(pointCount) + " points, the file is too small for that! (" + STRING(bodySize) + " bytes)");
+}
+
+/// <summary>
+/// Reads the same format as ReadFile, but never holds more than chunkSize points
+/// </summary>
+/// <param name="chunkSize">Points per chunk, including the overlap</param>
+/// <param name="overlap">Number of points at the end of a chunk that are repeated at the start of the next one</param>
+/// <param name="consumer">Called for every chunk; the last one can be shorter</param>
+/// <returns>Number of points in the file</returns>
+/// 
+size_t Parser::ReadFileChunked(const std::string& filePath, const unsigned int& chunkSize, const unsigned int& overlap,
+	const std::function<void(const std::vector<glm::vec3>& chunk)>& consumer)
+{
+	if (chunkSize <= overlap)
+		Debug::ThrowException("Chunk has to be larger than the overlap! (chunkSize = " + STRING(chunkSize) + ", overlap = " + STRING(overlap) + ")");
+
+	std::vector<glm::vec3> chunk;
+	chunk.reserve(chunkSize);
 
-	if (!file.is_open())
-		Debug::ThrowException("Can't open file that is supposed to be parsed!");
+	size_t pointCount = 0;
 
-	std::string line;
+	auto append = [&](const glm::vec3* points, const size_t& count)
+	{
+		for (size_t i = 0; i < count;)
+		{
+			size_t taken = std::min(count - i, (size_t)chunkSize - chunk.size());
+			chunk.insert(chunk.end(), points + i, points + i + taken);
+			i += taken;
 
-	int i = -1;
+			if (chunk.size() == chunkSize)
+			{
+				consumer(chunk);
+				chunk.erase(chunk.begin(), chunk.end() - overlap);
+			}
+		}
+	};
 
-	glm::vec3 p;
-	std::vector<std::string> lineSplit;
+	MappedFile file(filePath);
 
-	while (std::getline(file, line))
+	if (file.IsMapped() && BinaryPointFile::IsBinary(file))
 	{
-		if (i == -1)
+		BinaryPointFile binaryFile(file, filePath);
+		std::vector<glm::vec3> points(std::min<size_t>(chunkSize, binaryFile.GetCount()));
+
+		pointCount = binaryFile.GetCount();
+
+		for (size_t first = 0; first < pointCount; first += points.size())
 		{
-			i = atoi(line.c_str());
-			storeVector.reserve(i);
+			size_t count = std::min(points.size(), pointCount - first);
+
+			binaryFile.CopyPoints(first, count, points.data());
+			append(points.data(), count);
 		}
-		else
+	}
+	else
+		ReadBlocks(filePath, pointCount, append);
+
+	// whatever is left, unless it is only the overlap of an already passed chunk
+	if (chunk.size() > overlap || (!chunk.empty() && chunk.size() == pointCount))
+		consumer(chunk);
+
+	return pointCount;
+}
+
+/// <summary>
+/// Reads the file in PARSER_BLOCK_SIZE blocks into one buffer; the incomplete line at the end of a block is moved to the front
+/// and completed by the next read. Throws if the number of points differs from the header.
+/// </summary>
+/// <returns>Number of points in the file</returns>
+/// 
+size_t Parser::ReadBlocks(const std::string& filePath, size_t& pointCount, const std::function<void(const glm::vec3* points, const size_t& count)>& consumer)
+{
+	std::FILE* file = std::fopen(filePath.c_str(), "rb");
+
+	if (file == nullptr)
+		Debug::ThrowException("Can't open file that is supposed to be parsed! (" + filePath + ")");
+
+	std::error_code sizeError;
+	uint64_t fileSize = std::filesystem::file_size(filePath, sizeError);
+
+	// +1 so a newline can be added after the last line if the file doesn't end with one
+	std::vector<char> buffer(PARSER_BLOCK_SIZE + 1);
+	std::vector<glm::vec3> points;
+
+	size_t filled = 0;
+	size_t parsedCount = 0;
+	bool headerRead = false;
+
+	try
+	{
+		while (true)
 		{
-			StringSplit(line, 3, " ", lineSplit);
+			size_t read = std::fread(buffer.data() + filled, 1, PARSER_BLOCK_SIZE - filled, file);
+			bool last = read == 0;
+
+			filled += read;
+
+			if (last)
+			{
+				if (filled == 0)
+					break;
+
+				buffer[filled++] = '\n';
+			}
+
+			const char* begin = buffer.data();
+			const char* end = buffer.data() + filled;
+
+			if (!headerRead)
+			{
+				const char* lineEnd = (const char*)std::memchr(begin, '\n', filled);
+
+				// the header line is always inside the first block, unless the whole file is one unfinished line
+				if (lineEnd == nullptr)
+				{
+					if (filled == PARSER_BLOCK_SIZE)
+						Debug::ThrowException("Parser => first line of '" + filePath + "' is not a point count!");
+
+					continue;
+				}
 
-			for (i = 0; i < 3; i++)
+				begin = ParseHeader(begin, lineEnd, pointCount);
+				headerRead = true;
+
+				uint64_t headerSize = std::min<uint64_t>(begin - buffer.data(), fileSize);
+
+				if (!sizeError)
+					CheckPointCount(filePath, pointCount, fileSize - headerSize);
+			}
+
+			points.clear();
+			const char* rest = ParseLines(begin, end, points);
+
+			if (!points.empty())
 			{
-				p[i] = strtof(lineSplit[i].c_str(), NULL);
+				consumer(points.data(), points.size());
+				parsedCount += points.size();
 			}
 
-			storeVector.push_back(p);
+			if (last)
+				break;
+
+			filled = end - rest;
 
-			lineSplit.clear();
+			if (filled == PARSER_BLOCK_SIZE)
+				Debug::ThrowException("Parser => line longer than " + STRING(PARSER_BLOCK_SIZE) + " bytes in '" + filePath + "'!");
+
+			std::memmove(buffer.data(), rest, filled);
 		}
 	}
+	catch (...)
+	{
+		std::fclose(file);
+		throw;
+	}
+
+	std::fclose(file);
+
+	if (!headerRead)
+		Debug::ThrowException("Parser => '" + filePath + "' is empty!");
+
+	if (parsedCount != pointCount)
+		Debug::ThrowException("Parser => header of '" + filePath + "' says " + STRING(pointCount) + " points, the file has " + STRING(parsedCount) + "!");
+
+	return parsedCount;
 }
 
-void Parser::StringSplit(std::string& str, const unsigned int& count, const std::string& delimiter, std::vector<std::string>& output)
+const char* Parser::ParseHeader(const char* begin, const char* end, size_t& pointCount)
 {
-	size_t pos = 0;
-	std::string token;
+	const char* position = SkipSpaces(begin, end);
+	auto [numberEnd, error] = std::from_chars(position, end, pointCount);
+
+	if (error != std::errc() || SkipSpaces(numberEnd, end) != end)
+		Debug::ThrowException("Parser => first line is not a point count! ('" + std::string(begin, std::min(end, begin + 64)) + "')");
+
+	return end + 1;
+}
 
-	output.reserve(count);
+/// <summary>
+/// 
+/// </summary>
+/// <param name="output">Parsed points are appended</param>
+/// <returns>Start of the first line without a newline; parsing can continue from there once more text is available</returns>
+/// 
+const char* Parser::ParseLines(const char* begin, const char* end, std::vector<glm::vec3>& output)
+{
+	const char* position = begin;
 
-	while ((pos = str.find(delimiter)) != std::string::npos)
+	while (position < end)
 	{
-		token = str.substr(0, pos);
-		output.push_back(token);
-		// std::cout << token << std::endl;
-		str.erase(0, pos + delimiter.length());
+		const char* lineEnd = (const char*)std::memchr(position, '\n', end - position);
+
+		if (lineEnd == nullptr)
+			break;
+
+		const char* cursor = SkipSpaces(position, lineEnd);
+
+		// empty line
+		if (cursor == lineEnd)
+		{
+			position = lineEnd + 1;
+			continue;
+		}
+
+		glm::vec3 p;
+
+		for (int i = 0; i < 3; i++)
+		{
+			cursor = SkipSpaces(cursor, lineEnd);
+
+			// from_chars doesn't take a leading plus
+			if (cursor < lineEnd && *cursor == '+')
+				cursor++;
+
+			auto [numberEnd, error] = std::from_chars(cursor, lineEnd, p[i]);
+
+			if (error != std::errc())
+				Debug::ThrowException("Parser => invalid control point '" + std::string(position, std::min(lineEnd, position + 64)) + "'!");
+
+			cursor = numberEnd;
+		}
+
+		if (SkipSpaces(cursor, lineEnd) != lineEnd)
+			Debug::ThrowException("Parser => more than 3 numbers in line '" + std::string(position, std::min(lineEnd, position + 64)) + "'!");
+
+		output.push_back(p);
+		position = lineEnd + 1;
 	}
 
-	output.push_back(str);
+	return position;
 }
@@ -2,17 +2,34 @@
 
 #include <vector>
 #include <string>
+#include <functional>
+#include <cstdint>
 
 #include <glm/glm.hpp>
 
+#define PARSER_BLOCK_SIZE (4u << 20) // bytes read from the file at once
+#define PARSER_MIN_CHUNK_SIZE (1u << 20) // smallest part of a memory mapped file parsed by one job
+#define PARSER_CHUNKS_PER_THREAD 4 // threads take chunks one by one, so one slow chunk doesn't keep the other threads idle
+
+// Control point files: the number of points on the first line, then one point per line (3 floats separated by spaces or tabs).
+// The text is scanned in place with std::from_chars, so there is no allocation per line or per number. ReadFile maps the file
+// and parses it on the shared thread pool, ReadFileChunked reads it in blocks so memory use doesn't depend on the file size.
+// Both also accept binary point files (BinaryPointFile), which are detected by their magic.
 class Parser
 {
 public:
 
 	static void ReadFile(const std::string& filePath, std::vector<glm::vec3>& storeVector);
+	static size_t ReadFileChunked(const std::string& filePath, const unsigned int& chunkSize, const unsigned int& overlap,
+		const std::function<void(const std::vector<glm::vec3>& chunk)>& consumer);
 
 private:
 
-	static void StringSplit(std::string& str, const unsigned int& count,const std::string& delimiter, std::vector<std::string>& output);
+	// points of every block are passed to consumer; pointCount is set from the header before the first call
+	static size_t ReadBlocks(const std::string& filePath, size_t& pointCount, const std::function<void(const glm::vec3* points, const size_t& count)>& consumer);
+	static void ParseParallel(const std::string& filePath, const char* begin, const char* end, const size_t& pointCount, std::vector<glm::vec3>& output);
+	static void CheckPointCount(const std::string& filePath, const size_t& pointCount, const uint64_t& bodySize);
+	static const char* ParseHeader(const char* begin, const char* end, size_t& pointCount);
+	static const char* ParseLines(const char* begin, const char* end, std::vector<glm::vec3>& output);
 
-};
\ No newline at end of file
+};
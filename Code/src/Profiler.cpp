@@ -0,0 +1,321 @@
+#include "Profiler.h"
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Debug.h"
+
+struct CpuZone
+{
+	const char* mName;
+	uint64_t mStart;
+	uint64_t mEnd;
+};
+
+// Written only by its own thread; mCount is published with release so the exporting thread sees complete zones
+struct ThreadBuffer
+{
+	CpuZone mZones[PROFILER_EVENTS_PER_THREAD];
+	std::atomic<unsigned int> mCount{ 0 };
+	std::atomic<unsigned int> mDropped{ 0 };
+	std::atomic<unsigned int> mGeneration{ 0 }; // capture the zones belong to
+	unsigned int mThreadIndex = 0;
+	std::string mName;
+};
+
+struct GpuZone
+{
+	const char* mName;
+	unsigned int mStartQuery;
+	unsigned int mEndQuery;
+};
+
+struct GpuFrame
+{
+	std::vector<GpuZone> mZones;
+	std::vector<unsigned int> mFreeQueries;
+	unsigned int mGeneration = 0;
+};
+
+struct ResolvedGpuZone
+{
+	const char* mName;
+	uint64_t mStart; // already on the CPU timeline
+	uint64_t mEnd;
+};
+
+static std::atomic<bool> sCapturing{ false };
+static std::atomic<unsigned int> sGeneration{ 0 };
+static uint64_t sCaptureStart = 0;
+
+// registration happens once per thread, so a mutex is fine there; recording itself never locks
+static std::mutex sThreadBuffersMutex;
+static std::vector<std::unique_ptr<ThreadBuffer>> sThreadBuffers;
+static thread_local ThreadBuffer* tThreadBuffer = nullptr;
+
+static GpuFrame sGpuFrames[PROFILER_GPU_LATENCY];
+static unsigned int sGpuFrameIndex = 0;
+static int64_t sGpuClockOffset = 0; // GPU timestamp - CPU time
+static std::vector<ResolvedGpuZone> sGpuZones;
+
+static ThreadBuffer& GetThreadBuffer()
+{
+	if (!tThreadBuffer)
+	{
+		std::lock_guard<std::mutex> lock(sThreadBuffersMutex);
+
+		sThreadBuffers.push_back(std::make_unique<ThreadBuffer>());
+		tThreadBuffer = sThreadBuffers.back().get();
+		tThreadBuffer->mThreadIndex = (unsigned int)sThreadBuffers.size();
+		tThreadBuffer->mName = "Thread " + STRING(tThreadBuffer->mThreadIndex);
+	}
+
+	return *tThreadBuffer;
+}
+
+static unsigned int AllocateQuery(GpuFrame& frame)
+{
+	if (frame.mFreeQueries.empty())
+	{
+		unsigned int query;
+		glGenQueries(1, &query);
+
+		return query;
+	}
+
+	unsigned int query = frame.mFreeQueries.back();
+	frame.mFreeQueries.pop_back();
+
+	return query;
+}
+
+static std::string EscapeJson(const std::string& text)
+{
+	std::string escaped;
+
+	for (const auto& c : text)
+	{
+		if (c == '"' || c == '\\')
+			escaped += '\\';
+
+		escaped += c;
+	}
+
+	return escaped;
+}
+
+/// <summary>
+/// Starts recording; zones of a previous capture are discarded
+/// </summary>
+/// 
+void Profiler::BeginCapture()
+{
+	if (sCapturing)
+		return;
+
+	sGpuZones.clear();
+	sCaptureStart = Now();
+
+	CalibrateGpuClock();
+
+	sGeneration++;
+	sCapturing = true;
+}
+
+void Profiler::EndCapture()
+{
+	if (!sCapturing)
+		return;
+
+	sCapturing = false;
+
+	// zones still in flight on the GPU
+	for (unsigned int slot = 0; slot < PROFILER_GPU_LATENCY; slot++)
+	{
+		ReadGpuFrame(slot);
+	}
+}
+
+bool Profiler::IsCapturing()
+{
+	return sCapturing.load(std::memory_order_relaxed);
+}
+
+void Profiler::EndFrame()
+{
+	if (!sCapturing)
+		return;
+
+	sGpuFrameIndex++;
+
+	// the slot about to be reused was issued PROFILER_GPU_LATENCY frames ago, so its results are normally available
+	ReadGpuFrame(sGpuFrameIndex % PROFILER_GPU_LATENCY);
+
+	CalibrateGpuClock();
+}
+
+/// <summary>
+/// Writes the last capture in the Chrome trace event format (chrome://tracing, ui.perfetto.dev)
+/// </summary>
+/// 
+void Profiler::WriteChromeTrace(const std::string& filePath)
+{
+	if (sCapturing)
+		Debug::ThrowException("Profiler => can't export while capturing!");
+
+	std::ofstream file(filePath);
+
+	if (!file.is_open())
+		Debug::ThrowException("Profiler => couldn't open file '" + filePath + "' for writing!");
+
+	unsigned int generation = sGeneration;
+	unsigned int zoneCount = 0;
+	unsigned int dropped = 0;
+	bool first = true;
+
+	auto writeZone = [&](const char* name, const uint64_t& start, const uint64_t& end, const unsigned int& threadIndex)
+	{
+		file << (first ? "\n" : ",\n");
+		file << "{\"name\":\"" << EscapeJson(name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadIndex
+			<< ",\"ts\":" << (start - sCaptureStart) / 1000.0 << ",\"dur\":" << (end - start) / 1000.0 << "}";
+
+		first = false;
+		zoneCount++;
+	};
+
+	file << "{\"traceEvents\":[";
+
+	std::lock_guard<std::mutex> lock(sThreadBuffersMutex);
+
+	for (const auto& buffer : sThreadBuffers)
+	{
+		file << (first ? "\n" : ",\n");
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->mThreadIndex << ",\"args\":{\"name\":\"" << EscapeJson(buffer->mName) << "\"}}";
+		first = false;
+
+		if (buffer->mGeneration.load(std::memory_order_acquire) != generation)
+			continue;
+
+		unsigned int count = buffer->mCount.load(std::memory_order_acquire);
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const CpuZone& zone = buffer->mZones[i];
+
+			if (zone.mStart >= sCaptureStart)
+				writeZone(zone.mName, zone.mStart, zone.mEnd, buffer->mThreadIndex);
+		}
+
+		dropped += buffer->mDropped;
+	}
+
+	file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+
+	for (const auto& zone : sGpuZones)
+	{
+		if (zone.mStart >= sCaptureStart)
+			writeZone(zone.mName, zone.mStart, zone.mEnd, 0);
+	}
+
+	file << "\n]}\n";
+
+	Debug::Print("Profiler trace with " + STRING(zoneCount) + " zones written to '" + filePath + "'" + (dropped ? " (" + STRING(dropped) + " zones dropped)" : ""));
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	GetThreadBuffer().mName = name;
+}
+
+uint64_t Profiler::Now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::RecordCpuZone(const char* name, const uint64_t& start, const uint64_t& end)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	// first zone of a new capture on this thread; only this thread ever resets its buffer
+	unsigned int generation = sGeneration.load(std::memory_order_relaxed);
+	if (buffer.mGeneration.load(std::memory_order_relaxed) != generation)
+	{
+		buffer.mCount.store(0, std::memory_order_relaxed);
+		buffer.mDropped.store(0, std::memory_order_relaxed);
+		buffer.mGeneration.store(generation, std::memory_order_release);
+	}
+
+	unsigned int count = buffer.mCount.load(std::memory_order_relaxed);
+
+	if (count >= PROFILER_EVENTS_PER_THREAD)
+	{
+		buffer.mDropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.mZones[count] = { name, start, end };
+	buffer.mCount.store(count + 1, std::memory_order_release);
+}
+
+// Timestamp queries instead of GL_TIME_ELAPSED: elapsed queries can't be nested and don't tell where a zone starts
+int Profiler::BeginGpuZone(const char* name)
+{
+	GpuFrame& frame = sGpuFrames[sGpuFrameIndex % PROFILER_GPU_LATENCY];
+	frame.mGeneration = sGeneration;
+
+	GpuZone zone{ name, AllocateQuery(frame), AllocateQuery(frame) };
+	glQueryCounter(zone.mStartQuery, GL_TIMESTAMP);
+
+	frame.mZones.push_back(zone);
+
+	return (int)frame.mZones.size() - 1;
+}
+
+void Profiler::EndGpuZone(const int& zone)
+{
+	GpuFrame& frame = sGpuFrames[sGpuFrameIndex % PROFILER_GPU_LATENCY];
+
+	if (zone < 0 || zone >= (int)frame.mZones.size())
+		return; // frame ended in between
+
+	glQueryCounter(frame.mZones[zone].mEndQuery, GL_TIMESTAMP);
+}
+
+void Profiler::ReadGpuFrame(const unsigned int& slot)
+{
+	GpuFrame& frame = sGpuFrames[slot];
+
+	for (const auto& zone : frame.mZones)
+	{
+		GLuint64 start = 0;
+		GLuint64 end = 0;
+
+		// blocks only if the GPU is more than PROFILER_GPU_LATENCY frames behind
+		glGetQueryObjectui64v(zone.mStartQuery, GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(zone.mEndQuery, GL_QUERY_RESULT, &end);
+
+		if (frame.mGeneration == sGeneration && end >= start)
+			sGpuZones.push_back({ zone.mName, (uint64_t)((int64_t)start - sGpuClockOffset), (uint64_t)((int64_t)end - sGpuClockOffset) });
+
+		frame.mFreeQueries.push_back(zone.mStartQuery);
+		frame.mFreeQueries.push_back(zone.mEndQuery);
+	}
+
+	frame.mZones.clear();
+}
+
+// GL_TIMESTAMP and the CPU clock have different origins; the offset drifts slowly, so it is refreshed every frame
+void Profiler::CalibrateGpuClock()
+{
+	GLint64 gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+
+	sGpuClockOffset = (int64_t)gpuTime - (int64_t)Now();
+}
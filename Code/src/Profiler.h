@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#define PROFILER_ENABLED 1
+
+#define PROFILER_EVENTS_PER_THREAD 65536 // per capture; later events are dropped and counted
+#define PROFILER_GPU_LATENCY 4 // frames between issuing GPU queries and reading them back
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED
+// name has to be a string literal (only the pointer is stored)
+#define PROFILE_SCOPE(name) ProfileScope PROFILER_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILER_CONCAT(gpuProfileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#endif
+
+// Hierarchical CPU/GPU profiler. CPU zones go to per-thread buffers without locking, GPU zones use
+// timestamp queries which are read back PROFILER_GPU_LATENCY frames later. Nothing is recorded outside a capture.
+class Profiler
+{
+public:
+
+	static void BeginCapture();
+	static void EndCapture();
+	static bool IsCapturing();
+
+	static void EndFrame(); // call once per frame on the GL thread, after the swap
+
+	static void WriteChromeTrace(const std::string& filePath);
+
+	static void SetThreadName(const std::string& name);
+
+	static uint64_t Now(); // nanoseconds, monotonic
+
+	static void RecordCpuZone(const char* name, const uint64_t& start, const uint64_t& end);
+	static int BeginGpuZone(const char* name);
+	static void EndGpuZone(const int& zone);
+
+private:
+
+	static void ReadGpuFrame(const unsigned int& slot);
+	static void CalibrateGpuClock();
+
+};
+
+class ProfileScope
+{
+public:
+
+	ProfileScope(const char* name)
+		:
+		mName(name),
+		mStart(Profiler::IsCapturing() ? Profiler::Now() : 0)
+	{
+	}
+
+	~ProfileScope()
+	{
+		if (mStart != 0)
+			Profiler::RecordCpuZone(mName, mStart, Profiler::Now());
+	}
+
+private:
+
+	const char* mName;
+	uint64_t mStart;
+
+};
+
+// Only valid on the thread owning the GL context
+class GpuProfileScope
+{
+public:
+
+	GpuProfileScope(const char* name)
+		:
+		mZone(Profiler::IsCapturing() ? Profiler::BeginGpuZone(name) : -1)
+	{
+	}
+
+	~GpuProfileScope()
+	{
+		if (mZone != -1)
+			Profiler::EndGpuZone(mZone);
+	}
+
+private:
+
+	int mZone;
+
+};
@@ -1,26 +1,271 @@
 #include "Renderer.h"
 
-Renderer::Renderer(Shader& shader)
+#include <algorithm>
+
+#include "Profiler.h"
+
+Renderer::Renderer(Shader& shader, ThreadPool* threadPool)
 	:
-	mShader(shader)
+	mShader(shader),
+	mThreadPool(threadPool ? *threadPool : ThreadPool::GetShared())
 {
+	unsigned int alignment = UniformBuffer::GetOffsetAlignment();
+	mConstantsStride = (unsigned int)((sizeof(ObjectBlock) + alignment - 1) / alignment * alignment);
+
+	mDrawLists.resize(mThreadPool.GetThreadCount() + 1);
+	mDrawListStats.resize(mDrawLists.size());
+	mListConstantsBase.resize(mDrawLists.size());
+
+	for (auto& list : mDrawLists)
+	{
+		list.SetConstantsStride(mConstantsStride);
+	}
 }
 
-void Renderer::Draw() const
+void Renderer::Draw()
 {
-	mShader.Bind();
+	PROFILE_SCOPE("Renderer::Draw");
+
+	mStats = CullStats();
 
-	for (const auto& obj : mDrawableObjects)
+	UpdateBounds();
+	GatherCandidates();
+	BuildDrawLists();
+	MergeDrawLists();
+	Submit();
+}
+
+void Renderer::AddDrawableObject(Drawable& object)
+{
+	RenderProxy proxy;
+	proxy.mObject = &object;
+	proxy.mLocalBounds = object.GetLocalBounds();
+	proxy.mTransformVersion = object.GetTransform().GetVersion();
+
+	if (!proxy.mLocalBounds.IsValid())
 	{
-		if (obj->IsActive())
+		mUnboundedProxies.push_back(proxy);
+		return;
+	}
+
+	proxy.mWorldBounds = proxy.mLocalBounds.Transformed(object.GetTransform().GetMatrix());
+
+	mProxies.push_back(proxy);
+	mProxies.back().mLeaf = mBVH.Insert(proxy.mWorldBounds, &mProxies.back());
+}
+
+void Renderer::SetViewProjection(const glm::mat4& viewProjection)
+{
+	mFrustum.Update(viewProjection);
+	mViewProjection = viewProjection;
+	mHasViewProjection = true;
+}
+
+void Renderer::SetCullingEnabled(const bool& enabled)
+{
+	mCullingEnabled = enabled;
+}
+
+// Occluders are rasterized every frame with the current view projection; null disables occlusion culling
+void Renderer::SetOcclusionCuller(OcclusionCuller* occlusionCuller)
+{
+	mOcclusionCuller = occlusionCuller;
+}
+
+const CullStats& Renderer::GetStats() const
+{
+	return mStats;
+}
+
+// Refits only the objects whose transform changed since the last frame.
+// Also makes sure every model matrix is up to date before the workers read them concurrently.
+void Renderer::UpdateBounds()
+{
+	PROFILE_SCOPE("Renderer::UpdateBounds");
+
+	for (auto& proxy : mProxies)
+	{
+		Transform& transform = proxy.mObject->GetTransform();
+
+		if (transform.GetVersion() == proxy.mTransformVersion)
+			continue;
+
+		proxy.mTransformVersion = transform.GetVersion();
+		proxy.mWorldBounds = proxy.mLocalBounds.Transformed(transform.GetMatrix());
+		mBVH.Refit(proxy.mLeaf, proxy.mWorldBounds);
+	}
+
+	for (auto& proxy : mUnboundedProxies)
+	{
+		proxy.mObject->GetTransform().GetMatrix();
+	}
+}
+
+void Renderer::GatherCandidates()
+{
+	PROFILE_SCOPE("Renderer::GatherCandidates");
+
+	mCandidates.clear();
+
+	if (mCullingEnabled && mHasViewProjection)
+	{
+		mBVH.QueryFrustum(mFrustum, mVisibleObjects, mStats);
+
+		for (const auto& obj : mVisibleObjects)
+		{
+			mCandidates.push_back(static_cast<RenderProxy*>(obj));
+		}
+
+		if (mOcclusionCuller)
+			mOcclusionCuller->Render(mViewProjection);
+	}
+	else
+	{
+		for (auto& proxy : mProxies)
 		{
-			mShader.SetUniformMatrix4f("model", obj->GetTransform().GetMatrix());
-			obj->Draw();
+			mCandidates.push_back(&proxy);
 		}
 	}
+
+	for (auto& proxy : mUnboundedProxies)
+	{
+		mCandidates.push_back(&proxy);
+	}
 }
 
-void Renderer::AddDrawableObject(Drawable& object)
+void Renderer::BuildDrawLists()
 {
-	mDrawableObjects.push_back(&object);
+	unsigned int listCount = (unsigned int)mDrawLists.size();
+	unsigned int candidateCount = (unsigned int)mCandidates.size();
+
+	mThreadPool.ParallelFor(listCount, [this, listCount, candidateCount](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int listIndex = begin; listIndex < end; listIndex++)
+		{
+			PROFILE_SCOPE("Renderer::BuildDrawList");
+
+			DrawList& list = mDrawLists[listIndex];
+			CullStats& stats = mDrawListStats[listIndex];
+
+			list.Clear();
+			stats = CullStats();
+
+			unsigned int first = (unsigned int)((uint64_t)candidateCount * listIndex / listCount);
+			unsigned int last = (unsigned int)((uint64_t)candidateCount * (listIndex + 1) / listCount);
+
+			for (unsigned int i = first; i < last; i++)
+			{
+				RecordDraw(list, *mCandidates[i], stats);
+			}
+
+			list.Sort();
+		}
+	});
+}
+
+// Runs on a worker thread; must not touch GL or any shared state besides reading the proxy
+void Renderer::RecordDraw(DrawList& list, RenderProxy& proxy, CullStats& stats) const
+{
+	Drawable& object = *proxy.mObject;
+
+	if (!object.IsActive())
+		return;
+
+	unsigned int lod = 0;
+	float depth = 0.0f;
+
+	if (proxy.mLeaf != BVH_NULL_NODE && mHasViewProjection)
+	{
+		if (mCullingEnabled && mOcclusionCuller && !mOcclusionCuller->IsVisible(proxy.mWorldBounds))
+		{
+			stats.mOccluded++;
+			return;
+		}
+
+		glm::vec4 center = mViewProjection * glm::vec4(proxy.mWorldBounds.GetCenter(), 1.0f);
+		depth = center.w;
+
+		// the y row of the view projection scales view space distances to clip space (view matrix is orthonormal)
+		float projectionScale = glm::length(glm::vec3(mViewProjection[0][1], mViewProjection[1][1], mViewProjection[2][1]));
+		float screenSize = glm::length(proxy.mWorldBounds.GetExtents()) * projectionScale / std::max(center.w, 1e-4f);
+
+		float threshold = RENDERER_LOD_SCREEN_SIZE;
+		unsigned int lodCount = object.GetLodCount();
+
+		while (lod + 1 < lodCount && screenSize < threshold)
+		{
+			lod++;
+			threshold *= 0.5f;
+		}
+	}
+
+	ObjectBlock constants;
+	constants.mModel = object.GetTransform().GetMatrix();
+	constants.mNormalMatrix = glm::transpose(glm::inverse(constants.mModel));
+
+	list.Add(object, DrawList::MakeSortKey(object.GetMaterialID(), lod, depth), lod, constants);
+
+	stats.mDrawn++;
+}
+
+// Lists are already sorted by their workers, so merging is linear per list
+void Renderer::MergeDrawLists()
+{
+	PROFILE_SCOPE("Renderer::MergeDrawLists");
+
+	mCommands.clear();
+
+	unsigned int constantsBase = 0;
+
+	for (size_t i = 0; i < mDrawLists.size(); i++)
+	{
+		const DrawList& list = mDrawLists[i];
+		mListConstantsBase[i] = constantsBase;
+
+		size_t middle = mCommands.size();
+
+		for (const auto& command : list.GetCommands())
+		{
+			mCommands.push_back(command);
+			mCommands.back().mConstantsIndex += constantsBase;
+		}
+
+		std::inplace_merge(mCommands.begin(), mCommands.begin() + middle, mCommands.end(), [](const DrawCommand& a, const DrawCommand& b) { return a.mSortKey < b.mSortKey; });
+
+		constantsBase += list.GetSize();
+
+		mStats.mOccluded += mDrawListStats[i].mOccluded;
+		mStats.mDrawn += mDrawListStats[i].mDrawn;
+	}
+}
+
+void Renderer::Submit()
+{
+	PROFILE_SCOPE("Renderer::Submit");
+	PROFILE_GPU_SCOPE("Renderer::Submit");
+
+	if (mCommands.empty())
+		return;
+
+	unsigned int requiredSize = (unsigned int)mCommands.size() * mConstantsStride;
+
+	if (requiredSize > mObjectConstants.GetSize())
+		mObjectConstants.Resize(std::max(requiredSize, mObjectConstants.GetSize() * 2));
+
+	// one upload per list instead of one per draw
+	for (size_t i = 0; i < mDrawLists.size(); i++)
+	{
+		const std::vector<unsigned char>& constants = mDrawLists[i].GetConstants();
+
+		if (!constants.empty())
+			mObjectConstants.Update(constants.data(), (unsigned int)constants.size(), mListConstantsBase[i] * mConstantsStride);
+	}
+
+	mShader.Bind();
+
+	for (const auto& command : mCommands)
+	{
+		mObjectConstants.BindRange(command.mConstantsIndex * mConstantsStride, sizeof(ObjectBlock));
+		command.mObject->DrawLod(command.mLod);
+	}
 }
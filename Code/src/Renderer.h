@@ -1,25 +1,79 @@
 #pragma once
 
 #include<vector>
+#include<deque>
 
 #include "VertexArray.h"
 #include "Shader.h"
 #include "Drawable.h"
+#include "UniformBuffer.h"
+#include "BVH.h"
+#include "Frustum.h"
+#include "OcclusionCuller.h"
+#include "DrawList.h"
+#include "ThreadPool.h"
 
+#define RENDERER_LOD_SCREEN_SIZE 0.25f // projected radius (in NDC) below which the next lod is used; halves with every lod
+
+struct RenderProxy
+{
+	Drawable* mObject = nullptr;
+	int mLeaf = BVH_NULL_NODE; // BVH_NULL_NODE for objects without bounds (always drawn)
+	unsigned int mTransformVersion = 0;
+	AABB mLocalBounds;
+	AABB mWorldBounds;
+};
+
+// Culling, lod selection, sorting and constant packing run on worker threads into per-thread draw lists;
+// only the merge and the GL submission run on the thread owning the context
 class Renderer
 {
 public:
 
-	Renderer(Shader& shader);
+	Renderer(Shader& shader, ThreadPool* threadPool = nullptr);
 	~Renderer() = default;
 
-	void Draw() const;
+	void Draw();
 
 	void AddDrawableObject(Drawable& object);
 
+	void SetViewProjection(const glm::mat4& viewProjection);
+	void SetCullingEnabled(const bool& enabled);
+	void SetOcclusionCuller(OcclusionCuller* occlusionCuller);
+
+	const CullStats& GetStats() const;
+
 private:
 
-	std::vector<Drawable*> mDrawableObjects;
+	void UpdateBounds();
+	void GatherCandidates();
+	void BuildDrawLists();
+	void RecordDraw(DrawList& list, RenderProxy& proxy, CullStats& stats) const;
+	void MergeDrawLists();
+	void Submit();
+
+	std::deque<RenderProxy> mProxies; // deque keeps the proxy addresses stored in the BVH stable
+	std::deque<RenderProxy> mUnboundedProxies;
+	std::vector<void*> mVisibleObjects;
+	std::vector<RenderProxy*> mCandidates;
+
 	Shader& mShader; // temporary; should be assigned for each mesh (/poly)?
+	ThreadPool& mThreadPool;
+
+	std::vector<DrawList> mDrawLists; // one per worker
+	std::vector<CullStats> mDrawListStats;
+	std::vector<DrawCommand> mCommands; // merged and sorted, mConstantsIndex is global
+	std::vector<unsigned int> mListConstantsBase;
+
+	UniformBuffer mObjectConstants{ sizeof(ObjectBlock), OBJECT_BLOCK_BINDING };
+	unsigned int mConstantsStride = sizeof(ObjectBlock);
+
+	BVH mBVH;
+	Frustum mFrustum;
+	glm::mat4 mViewProjection{ 1.0f };
+	OcclusionCuller* mOcclusionCuller = nullptr;
+	bool mCullingEnabled = true;
+	bool mHasViewProjection = false;
+	CullStats mStats;
 
-};
\ No newline at end of file
+};
@@ -6,16 +6,54 @@
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <filesystem>
+#include <cstring>
 
 #include "Debug.h"
+#include "TimeControl.h"
+
+#define PROGRAM_BINARY_MAGIC 0x4E494253 // "SBIN"
+
+struct ProgramBinaryHeader
+{
+	unsigned int mMagic = PROGRAM_BINARY_MAGIC;
+	unsigned int mFormat = 0;
+	uint64_t mHash = 0;
+	unsigned int mLength = 0; // in bytes
+	unsigned int mPadding = 0;
+};
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 unsigned int Shader::ActiveShader = 0;
 
+bool Shader::ParallelCompilationSupported = false;
+
+bool Shader::BinaryCacheEnabled = true;
+std::string Shader::BinaryCacheDirectory{};
+
 Shader::Shader(const std::string& filePath)
 	:
 	mFilePath(filePath)
 {
-	Init(filePath);
+	Init(filePath, false);
+}
+
+/// <summary>
+/// Builds a permutation of the shader file
+/// </summary>
+/// <param name="filePath">Path to the shader file</param>
+/// <param name="defines">"NAME VALUE" (or just "NAME") entries, each becomes a #define in every stage</param>
+/// <param name="deferred">Only submit the compile; poll IsReady() before using the shader</param>
+/// 
+Shader::Shader(const std::string& filePath, const std::vector<std::string>& defines, const bool& deferred)
+	:
+	mFilePath(filePath),
+	mDefines(defines)
+{
+	Init(filePath, deferred);
 }
 
 void Shader::Bind() const
@@ -23,6 +61,9 @@ void Shader::Bind() const
 	if (mRendererID == 0)
 		Debug::ThrowException("ERROR: Shader mRendererID not set or shader not initiated!!!");
 
+	if (mPending)
+		Debug::ThrowException("ERROR: Shader is still compiling! (check IsReady() or call Finalize() first; file = " + mFilePath + ")");
+
 	if(ActiveShader != mRendererID)
 		glUseProgram(mRendererID);
 
@@ -48,7 +89,7 @@ void Shader::SetUniformMatrix4f(const std::string& name, const glm::mat4& matrix
 	glUniformMatrix4fv(location, 1, GL_FALSE, &matrix[0][0]);
 }
 
-void Shader::SetUniform1i(const std::string name, const int& value)
+void Shader::SetUniform1i(const std::string& name, const int& value)
 {
 	Bind();
 
@@ -96,47 +137,426 @@ void Shader::SetUniform3fv(const std::string& name, const glm::vec3& vec3f)
 	glUniform3fv(location, 1, &vec3f[0]);
 }
 
+template<typename T>
+static unsigned int UniformGLType();
+
+template<> unsigned int UniformGLType<int>() { return GL_INT; }
+template<> unsigned int UniformGLType<float>() { return GL_FLOAT; }
+template<> unsigned int UniformGLType<glm::vec3>() { return GL_FLOAT_VEC3; }
+template<> unsigned int UniformGLType<glm::vec4>() { return GL_FLOAT_VEC4; }
+template<> unsigned int UniformGLType<glm::mat4>() { return GL_FLOAT_MAT4; }
+
+/// <summary>
+/// Resolves a uniform once; the returned handle can be used every frame without any string work
+/// </summary>
+/// <param name="name">Uniform name; array elements can be given as "name[i]"</param>
+/// <returns>Invalid handle (mLocation = -1) if the uniform doesn't exist or the type doesn't match</returns>
+/// 
+template<typename T>
+UniformHandle<T> Shader::GetUniformHandle(const std::string& name) const
+{
+	int arrayIndex = 0;
+	const UniformInfo* info = FindUniform(name, arrayIndex);
+
+	if (info == nullptr)
+	{
+		std::cout << "There is no uniform with name \"" << name << "\"! (mRendererID = " << mRendererID << "; check whether the uniform is used in GLSL shader)" << std::endl;
+		return {};
+	}
+
+	// samplers are set the same way as ints
+	bool isSampler = (UniformGLType<T>() == GL_INT) && (info->mType == GL_SAMPLER_2D || info->mType == GL_SAMPLER_CUBE);
+
+	if (info->mType != UniformGLType<T>() && !isSampler)
+	{
+		std::cout << "Uniform \"" << name << "\" has a different type than requested! (mRendererID = " << mRendererID << ")" << std::endl;
+		return {};
+	}
+
+	if (arrayIndex >= info->mArraySize)
+		return {};
+
+	return { info->mLocation + arrayIndex };
+}
+
+template UniformHandle<int> Shader::GetUniformHandle<int>(const std::string& name) const;
+template UniformHandle<float> Shader::GetUniformHandle<float>(const std::string& name) const;
+template UniformHandle<glm::vec3> Shader::GetUniformHandle<glm::vec3>(const std::string& name) const;
+template UniformHandle<glm::vec4> Shader::GetUniformHandle<glm::vec4>(const std::string& name) const;
+template UniformHandle<glm::mat4> Shader::GetUniformHandle<glm::mat4>(const std::string& name) const;
+
+void Shader::SetUniform(const UniformHandle<int>& handle, const int& value) const
+{
+	if (handle.IsValid())
+		glProgramUniform1i(mRendererID, handle.mLocation, value);
+}
+
+void Shader::SetUniform(const UniformHandle<float>& handle, const float& value) const
+{
+	if (handle.IsValid())
+		glProgramUniform1f(mRendererID, handle.mLocation, value);
+}
+
+void Shader::SetUniform(const UniformHandle<glm::vec3>& handle, const glm::vec3& value) const
+{
+	if (handle.IsValid())
+		glProgramUniform3fv(mRendererID, handle.mLocation, 1, &value[0]);
+}
+
+void Shader::SetUniform(const UniformHandle<glm::vec4>& handle, const glm::vec4& value) const
+{
+	if (handle.IsValid())
+		glProgramUniform4fv(mRendererID, handle.mLocation, 1, &value[0]);
+}
+
+void Shader::SetUniform(const UniformHandle<glm::mat4>& handle, const glm::mat4& value) const
+{
+	if (handle.IsValid())
+		glProgramUniformMatrix4fv(mRendererID, handle.mLocation, 1, GL_FALSE, &value[0][0]);
+}
+
+void Shader::SetUniform(const UniformHandle<glm::mat4>& handle, const glm::mat4* values, const unsigned int& count) const
+{
+	if (handle.IsValid() && count != 0)
+		glProgramUniformMatrix4fv(mRendererID, handle.mLocation, count, GL_FALSE, &values[0][0][0]);
+}
+
+void Shader::BindUniformBlock(const std::string& blockName, const unsigned int& bindingPoint) const
+{
+	unsigned int blockIndex = glGetUniformBlockIndex(mRendererID, blockName.c_str());
+
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		std::cout << "There is no uniform block with name \"" << blockName << "\"! (mRendererID = " << mRendererID << ")" << std::endl;
+		return;
+	}
+
+	glUniformBlockBinding(mRendererID, blockIndex, bindingPoint);
+}
+
+const std::vector<UniformInfo>& Shader::GetUniforms() const
+{
+	return mUniforms;
+}
+
+const unsigned int& Shader::GetRendererID() const
+{
+	return mRendererID;
+}
+
+const bool& Shader::IsLoadedFromCache() const
+{
+	return mLoadedFromCache;
+}
+
+double Shader::GetLoadTime() const
+{
+	return mLoadTime;
+}
+
+/// <summary>
+/// 
+/// </summary>
+/// <param name="directory">Where program binaries are stored; empty = "Cache" folder next to the shader file</param>
+/// 
+void Shader::SetBinaryCacheDirectory(const std::string& directory)
+{
+	BinaryCacheDirectory = directory;
+}
+
+void Shader::SetBinaryCacheEnabled(const bool& enabled)
+{
+	BinaryCacheEnabled = enabled;
+}
+
 Shader::~Shader()
 {
 	glDeleteProgram(mRendererID);
 }
 
-void Shader::Init(const std::string& filePath)
+void Shader::Init(const std::string& filePath, const bool& deferred)
 {
 	ShaderProgramSource source = ReadShaderFile(filePath);
 
+	mLoadTimer.Start();
+
+	mSourceHash = HashProgramSource(source);
+
 	mRendererID = glCreateProgram();
-	unsigned int shader;
-	std::vector<unsigned int> shaders{};
+	mLoadedFromCache = LoadProgramBinary(mSourceHash);
 
-	if (source.Vertex.size() != 0)
+	if (!mLoadedFromCache)
 	{
-		shader = CompileShader(GL_VERTEX_SHADER, source.Vertex);
-		glAttachShader(mRendererID, shader);
-		shaders.push_back(shader);
+		// binary missing or rejected by the driver (e.g. after a driver update)
+		glDeleteProgram(mRendererID);
+		mRendererID = glCreateProgram();
+
+		SubmitFromSource(source);
 	}
 
+	mPending = true;
+
+	if (!deferred)
+		Finalize();
+}
+
+/// <summary>
+/// Only submits compile and link commands; no status is queried, so with parallel compilation the driver works on it in the background
+/// </summary>
+/// 
+void Shader::SubmitFromSource(const ShaderProgramSource& source)
+{
+	if (source.Vertex.size() != 0)
+		mPendingShaders.push_back({ SubmitShader(GL_VERTEX_SHADER, source.Vertex), GL_VERTEX_SHADER });
+
 	if (source.Fragment.size() != 0)
-	{
-		shader = CompileShader(GL_FRAGMENT_SHADER, source.Fragment);
-		glAttachShader(mRendererID, shader);
-		shaders.push_back(shader);
-	}
+		mPendingShaders.push_back({ SubmitShader(GL_FRAGMENT_SHADER, source.Fragment), GL_FRAGMENT_SHADER });
 
 	if (source.Geometry.size() != 0)
+		mPendingShaders.push_back({ SubmitShader(GL_GEOMETRY_SHADER, source.Geometry), GL_GEOMETRY_SHADER });
+
+	if (source.TessControl.size() != 0)
+		mPendingShaders.push_back({ SubmitShader(GL_TESS_CONTROL_SHADER, source.TessControl), GL_TESS_CONTROL_SHADER });
+
+	if (source.TessEvaluation.size() != 0)
+		mPendingShaders.push_back({ SubmitShader(GL_TESS_EVALUATION_SHADER, source.TessEvaluation), GL_TESS_EVALUATION_SHADER });
+
+	for (const auto& shader : mPendingShaders)
 	{
-		shader = CompileShader(GL_GEOMETRY_SHADER, source.Geometry);
-		glAttachShader(mRendererID, shader);
-		shaders.push_back(shader);
+		glAttachShader(mRendererID, shader.first);
 	}
 
+	glProgramParameteri(mRendererID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	glLinkProgram(mRendererID);
-	glValidateProgram(mRendererID);
+}
+
+/// <summary>
+/// Non-blocking check whether the program can be used; finalizes the program once the driver is done
+/// </summary>
+/// <returns>True if the program is linked and ready to be bound</returns>
+/// 
+bool Shader::IsReady()
+{
+	if (!mPending)
+		return true;
 
-	for (auto& s : shaders)
+	if (ParallelCompilationSupported && !mLoadedFromCache)
 	{
-		glDeleteShader(s);
+		int completed = GL_FALSE;
+		glGetProgramiv(mRendererID, GL_COMPLETION_STATUS_KHR, &completed);
+
+		if (completed == GL_FALSE)
+			return false;
 	}
+
+	Finalize();
+
+	return true;
+}
+
+/// <summary>
+/// Blocks until the program is compiled and linked (status queries wait for the driver)
+/// </summary>
+/// 
+void Shader::Finalize()
+{
+	if (!mPending)
+		return;
+
+	if (!mLoadedFromCache)
+	{
+		for (const auto& shader : mPendingShaders)
+		{
+			CheckCompileStatus(shader.first, shader.second);
+		}
+
+		int result, length;
+		glGetProgramiv(mRendererID, GL_LINK_STATUS, &result);
+
+		if (result == GL_FALSE)
+		{
+			glGetProgramiv(mRendererID, GL_INFO_LOG_LENGTH, &length);
+			std::vector<char> msg(length + 1);
+			glGetProgramInfoLog(mRendererID, length, &length, msg.data());
+
+			std::cout << "Failed to link shader program! (file = " << mFilePath << ")" << std::endl;
+			std::cout << msg.data() << std::endl;
+		}
+
+		glValidateProgram(mRendererID);
+
+		for (const auto& shader : mPendingShaders)
+		{
+			glDetachShader(mRendererID, shader.first);
+			glDeleteShader(shader.first);
+		}
+
+		mPendingShaders.clear();
+
+		if (result != GL_FALSE)
+			SaveProgramBinary(mSourceHash);
+	}
+
+	ReflectUniforms();
+
+	mPending = false;
+	mLoadTime = mLoadTimer.End();
+
+	printf("Shader \"%s\" %s in %.3f ms\n", mFilePath.c_str(), mLoadedFromCache ? "loaded from binary cache (warm start)" : "compiled from source (cold start)", mLoadTime * 1000.0);
+}
+
+/// <summary>
+/// Lets the driver compile shaders on its own threads (KHR/ARB_parallel_shader_compile); has to be called after glewInit
+/// </summary>
+/// <returns>True if the extension is available</returns>
+/// 
+bool Shader::EnableParallelCompilation()
+{
+	ParallelCompilationSupported = false;
+
+#ifdef GL_KHR_parallel_shader_compile
+	if (GLEW_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		ParallelCompilationSupported = true;
+	}
+#endif
+
+#ifdef GL_ARB_parallel_shader_compile
+	if (!ParallelCompilationSupported && GLEW_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+		ParallelCompilationSupported = true;
+	}
+#endif
+
+	Debug::Print(std::string("Parallel shader compilation ") + (ParallelCompilationSupported ? "enabled" : "not supported"));
+
+	return ParallelCompilationSupported;
+}
+
+/// <summary>
+/// Hash of everything that makes a program binary valid: the source of every stage and the driver that produced it
+/// </summary>
+/// <returns>64-bit FNV-1a hash</returns>
+/// 
+uint64_t Shader::HashProgramSource(const ShaderProgramSource& source)
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	auto hashString = [&hash](const char* str, const size_t& length)
+	{
+		for (size_t i = 0; i < length; i++)
+		{
+			hash ^= (unsigned char)str[i];
+			hash *= 1099511628211ull;
+		}
+
+		// separator, so "ab" + "c" and "a" + "bc" don't collide
+		hash ^= 0xff;
+		hash *= 1099511628211ull;
+	};
+
+	hashString(source.Vertex.c_str(), source.Vertex.size());
+	hashString(source.Fragment.c_str(), source.Fragment.size());
+	hashString(source.Geometry.c_str(), source.Geometry.size());
+	hashString(source.TessControl.c_str(), source.TessControl.size());
+	hashString(source.TessEvaluation.c_str(), source.TessEvaluation.size());
+
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+
+	for (const auto& name : driverStrings)
+	{
+		const char* str = (const char*)glGetString(name);
+
+		if (str != nullptr)
+			hashString(str, strlen(str));
+	}
+
+	return hash;
+}
+
+std::string Shader::GetBinaryCachePath(const uint64_t& hash) const
+{
+	char fileName[32];
+	snprintf(fileName, sizeof(fileName), "%016llx.bin", (unsigned long long)hash);
+
+	std::filesystem::path directory = BinaryCacheDirectory.empty() ? std::filesystem::path(mFilePath).parent_path() / "Cache" : std::filesystem::path(BinaryCacheDirectory);
+
+	return (directory / fileName).string();
+}
+
+bool Shader::LoadProgramBinary(const uint64_t& hash)
+{
+	if (!BinaryCacheEnabled)
+		return false;
+
+	std::ifstream file(GetBinaryCachePath(hash), std::ios::binary);
+
+	if (!file.is_open())
+		return false;
+
+	ProgramBinaryHeader header;
+	file.read((char*)&header, sizeof(header));
+
+	if (!file || header.mMagic != PROGRAM_BINARY_MAGIC || header.mHash != hash || header.mLength == 0)
+		return false;
+
+	std::vector<char> binary(header.mLength);
+	file.read(binary.data(), binary.size());
+
+	if (!file)
+		return false;
+
+	glProgramBinary(mRendererID, header.mFormat, binary.data(), binary.size());
+
+	int result;
+	glGetProgramiv(mRendererID, GL_LINK_STATUS, &result);
+
+	if (result == GL_FALSE)
+	{
+		Debug::Print("Program binary rejected by the driver, recompiling from source! (file = " + mFilePath + ")");
+		return false;
+	}
+
+	return true;
+}
+
+void Shader::SaveProgramBinary(const uint64_t& hash) const
+{
+	if (!BinaryCacheEnabled)
+		return;
+
+	int formatCount = 0, length = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	glGetProgramiv(mRendererID, GL_PROGRAM_BINARY_LENGTH, &length);
+
+	if (formatCount == 0 || length == 0)
+		return;
+
+	ProgramBinaryHeader header;
+	header.mHash = hash;
+
+	std::vector<char> binary(length);
+	glGetProgramBinary(mRendererID, length, &length, &header.mFormat, binary.data());
+	header.mLength = length;
+
+	std::string path = GetBinaryCachePath(hash);
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		Debug::Print("Unable to write program binary cache! (" + path + ")");
+		return;
+	}
+
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), header.mLength);
 }
 
 ShaderProgramSource Shader::ReadShaderFile(const std::string& filePath)
@@ -160,6 +580,10 @@ ShaderProgramSource Shader::ReadShaderFile(const std::string& filePath)
 				type = ShaderType::FRAG;
 			else if (line.find("GEOM") != std::string::npos)
 				type = ShaderType::GEOM;
+			else if (line.find("TESC") != std::string::npos)
+				type = ShaderType::TESC;
+			else if (line.find("TESE") != std::string::npos)
+				type = ShaderType::TESE;
 		}
 		else
 		{
@@ -174,20 +598,61 @@ ShaderProgramSource Shader::ReadShaderFile(const std::string& filePath)
 				case GEOM:
 					source.Geometry.append(line + "\n");
 					break;
+				case TESC:
+					source.TessControl.append(line + "\n");
+					break;
+				case TESE:
+					source.TessEvaluation.append(line + "\n");
+					break;
 			}
 		}
 	}
 
+	InjectDefines(source.Vertex);
+	InjectDefines(source.Fragment);
+	InjectDefines(source.Geometry);
+	InjectDefines(source.TessControl);
+	InjectDefines(source.TessEvaluation);
+
 	return source;
 }
 
-unsigned int Shader::CompileShader(unsigned int shaderType, const std::string& source)
+void Shader::InjectDefines(std::string& stageSource) const
+{
+	if (stageSource.empty() || mDefines.empty())
+		return;
+
+	std::string defines;
+	for (const auto& define : mDefines)
+	{
+		defines.append("#define " + define + "\n");
+	}
+
+	// #version has to stay the first statement of the stage
+	size_t position = 0;
+	size_t versionPosition = stageSource.find("#version");
+
+	if (versionPosition != std::string::npos)
+	{
+		position = stageSource.find('\n', versionPosition);
+		position = (position == std::string::npos) ? stageSource.size() : position + 1;
+	}
+
+	stageSource.insert(position, defines);
+}
+
+unsigned int Shader::SubmitShader(unsigned int shaderType, const std::string& source)
 {
 	unsigned int id = glCreateShader(shaderType);
 	const char* src = source.c_str();
 	glShaderSource(id, 1, &src, nullptr);
 	glCompileShader(id);
 
+	return id;
+}
+
+bool Shader::CheckCompileStatus(unsigned int id, unsigned int shaderType) const
+{
 	int result, length;
 	glGetShaderiv(id, GL_COMPILE_STATUS, &result);
 
@@ -200,19 +665,86 @@ unsigned int Shader::CompileShader(unsigned int shaderType, const std::string& s
 		std::cout << "Failed to compile shader! (shader = " << shaderType << ")" << std::endl;
 		std::cout << msg << std::endl;
 
-		glDeleteShader(id);
-		return 0;
+		return false;
 	}
 
-	return id;
+	return true;
+}
+
+/// <summary>
+/// Fills the dense uniform table with every active uniform (uniforms inside uniform blocks have no location and are skipped)
+/// </summary>
+/// 
+void Shader::ReflectUniforms()
+{
+	mUniforms.clear();
+	mUniformIndices.clear();
+	mUniformLocationCache.clear();
+
+	int uniformCount = 0, maxNameLength = 0;
+	glGetProgramiv(mRendererID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(mRendererID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<char> nameBuffer(maxNameLength + 1);
+
+	for (int i = 0; i < uniformCount; i++)
+	{
+		int length = 0, size = 0;
+		unsigned int type = 0;
+		glGetActiveUniform(mRendererID, i, nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+
+		UniformInfo info;
+		info.mName = std::string(nameBuffer.data(), length);
+		info.mLocation = glGetUniformLocation(mRendererID, info.mName.c_str());
+		info.mType = type;
+		info.mArraySize = size;
+
+		if (info.mLocation == -1)
+			continue;
+
+		size_t bracket = info.mName.find("[0]");
+		if (bracket != std::string::npos && bracket + 3 == info.mName.size())
+			info.mName.erase(bracket);
+
+		mUniformIndices[info.mName] = mUniforms.size();
+		mUniforms.push_back(info);
+	}
+}
+
+const UniformInfo* Shader::FindUniform(const std::string& name, int& arrayIndex) const
+{
+	arrayIndex = 0;
+
+	auto it = mUniformIndices.find(name);
+
+	if (it != mUniformIndices.end())
+		return &mUniforms[it->second];
+
+	// "name[i]" -> "name" + index
+	size_t bracket = name.find('[');
+	if (bracket == std::string::npos || name.back() != ']')
+		return nullptr;
+
+	it = mUniformIndices.find(name.substr(0, bracket));
+
+	if (it == mUniformIndices.end())
+		return nullptr;
+
+	arrayIndex = atoi(name.c_str() + bracket + 1);
+
+	return &mUniforms[it->second];
 }
 
 int Shader::GetUniformLocation(const std::string& name)
 {
-	if (mUniformLocationCache.find(name) != mUniformLocationCache.end())
-		return mUniformLocationCache[name];
+	auto it = mUniformLocationCache.find(name);
+
+	if (it != mUniformLocationCache.end())
+		return it->second;
 
-	int location = glGetUniformLocation(mRendererID, name.c_str());
+	int arrayIndex = 0;
+	const UniformInfo* info = FindUniform(name, arrayIndex);
+	int location = (info != nullptr && arrayIndex < info->mArraySize) ? info->mLocation + arrayIndex : -1;
 
 	if (location == -1)
 	{
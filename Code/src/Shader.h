@@ -1,15 +1,21 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
+#include <vector>
 #include <unordered_map>
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "TimeControl.h"
+
 struct ShaderProgramSource
 {
 	std::string Vertex{};
 	std::string Fragment{};
 	std::string Geometry{};
+	std::string TessControl{};
+	std::string TessEvaluation{};
 };
 
 enum ShaderType
@@ -17,7 +23,34 @@ enum ShaderType
 	UNDEFINED = -1,
 	VERT = 0,
 	FRAG = 1,
-	GEOM = 2
+	GEOM = 2,
+	TESC = 3,
+	TESE = 4
+};
+
+struct UniformInfo
+{
+	std::string mName{}; // array uniforms are stored without the "[0]" suffix
+	int mLocation = -1;
+	unsigned int mType = 0;
+	int mArraySize = 1;
+};
+
+// Resolved once with Shader::GetUniformHandle, after that setting a uniform is a single GL call
+template<typename T>
+struct UniformHandle
+{
+	int mLocation = -1;
+
+	bool IsValid() const
+	{
+		return mLocation != -1;
+	}
+
+	UniformHandle<T> At(const int& arrayIndex) const
+	{
+		return { (mLocation == -1) ? -1 : mLocation + arrayIndex };
+	}
 };
 
 class Shader
@@ -25,18 +58,44 @@ class Shader
 public:
 
 	Shader(const std::string& filePath);
+	Shader(const std::string& filePath, const std::vector<std::string>& defines, const bool& deferred = false);
 
 	void Bind() const;
 	void Unbind() const;
 
+	bool IsReady();
+	void Finalize();
+
 	void SetUniformMatrix4f(const std::string& name, const glm::mat4& matrix);
 
-	void SetUniform1i(const std::string name, const int& value);
+	void SetUniform1i(const std::string& name, const int& value);
 	void SetUniform4f(const std::string& name, float f0, float f1, float f2, float f3);
 
 	void SetUniform4fv(const std::string& name, const std::vector<float>& vec4f);
 	void SetUniform3fv(const std::string& name, const glm::vec3& vec3f);
 
+	template<typename T>
+	UniformHandle<T> GetUniformHandle(const std::string& name) const;
+
+	void SetUniform(const UniformHandle<int>& handle, const int& value) const;
+	void SetUniform(const UniformHandle<float>& handle, const float& value) const;
+	void SetUniform(const UniformHandle<glm::vec3>& handle, const glm::vec3& value) const;
+	void SetUniform(const UniformHandle<glm::vec4>& handle, const glm::vec4& value) const;
+	void SetUniform(const UniformHandle<glm::mat4>& handle, const glm::mat4& value) const;
+	void SetUniform(const UniformHandle<glm::mat4>& handle, const glm::mat4* values, const unsigned int& count) const;
+
+	void BindUniformBlock(const std::string& blockName, const unsigned int& bindingPoint) const;
+
+	const std::vector<UniformInfo>& GetUniforms() const;
+	const unsigned int& GetRendererID() const;
+
+	const bool& IsLoadedFromCache() const;
+	double GetLoadTime() const; // in seconds
+
+	static void SetBinaryCacheDirectory(const std::string& directory);
+	static void SetBinaryCacheEnabled(const bool& enabled);
+
+	static bool EnableParallelCompilation();
 
 	~Shader();
 
@@ -44,15 +103,41 @@ private:
 	
 	static unsigned int ActiveShader; // careful if implementing multithreading (mutex needed)
 
-	void Init(const std::string& filePath);
+	static bool BinaryCacheEnabled;
+	static std::string BinaryCacheDirectory;
+	static bool ParallelCompilationSupported;
+
+	void Init(const std::string& filePath, const bool& deferred);
+	void SubmitFromSource(const ShaderProgramSource& source);
+
+	static uint64_t HashProgramSource(const ShaderProgramSource& source);
+	std::string GetBinaryCachePath(const uint64_t& hash) const;
+	bool LoadProgramBinary(const uint64_t& hash);
+	void SaveProgramBinary(const uint64_t& hash) const;
 
 	ShaderProgramSource ReadShaderFile(const std::string& filePath);
-	unsigned int CompileShader(unsigned int shaderType, const std::string& source);
+	void InjectDefines(std::string& stageSource) const;
+	unsigned int SubmitShader(unsigned int shaderType, const std::string& source);
+	bool CheckCompileStatus(unsigned int id, unsigned int shaderType) const;
+
+	void ReflectUniforms();
+	const UniformInfo* FindUniform(const std::string& name, int& arrayIndex) const;
 
 	int GetUniformLocation(const std::string& name);
 
 	unsigned int mRendererID = 0;
+	std::vector<UniformInfo> mUniforms{}; // dense table, filled once after linking
+	std::unordered_map<std::string, unsigned int> mUniformIndices{}; // name -> index into mUniforms
 	std::unordered_map<std::string, int> mUniformLocationCache{};
 	std::string mFilePath{};
+	std::vector<std::string> mDefines{}; // "NAME VALUE" pairs inserted after the #version line of every stage
+
+	bool mLoadedFromCache = false;
+	double mLoadTime = 0.0; // in seconds (submit -> ready)
+	TimeControl mLoadTimer;
+
+	bool mPending = false; // submitted to the driver but not finalized yet
+	uint64_t mSourceHash = 0;
+	std::vector<std::pair<unsigned int, unsigned int>> mPendingShaders{}; // (shader id, shader type)
 
 };
\ No newline at end of file
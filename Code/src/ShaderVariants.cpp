@@ -0,0 +1,137 @@
+#include "ShaderVariants.h"
+
+#include "Debug.h"
+
+std::vector<std::string> ShaderVariantKey::ToDefines() const
+{
+	std::vector<std::string> defines;
+
+	defines.push_back("NUM_BONE_INFLUENCES " + STRING(mBoneInfluences));
+	defines.push_back("LIGHTING_MODEL " + STRING((int)mLighting));
+
+	if (mDebugBoneView)
+		defines.push_back("DEBUG_BONE_VIEW");
+
+	return defines;
+}
+
+std::string ShaderVariantKey::ToString() const
+{
+	const char* lighting[] = { "unlit", "lambert", "phong" };
+
+	return "influences = " + STRING(mBoneInfluences) + ", debug bones = " + (mDebugBoneView ? "on" : "off") + ", lighting = " + lighting[mLighting];
+}
+
+ShaderVariants::ShaderVariants(const std::string& filePath)
+	:
+	mFilePath(filePath)
+{
+}
+
+// Blocking; waits for the variant if it was requested but isn't finished yet
+Shader& ShaderVariants::Get(const ShaderVariantKey& key)
+{
+	auto it = mVariants.find(key);
+
+	if (it != mVariants.end())
+	{
+		it->second->Finalize();
+		return *it->second;
+	}
+
+	if (key.mBoneInfluences > MAX_SHADER_BONE_INFLUENCES)
+		Debug::ThrowException("Shader variant requests too many bone influences! (" + key.ToString() + ")");
+
+	Debug::Print("Building shader variant (" + key.ToString() + ")");
+
+	auto result = mVariants.emplace(key, std::make_unique<Shader>(mFilePath, key.ToDefines()));
+
+	return *result.first->second;
+}
+
+bool ShaderVariants::Contains(const ShaderVariantKey& key) const
+{
+	return mVariants.find(key) != mVariants.end();
+}
+
+void ShaderVariants::Request(const ShaderVariantKey& key)
+{
+	if (Contains(key))
+		return;
+
+	if (key.mBoneInfluences > MAX_SHADER_BONE_INFLUENCES)
+		Debug::ThrowException("Shader variant requests too many bone influences! (" + key.ToString() + ")");
+
+	mVariants.emplace(key, std::make_unique<Shader>(mFilePath, key.ToDefines(), true));
+}
+
+/// <summary>
+/// Submits every compile and link at once without waiting for any of them
+/// </summary>
+/// 
+void ShaderVariants::Request(const std::vector<ShaderVariantKey>& keys)
+{
+	for (const auto& key : keys)
+	{
+		Request(key);
+	}
+}
+
+/// <summary>
+/// Never blocks on a requested variant; while it is still compiling the fallback is returned instead
+/// </summary>
+/// <param name="key">Wanted variant (requested if it wasn't already)</param>
+/// <param name="fallbackKey">Variant used until the wanted one is ready (built synchronously if needed)</param>
+/// 
+Shader& ShaderVariants::GetReadyOrFallback(const ShaderVariantKey& key, const ShaderVariantKey& fallbackKey)
+{
+	Request(key);
+
+	Shader& shader = *mVariants[key];
+
+	if (shader.IsReady())
+		return shader;
+
+	return Get(fallbackKey);
+}
+
+/// <summary>
+/// Finalizes every variant the driver has finished with
+/// </summary>
+/// <returns>Number of variants still compiling</returns>
+/// 
+unsigned int ShaderVariants::Poll()
+{
+	unsigned int pending = 0;
+
+	for (auto& variant : mVariants)
+	{
+		if (!variant.second->IsReady())
+			pending++;
+	}
+
+	return pending;
+}
+
+/// <summary>
+/// Rounds the number of influences a mesh actually uses up to one of the compiled variants (0, 4 or 8),
+/// so meshes that use only a few bones don't pay for the second attribute set
+/// </summary>
+/// 
+unsigned int ShaderVariants::MinimalBoneInfluences(const unsigned int& usedInfluences)
+{
+	if (usedInfluences == 0)
+		return 0;
+
+	return (usedInfluences <= 4) ? 4 : MAX_SHADER_BONE_INFLUENCES;
+}
+
+const std::string& ShaderVariants::GetFilePath() const
+{
+	return mFilePath;
+}
+
+unsigned int ShaderVariants::GetVariantCount() const
+{
+	return mVariants.size();
+}
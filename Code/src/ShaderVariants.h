@@ -0,0 +1,72 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Shader.h"
+
+#define MAX_SHADER_BONE_INFLUENCES 8 // influences the vertex layout can carry (boneIDs_1/2, boneWeights_1/2)
+
+enum LightingModel
+{
+	LIGHTING_UNLIT = 0,
+	LIGHTING_LAMBERT = 1,
+	LIGHTING_PHONG = 2
+};
+
+// Compile-time features of a shader permutation; every field maps to a #define in the GLSL source
+struct ShaderVariantKey
+{
+	unsigned int mBoneInfluences = 8; // NUM_BONE_INFLUENCES; 0 = no skinning
+	bool mDebugBoneView = false; // DEBUG_BONE_VIEW
+	LightingModel mLighting = LIGHTING_PHONG; // LIGHTING_MODEL
+
+	std::vector<std::string> ToDefines() const;
+	std::string ToString() const;
+
+	bool operator<(const ShaderVariantKey& rhs) const
+	{
+		if (mBoneInfluences != rhs.mBoneInfluences)
+			return mBoneInfluences < rhs.mBoneInfluences;
+
+		if (mDebugBoneView != rhs.mDebugBoneView)
+			return mDebugBoneView < rhs.mDebugBoneView;
+
+		return mLighting < rhs.mLighting;
+	}
+
+	bool operator==(const ShaderVariantKey& rhs) const
+	{
+		return mBoneInfluences == rhs.mBoneInfluences && mDebugBoneView == rhs.mDebugBoneView && mLighting == rhs.mLighting;
+	}
+};
+
+// All permutations of one shader file; each variant is built the first time it is requested and then kept.
+// Request() only submits the compile, so many variants can be compiled in parallel while rendering continues.
+class ShaderVariants
+{
+public:
+
+	ShaderVariants(const std::string& filePath);
+
+	Shader& Get(const ShaderVariantKey& key);
+	bool Contains(const ShaderVariantKey& key) const;
+
+	void Request(const ShaderVariantKey& key);
+	void Request(const std::vector<ShaderVariantKey>& keys);
+	Shader& GetReadyOrFallback(const ShaderVariantKey& key, const ShaderVariantKey& fallbackKey);
+	unsigned int Poll();
+
+	static unsigned int MinimalBoneInfluences(const unsigned int& usedInfluences);
+
+	const std::string& GetFilePath() const;
+	unsigned int GetVariantCount() const;
+
+private:
+
+	std::string mFilePath;
+	std::map<ShaderVariantKey, std::unique_ptr<Shader>> mVariants;
+
+};
@@ -1,100 +1,1216 @@
 #include "Spline.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SPLINE_USE_SSE
+#include <xmmintrin.h>
+#endif
+
 #include "Debug.h"
+#include "Shader.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+CubicBSpline::CubicBSpline(std::vector<glm::vec3>& controlPoints, const unsigned int& sampleRate, const float& tolerance, const SplineEvaluation& evaluation)
+	:
+	mControlPoints(controlPoints),
+	mNumOfSegments(controlPoints.size() - 3),
+	mSampleRate(sampleRate),
+	mTolerance(tolerance),
+	mEvaluation(evaluation)
+{
+	FillSplinePoints(controlPoints, sampleRate, tolerance);
+}
+
+CubicBSpline::~CubicBSpline()
+{
+}
+
+const std::vector<Vertex>& CubicBSpline::GetSplinePoints() const
+{
+	if (mSplinePoints.size() != mPositions.size())
+	{
+		mSplinePoints.resize(mPositions.size());
+
+		for (size_t i = 0; i < mPositions.size(); i++)
+		{
+			mSplinePoints[i] = { mPositions[i], {1.0f, 1.0f, 1.0f} };
+		}
+	}
+
+	return mSplinePoints;
+}
+
+const std::vector<glm::mat4>& CubicBSpline::GetRotationMatrices() const
+{
+	if (mRotationMatrices.size() != mOrientations.size())
+	{
+		mRotationMatrices.resize(mOrientations.size());
+
+		for (size_t i = 0; i < mOrientations.size(); i++)
+		{
+			mRotationMatrices[i] = glm::mat4_cast(mOrientations[i]);
+		}
+	}
+
+	return mRotationMatrices;
+}
+
+const std::vector<Vertex>& CubicBSpline::GetTangents() const
+{
+	if (mTangents.size() != mOrientations.size())
+	{
+		mTangents.resize(mOrientations.size());
+
+		for (size_t i = 0; i < mOrientations.size(); i++)
+		{
+			mTangents[i] = { glm::mat3_cast(mOrientations[i])[2], {1.0f, -1.0f, -1.0f} };
+		}
+	}
+
+	return mTangents;
+}
+
+const std::vector<glm::vec3>& CubicBSpline::GetPositions() const
+{
+	return mPositions;
+}
+
+const std::vector<glm::quat>& CubicBSpline::GetOrientations() const
+{
+	return mOrientations;
+}
+
+SplineFrame CubicBSpline::GetFrame(const unsigned int& index) const
+{
+	glm::mat3 rotation = glm::mat3_cast(mOrientations[index]);
+
+	SplineFrame frame;
+	frame.mPosition = mPositions[index];
+	frame.mBinormal = rotation[0];
+	frame.mNormal = rotation[1];
+	frame.mTangent = rotation[2];
+
+	return frame;
+}
+
+glm::mat4 CubicBSpline::GetRotationMatrix(const unsigned int& index) const
+{
+	return glm::mat4_cast(mOrientations[index]);
+}
+
+void CubicBSpline::FillSplinePoints(std::vector<glm::vec3>& controlPoints, const unsigned int& sampleRate, const float& tolerance)
+{
+	if (controlPoints.size() < 4)
+		Debug::ThrowException("Must have at least 4 control points! (current size = " + STRING(controlPoints.size()) + ")");
+
+	mControlPoints = controlPoints;
+	mNumOfSegments = controlPoints.size() - 3;
+	mSampleRate = sampleRate;
+	mTolerance = tolerance;
+
+	mPositions.clear();
+	mOrientations.clear();
+
+	// the arrays built by the accessors belong to the old samples, shrink_to_fit so they stop taking memory
+	mSplinePoints.clear();
+	mSplinePoints.shrink_to_fit();
+	mTangents.clear();
+	mTangents.shrink_to_fit();
+	mRotationMatrices.clear();
+	mRotationMatrices.shrink_to_fit();
+
+	BuildSegments();
+	BuildSegmentTree();
+	BuildArcLengthTable();
+
+	if (mEvaluation == SPLINE_EVALUATION_GPU)
+	{
+		mSegmentOffsets.clear();
+		mSavedSamples = 0;
+
+		UploadControlPoints();
+		return;
+	}
+
+	mPositions.reserve(sampleRate);
+	mOrientations.reserve(sampleRate);
+	mCurrentGuides.resize(6);
+
+	if (tolerance > 0.0f)
+		SampleAdaptive(sampleRate, tolerance);
+	else
+		SampleUniform(sampleRate);
+
+	mActive = 1;
+
+	Upload();
+}
+
+const SplineEvaluation& CubicBSpline::GetEvaluation() const
+{
+	return mEvaluation;
+}
+
+unsigned int CubicBSpline::GetSegmentCount() const
+{
+	return mNumOfSegments;
+}
+
+unsigned int CubicBSpline::GetBufferSize() const
+{
+	return mVBuffer.GetBufferSize() + mIBuffer.GetBufferSize();
+}
+
+unsigned int CubicBSpline::GetSampleCount() const
+{
+	return mPositions.size();
+}
+
+const unsigned int& CubicBSpline::GetSavedSamples() const
+{
+	return mSavedSamples;
+}
+
+const std::vector<glm::vec3>& CubicBSpline::GetControlPoints() const
+{
+	return mControlPoints;
+}
+
+void CubicBSpline::SetControlPoint(const unsigned int& index, const glm::vec3& point)
+{
+	if (index >= mControlPoints.size())
+		Debug::ThrowException("CubicBSpline => control point index out of range! (index = " + STRING(index) + ", size = " + STRING(mControlPoints.size()) + ")");
+
+	mControlPoints[index] = point;
+
+	// control point i is used by segments i - 3..i
+	unsigned int first = (index >= 3) ? index - 3 : 0;
+	unsigned int count = std::min<unsigned int>(index, mNumOfSegments - 1) - first + 1;
+
+	UpdateSegments(first, count, count);
+
+	if (mEvaluation == SPLINE_EVALUATION_GPU)
+		mVBuffer.InsertDataWithOffset(&point, sizeof(glm::vec3), index * sizeof(glm::vec3));
+}
+
+void CubicBSpline::InsertControlPoint(const unsigned int& index, const glm::vec3& point)
+{
+	if (index > mControlPoints.size())
+		Debug::ThrowException("CubicBSpline => control point index out of range! (index = " + STRING(index) + ", size = " + STRING(mControlPoints.size()) + ")");
+
+	// old segments index - 3..index - 1 are split by the new point, it becomes part of segments index - 3..index
+	int first = std::max((int)index - 3, 0);
+	int oldLast = std::min((int)index - 1, mNumOfSegments - 1);
+	int newLast = std::min((int)index, mNumOfSegments);
+
+	mControlPoints.insert(mControlPoints.begin() + index, point);
+
+	UpdateSegments(first, oldLast - first + 1, newLast - first + 1);
+
+	if (mEvaluation == SPLINE_EVALUATION_GPU)
+		UploadControlPoints();
+}
+
+void CubicBSpline::RemoveControlPoint(const unsigned int& index)
+{
+	if (index >= mControlPoints.size())
+		Debug::ThrowException("CubicBSpline => control point index out of range! (index = " + STRING(index) + ", size = " + STRING(mControlPoints.size()) + ")");
+
+	if (mControlPoints.size() <= 4)
+		Debug::ThrowException("Must have at least 4 control points! (current size = " + STRING(mControlPoints.size()) + ")");
+
+	// old segments index - 3..index used the point, its neighbours join into segments index - 3..index - 1
+	int first = std::max((int)index - 3, 0);
+	int oldLast = std::min((int)index, mNumOfSegments - 1);
+	int newLast = std::min((int)index - 1, mNumOfSegments - 2);
+
+	mControlPoints.erase(mControlPoints.begin() + index);
+
+	UpdateSegments(first, oldLast - first + 1, newLast - first + 1);
+
+	if (mEvaluation == SPLINE_EVALUATION_GPU)
+		UploadControlPoints();
+}
+
+/// <summary>
+/// Replaces oldCount segments starting at first with newCount segments built from the current control points;
+/// the arc length table and the samples of every other segment are kept
+/// </summary>
+/// 
+void CubicBSpline::UpdateSegments(const unsigned int& first, const unsigned int& oldCount, const unsigned int& newCount)
+{
+	PROFILE_SCOPE("CubicBSpline::UpdateSegments");
+
+	unsigned int oldNumOfSegments = mNumOfSegments;
+	mNumOfSegments = mControlPoints.size() - 3;
+
+	mSegments.erase(mSegments.begin() + first, mSegments.begin() + first + oldCount);
+	mSegments.insert(mSegments.begin() + first, newCount, SplineSegment());
+
+	for (unsigned int i = first; i < first + newCount; i++)
+	{
+		BuildSegment(i);
+	}
+
+	// indices of the following segments shift when the count changes, so their leaves would point at the wrong segments
+	if (oldCount == newCount)
+	{
+		for (unsigned int i = first; i < first + newCount; i++)
+		{
+			mSegmentTree.Refit(mSegmentLeaves[i], GetSegmentBounds(i));
+		}
+	}
+	else
+		BuildSegmentTree();
+
+	UpdateArcLengthTable(first, oldCount, newCount);
+
+	if (mEvaluation == SPLINE_EVALUATION_CPU)
+		UpdateSamples(first, oldCount, newCount, oldNumOfSegments);
+}
+
+/// <summary>
+/// Re-evaluates the samples of the replaced segments and uploads only the vertex range that changed
+/// (everything from the edit to the end if the number of samples changed)
+/// </summary>
+/// 
+void CubicBSpline::UpdateSamples(const unsigned int& first, const unsigned int& oldCount, const unsigned int& newCount, const unsigned int& oldNumOfSegments)
+{
+	bool adaptive = mTolerance > 0.0f;
+
+	unsigned int begin = mSegmentOffsets[first];
+	unsigned int end = mSegmentOffsets[first + oldCount];
+
+	// adaptive sampling ends with the end point of the last segment, it has to be replaced if the edit reaches the end
+	if (adaptive && first + oldCount == oldNumOfSegments)
+		begin = std::min(begin, end - 1);
+
+	std::vector<glm::vec3> tailPositions(mPositions.begin() + end, mPositions.end());
+	std::vector<glm::quat> tailOrientations(mOrientations.begin() + end, mOrientations.end());
+
+	mPositions.resize(begin);
+	mOrientations.resize(begin);
+
+	std::vector<unsigned int> offsets(newCount);
+
+	if (adaptive)
+	{
+		unsigned int maxDepth = GetAdaptiveMaxDepth();
+
+		for (unsigned int i = 0; i < newCount; i++)
+		{
+			unsigned int segment = first + i;
+
+			offsets[i] = GetSampleCount();
+			SubdivideSegment(segment, 0.0f, EvaluatePosition(segment, 0.0f), 1.0f, EvaluatePosition(segment, 1.0f), 0, maxDepth, mTolerance);
+		}
+
+		if (first + newCount == (unsigned int)mNumOfSegments)
+			AppendSample(mNumOfSegments - 1, 1.0f);
+	}
+	else
+	{
+		for (unsigned int i = 0; i < newCount; i++)
+		{
+			offsets[i] = begin + i * mSamplesPerSegment;
+		}
+
+		mPositions.resize(begin + newCount * mSamplesPerSegment);
+		mOrientations.resize(begin + newCount * mSamplesPerSegment);
+	}
+
+	unsigned int newEnd = GetSampleCount();
+	int shift = (int)newEnd - (int)end;
+
+	mPositions.insert(mPositions.end(), tailPositions.begin(), tailPositions.end());
+	mOrientations.insert(mOrientations.end(), tailOrientations.begin(), tailOrientations.end());
+
+	mSegmentOffsets.erase(mSegmentOffsets.begin() + first, mSegmentOffsets.begin() + first + oldCount);
+	mSegmentOffsets.insert(mSegmentOffsets.begin() + first, offsets.begin(), offsets.end());
+
+	for (unsigned int i = first + newCount; i < mSegmentOffsets.size(); i++)
+	{
+		mSegmentOffsets[i] += shift;
+	}
+
+	if (adaptive)
+	{
+		unsigned int uniformSamples = GetUniformSamplesPerSegment(mSampleRate) * mNumOfSegments;
+		mSavedSamples = uniformSamples > GetSampleCount() ? uniformSamples - GetSampleCount() : 0;
+	}
+	else
+	{
+		EvaluateUniformSegments(first, newCount);
+	}
+
+	// arrays built by the accessors are stale now
+	mSplinePoints.clear();
+	mTangents.clear();
+	mRotationMatrices.clear();
+
+	unsigned int sampleCount = GetSampleCount();
+
+	if ((unsigned int)mActive >= sampleCount)
+		mActive = 0;
+
+	// the index buffer holds 0..n - 1, it only has to grow
+	unsigned int indexCount = mIBuffer.GetIndicesCount();
+
+	if (sampleCount > indexCount)
+	{
+		std::vector<unsigned int> indices(sampleCount - indexCount);
+
+		for (unsigned int i = 0; i < indices.size(); i++)
+		{
+			indices[i] = indexCount + i;
+		}
+
+		mIBuffer.InsertDataWithOffset(indices.data(), indices.size(), indexCount * sizeof(unsigned int));
+	}
+
+	UploadSamples(begin, ((shift == 0) ? newEnd : sampleCount) - begin);
+
+	// guide vertices are stored after the last sample
+	UpdateGuides(mActive);
+}
+
+/// <summary>
+/// Converts every segment to power basis once, so evaluating a sample is a few multiply-adds instead of the basis matrix products
+/// </summary>
+/// 
+void CubicBSpline::BuildSegments()
+{
+	// uniform cubic B-spline basis (times 6), rows are the t^3, t^2, t and 1 coefficients of the 4 control points
+	mSegments.resize(mNumOfSegments);
+
+	for (int i = 0; i < mNumOfSegments; i++)
+	{
+		BuildSegment(i);
+	}
+}
+
+void CubicBSpline::BuildSegment(const unsigned int& segment)
+{
+	mSegments[segment] = ComputeSegment(&mControlPoints[segment]);
+}
+
+void CubicBSpline::BuildSegmentTree()
+{
+	std::vector<AABB> bounds(mNumOfSegments);
+	std::vector<void*> segments(mNumOfSegments);
+
+	for (int i = 0; i < mNumOfSegments; i++)
+	{
+		bounds[i] = GetSegmentBounds(i);
+		segments[i] = (void*)(uintptr_t)i;
+	}
+
+	// consecutive segments are neighbours in space, inserting them one by one would build a list instead of a tree
+	mSegmentTree.Build(bounds, segments, mSegmentLeaves);
+}
+
+// a segment lies inside the convex hull of its 4 control points
+AABB CubicBSpline::GetSegmentBounds(const unsigned int& segment) const
+{
+	AABB bounds;
+
+	for (unsigned int i = segment; i < segment + 4; i++)
+	{
+		bounds.Expand(mControlPoints[i]);
+	}
+
+	return bounds;
+}
+
+SplineSegment CubicBSpline::ComputeSegment(const glm::vec3* controlPoints)
+{
+	const glm::vec3& p0 = controlPoints[0];
+	const glm::vec3& p1 = controlPoints[1];
+	const glm::vec3& p2 = controlPoints[2];
+	const glm::vec3& p3 = controlPoints[3];
+
+	SplineSegment s;
+	s.mA = (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * (1.0f / 6.0f);
+	s.mB = (3.0f * p0 - 6.0f * p1 + 3.0f * p2) * (1.0f / 6.0f);
+	s.mC = (-3.0f * p0 + 3.0f * p2) * (1.0f / 6.0f);
+	s.mD = (p0 + 4.0f * p1 + p2) * (1.0f / 6.0f);
+
+	return s;
+}
+
+/// <summary>
+/// Position, first and second derivative of a segment (control points segment..segment + 3) at parameter t in [0, 1]
+/// </summary>
+/// 
+void CubicBSpline::EvaluateSegment(const unsigned int& segment, const float& t, glm::vec3& position, glm::vec3& firstDerivative, glm::vec3& secondDerivative) const
+{
+	EvaluateSegment(mSegments[segment], t, position, firstDerivative, secondDerivative);
+}
+
+void CubicBSpline::EvaluateSegment(const SplineSegment& s, const float& t, glm::vec3& position, glm::vec3& firstDerivative, glm::vec3& secondDerivative)
+{
+	position = ((s.mA * t + s.mB) * t + s.mC) * t + s.mD;
+	firstDerivative = (3.0f * s.mA * t + 2.0f * s.mB) * t + s.mC;
+	secondDerivative = 6.0f * s.mA * t + 2.0f * s.mB;
+}
+
+glm::vec3 CubicBSpline::EvaluatePosition(const unsigned int& segment, const float& t) const
+{
+	glm::vec3 position, firstDerivative, secondDerivative;
+	EvaluateSegment(segment, t, position, firstDerivative, secondDerivative);
+
+	return position;
+}
+
+// adds the point and the orientation of its Frenet frame to the sample arrays
+void CubicBSpline::AppendSample(const unsigned int& segment, const float& t)
+{
+	glm::vec3 firstDerivative, secondDerivative;
+
+	SplineFrame frame;
+	EvaluateSegment(segment, t, frame.mPosition, firstDerivative, secondDerivative);
+	ComputeFrame(firstDerivative, secondDerivative, frame);
+
+	unsigned int index = mPositions.size();
+
+	mPositions.resize(index + 1);
+	mOrientations.resize(index + 1);
+
+	StoreFrame(frame, mPositions[index], mOrientations[index]);
+}
+
+void CubicBSpline::StoreFrame(const SplineFrame& frame, glm::vec3& position, glm::quat& orientation)
+{
+	position = frame.mPosition;
+
+	// the frame is orthonormal and right handed (binormal = normal x tangent), so it is a pure rotation
+	orientation = glm::quat_cast(frame.GetRotation());
+}
+
+// evaluates samples first..first + count - 1 of a segment (t = sample * delta) into the arrays starting at outputIndex
+void CubicBSpline::EvaluateSamples(const unsigned int& segment, const unsigned int& first, const unsigned int& count, const float& delta, const unsigned int& outputIndex)
+{
+	EvaluateSegmentSamples(mSegments[segment], first, count, delta, mPositions.data() + outputIndex, mOrientations.data() + outputIndex);
+}
+
+#ifdef SPLINE_USE_SSE
+
+/// <summary>
+/// Position and Frenet frame of 4 curve points at once; every lane has its own power basis coefficients and parameter
+/// </summary>
+/// <param name="coefficients">mA, mB, mC and mD of SplineSegment, split into x, y and z</param>
+/// <param name="values">Output rows: position, tangent, normal and binormal (x, y, z each), one column per lane</param>
+/// 
+static void EvaluateFramesSSE(const __m128 (&coefficients)[4][3], const __m128& t, float (&values)[12][4])
+{
+	const __m128 two = _mm_set1_ps(2.0f), three = _mm_set1_ps(3.0f), six = _mm_set1_ps(6.0f), one = _mm_set1_ps(1.0f);
+
+	auto normalize = [&one](__m128& x, __m128& y, __m128& z)
+	{
+		__m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))));
+		x = _mm_mul_ps(x, inverseLength);
+		y = _mm_mul_ps(y, inverseLength);
+		z = _mm_mul_ps(z, inverseLength);
+	};
+
+	__m128 p[3], d[3], s[3];
+
+	for (unsigned int axis = 0; axis < 3; axis++)
+	{
+		const __m128& a = coefficients[0][axis];
+		const __m128& b = coefficients[1][axis];
+		const __m128& c = coefficients[2][axis];
+
+		// Horner for the position, first and second derivative
+		p[axis] = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(a, t), b), t), c), t), coefficients[3][axis]);
+		d[axis] = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(three, a), t), _mm_mul_ps(two, b)), t), c);
+		s[axis] = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(six, a), t), _mm_mul_ps(two, b));
+	}
+
+	// same frame as ComputeFrame: tangent, normal = tangent x second derivative, binormal = normal x tangent
+	__m128 tx = d[0], ty = d[1], tz = d[2];
+	normalize(tx, ty, tz);
+
+	__m128 nx = _mm_sub_ps(_mm_mul_ps(ty, s[2]), _mm_mul_ps(tz, s[1]));
+	__m128 ny = _mm_sub_ps(_mm_mul_ps(tz, s[0]), _mm_mul_ps(tx, s[2]));
+	__m128 nz = _mm_sub_ps(_mm_mul_ps(tx, s[1]), _mm_mul_ps(ty, s[0]));
+	normalize(nx, ny, nz);
+
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(ny, tz), _mm_mul_ps(nz, ty));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(nz, tx), _mm_mul_ps(nx, tz));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(nx, ty), _mm_mul_ps(ny, tx));
+	normalize(qx, qy, qz);
+
+	_mm_store_ps(values[0], p[0]); _mm_store_ps(values[1], p[1]); _mm_store_ps(values[2], p[2]);
+	_mm_store_ps(values[3], tx); _mm_store_ps(values[4], ty); _mm_store_ps(values[5], tz);
+	_mm_store_ps(values[6], nx); _mm_store_ps(values[7], ny); _mm_store_ps(values[8], nz);
+	_mm_store_ps(values[9], qx); _mm_store_ps(values[10], qy); _mm_store_ps(values[11], qz);
+}
+
+#endif
+
+/// <summary>
+/// Evaluates samples first..first + count - 1 of a segment (t = sample * delta) into positions[0..count - 1] and orientations[0..count - 1].
+/// With SSE, 4 parameters are evaluated at once (positions, derivatives and frames in SoA registers).
+/// </summary>
+/// 
+void CubicBSpline::EvaluateSegmentSamples(const SplineSegment& s, const unsigned int& first, const unsigned int& count, const float& delta,
+	glm::vec3* positions, glm::quat* orientations)
+{
+	unsigned int i = 0;
+
+#ifdef SPLINE_USE_SSE
+
+	// the same coefficients in every lane, only the parameter differs
+	__m128 coefficients[4][3];
+	const glm::vec3* rows[4] = { &s.mA, &s.mB, &s.mC, &s.mD };
+
+	for (unsigned int row = 0; row < 4; row++)
+	{
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			coefficients[row][axis] = _mm_set1_ps((*rows[row])[axis]);
+		}
+	}
+
+	const __m128 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	const __m128 step = _mm_set1_ps(delta);
+
+	alignas(16) float values[12][4];
+	SplineFrame frame;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 t = _mm_mul_ps(_mm_add_ps(_mm_set1_ps((float)(first + i)), lane), step);
+
+		EvaluateFramesSSE(coefficients, t, values);
+
+		for (unsigned int j = 0; j < 4; j++)
+		{
+			frame.mPosition = { values[0][j], values[1][j], values[2][j] };
+			frame.mTangent = { values[3][j], values[4][j], values[5][j] };
+			frame.mNormal = { values[6][j], values[7][j], values[8][j] };
+			frame.mBinormal = { values[9][j], values[10][j], values[11][j] };
+
+			StoreFrame(frame, positions[i + j], orientations[i + j]);
+		}
+	}
+#endif
+
+	glm::vec3 firstDerivative, secondDerivative;
+
+	for (; i < count; i++)
+	{
+		SplineFrame frame;
+		EvaluateSegment(s, (first + i) * delta, frame.mPosition, firstDerivative, secondDerivative);
+		ComputeFrame(firstDerivative, secondDerivative, frame);
+
+		StoreFrame(frame, positions[i], orientations[i]);
+	}
+}
+
+// Frenet frame from the first two derivatives
+void CubicBSpline::ComputeFrame(const glm::vec3& firstDerivative, const glm::vec3& secondDerivative, SplineFrame& frame)
+{
+	frame.mTangent = glm::normalize(firstDerivative);
+	frame.mNormal = glm::normalize(glm::cross(frame.mTangent, secondDerivative));
+	frame.mBinormal = glm::normalize(glm::cross(frame.mNormal, frame.mTangent));
+}
+
+/// <summary>
+/// Same number of samples for every segment; the samples are evaluated in parallel chunks written straight into the presized arrays
+/// </summary>
+/// 
+void CubicBSpline::SampleUniform(const unsigned int& sampleRate)
+{
+	PROFILE_SCOPE("CubicBSpline::SampleUniform");
+
+	mSamplesPerSegment = GetUniformSamplesPerSegment(sampleRate);
+
+	mSegmentOffsets.resize(mNumOfSegments + 1);
+	for (int i = 0; i <= mNumOfSegments; i++)
+	{
+		mSegmentOffsets[i] = i * mSamplesPerSegment;
+	}
+
+	unsigned int sampleCount = mSegmentOffsets.back();
+
+	mPositions.resize(sampleCount);
+	mOrientations.resize(sampleCount);
+
+	EvaluateUniformSegments(0, mNumOfSegments);
+
+	mSavedSamples = 0;
+}
+
+unsigned int CubicBSpline::GetUniformSamplesPerSegment(const unsigned int& sampleRate) const
+{
+	int numPointsPerSegment = sampleRate / mNumOfSegments;
+
+	// t = 1 is left out, it is the first sample of the next segment
+	return std::max(numPointsPerSegment - 1, 1);
+}
+
+// evaluates segments first..first + count - 1 in parallel chunks, straight into the already sized arrays at mSegmentOffsets
+void CubicBSpline::EvaluateUniformSegments(const unsigned int& first, const unsigned int& count)
+{
+	float delta = 1.0f / mSamplesPerSegment;
+	unsigned int firstSample = mSegmentOffsets[first];
+
+	ThreadPool::GetShared().ParallelFor(mSegmentOffsets[first + count] - firstSample, [&](unsigned int begin, unsigned int end)
+	{
+		begin += firstSample;
+		end += firstSample;
+
+		for (unsigned int segment = begin / mSamplesPerSegment; begin < end; segment++)
+		{
+			unsigned int segmentEnd = std::min(end, mSegmentOffsets[segment + 1]);
+
+			EvaluateSamples(segment, begin - mSegmentOffsets[segment], segmentEnd - begin, delta, begin);
+
+			begin = segmentEnd;
+		}
+	}, SPLINE_PARALLEL_MIN_SAMPLES);
+}
+
+/// <summary>
+/// Splits every segment recursively until the midpoint of each piece is within tolerance of its chord.
+/// The chord error of a piece grows with its curvature, so flat segments end up with a couple of samples and tight bends with many.
+/// </summary>
+/// <param name="sampleRate">Upper bound; a segment is never sampled denser than uniform sampling with this rate would</param>
+/// <param name="tolerance">Maximum distance between the curve and the drawn line strip, in model units</param>
+/// 
+void CubicBSpline::SampleAdaptive(const unsigned int& sampleRate, const float& tolerance)
+{
+	unsigned int maxDepth = GetAdaptiveMaxDepth();
+
+	mSegmentOffsets.resize(mNumOfSegments + 1);
+
+	for (int i = 0; i < mNumOfSegments; i++)
+	{
+		mSegmentOffsets[i] = GetSampleCount();
+		SubdivideSegment(i, 0.0f, EvaluatePosition(i, 0.0f), 1.0f, EvaluatePosition(i, 1.0f), 0, maxDepth, tolerance);
+	}
 
-CubicBSpline::CubicBSpline(std::vector<glm::vec3>& controlPoints, const unsigned int& sampleRate)
-	:
-	mControlPoints(controlPoints),
-	mSampleRate(sampleRate),
-	mNumOfSegments(controlPoints.size() - 3)
+	// segments only emit their start points, the end of the curve has to be added separately
+	AppendSample(mNumOfSegments - 1, 1.0f);
+	mSegmentOffsets[mNumOfSegments] = GetSampleCount();
+
+	unsigned int uniformSamples = GetUniformSamplesPerSegment(sampleRate) * mNumOfSegments;
+	mSavedSamples = uniformSamples > GetSampleCount() ? uniformSamples - GetSampleCount() : 0;
+}
+
+// deepest subdivision that still doesn't produce more samples per segment than uniform sampling with mSampleRate
+unsigned int CubicBSpline::GetAdaptiveMaxDepth() const
 {
-	FillSplinePoints(controlPoints, sampleRate);
+	unsigned int numPointsPerSegment = std::max(1u, mSampleRate / mNumOfSegments);
+
+	unsigned int maxDepth = 0;
+	while ((2u << maxDepth) <= numPointsPerSegment)
+		maxDepth++;
+
+	return maxDepth;
 }
 
-CubicBSpline::~CubicBSpline()
+void CubicBSpline::SubdivideSegment(const unsigned int& segment, const float& t0, const glm::vec3& p0, const float& t1, const glm::vec3& p1,
+	const unsigned int& depth, const unsigned int& maxDepth, const float& tolerance)
 {
+	float tm = (t0 + t1) * 0.5f;
+	glm::vec3 pm = EvaluatePosition(segment, tm);
+
+	// distance of the midpoint from the chord p0-p1
+	glm::vec3 chord = p1 - p0;
+	float chordLength2 = glm::dot(chord, chord);
+	float projection = chordLength2 > 0.0f ? glm::clamp(glm::dot(pm - p0, chord) / chordLength2, 0.0f, 1.0f) : 0.0f;
+	float error = glm::length(pm - (p0 + chord * projection));
+
+	if (depth < maxDepth && (depth < SPLINE_ADAPTIVE_MIN_DEPTH || error > tolerance))
+	{
+		SubdivideSegment(segment, t0, p0, tm, pm, depth + 1, maxDepth, tolerance);
+		SubdivideSegment(segment, tm, pm, t1, p1, depth + 1, maxDepth, tolerance);
+	}
+	else
+	{
+		AppendSample(segment, t0);
+	}
 }
 
-const std::vector<Vertex>& CubicBSpline::GetSplinePoints() const
+// Gauss-Legendre quadrature (5 points) of the curve speed over [t0, t1] of one segment
+float CubicBSpline::IntegrateSpeed(const unsigned int& segment, const float& t0, const float& t1) const
 {
-	return mSplinePoints;
+	static const float nodes[5] = { 0.0f, -0.5384693101f, 0.5384693101f, -0.9061798459f, 0.9061798459f };
+	static const float weights[5] = { 0.5688888889f, 0.4786286705f, 0.4786286705f, 0.2369268851f, 0.2369268851f };
+
+	float halfSpan = (t1 - t0) * 0.5f;
+	float middle = (t0 + t1) * 0.5f;
+
+	glm::vec3 position, firstDerivative, secondDerivative;
+	float length = 0.0f;
+
+	for (unsigned int i = 0; i < 5; i++)
+	{
+		EvaluateSegment(segment, middle + halfSpan * nodes[i], position, firstDerivative, secondDerivative);
+		length += weights[i] * glm::length(firstDerivative);
+	}
+
+	return length * halfSpan;
 }
 
-const std::vector<glm::mat4>& CubicBSpline::GetRotationMatrices() const
+void CubicBSpline::BuildArcLengthTable()
 {
-	return mRotationMatrices;
+	const float step = 1.0f / SPLINE_ARC_LENGTH_SUBDIVISIONS;
+
+	mArcLengths.resize(mNumOfSegments * SPLINE_ARC_LENGTH_SUBDIVISIONS + 1);
+	mArcLengths[0] = 0.0f;
+
+	unsigned int entry = 0;
+	for (int i = 0; i < mNumOfSegments; i++)
+	{
+		for (unsigned int j = 0; j < SPLINE_ARC_LENGTH_SUBDIVISIONS; j++, entry++)
+		{
+			mArcLengths[entry + 1] = mArcLengths[entry] + IntegrateSpeed(i, j * step, (j + 1) * step);
+		}
+	}
 }
 
-void CubicBSpline::FillSplinePoints(std::vector<glm::vec3>& controlPoints, const unsigned int& sampleRate)
+/// <summary>
+/// Replaces the entries of oldCount segments starting at first with newCount freshly integrated ones;
+/// the entries after them only move by the difference in length
+/// </summary>
+/// 
+void CubicBSpline::UpdateArcLengthTable(const unsigned int& first, const unsigned int& oldCount, const unsigned int& newCount)
 {
-	mSplinePoints.reserve(sampleRate + 6);
-	mTangents.reserve(sampleRate);
-	mNormals.reserve(sampleRate);
-	mBinormals.reserve(sampleRate);
-	mRotationMatrices.reserve(sampleRate);
-	mCurrentGuides.reserve(6);
+	const float step = 1.0f / SPLINE_ARC_LENGTH_SUBDIVISIONS;
 
-	if (controlPoints.size() < 4)
-		Debug::ThrowException("Must have at least 4 control points! (current size = " + STRING(controlPoints.size()) + ")");
+	unsigned int entry = first * SPLINE_ARC_LENGTH_SUBDIVISIONS;
+	float oldEndLength = mArcLengths[(first + oldCount) * SPLINE_ARC_LENGTH_SUBDIVISIONS];
 
-	std::vector<unsigned int> indices;
-	indices.reserve(sampleRate);
+	mArcLengths.erase(mArcLengths.begin() + entry + 1, mArcLengths.begin() + (first + oldCount) * SPLINE_ARC_LENGTH_SUBDIVISIONS + 1);
+	mArcLengths.insert(mArcLengths.begin() + entry + 1, newCount * SPLINE_ARC_LENGTH_SUBDIVISIONS, 0.0f);
 
-	int numPointsPerSegment = sampleRate / mNumOfSegments;
-	float delta = 1.0f / (numPointsPerSegment - 1);
+	for (unsigned int i = first; i < first + newCount; i++)
+	{
+		for (unsigned int j = 0; j < SPLINE_ARC_LENGTH_SUBDIVISIONS; j++, entry++)
+		{
+			mArcLengths[entry + 1] = mArcLengths[entry] + IntegrateSpeed(i, j * step, (j + 1) * step);
+		}
+	}
+
+	float shift = mArcLengths[entry] - oldEndLength;
+
+	for (entry++; entry < mArcLengths.size(); entry++)
+	{
+		mArcLengths[entry] += shift;
+	}
+}
+
+float CubicBSpline::GetLength() const
+{
+	return mArcLengths.back();
+}
+
+/// <summary>
+/// Maps a distance along the curve to a segment and parameter (binary search in the arc length table)
+/// </summary>
+/// 
+SplineLocation CubicBSpline::LocateDistance(const float& distance) const
+{
+	float clamped = glm::clamp(distance, 0.0f, GetLength());
+
+	// first entry with a larger distance, the one before it starts the interval containing the distance
+	auto upper = std::upper_bound(mArcLengths.begin(), mArcLengths.end(), clamped);
+	unsigned int entry = (unsigned int)std::min<ptrdiff_t>(std::max<ptrdiff_t>(upper - mArcLengths.begin() - 1, 0), mArcLengths.size() - 2);
+
+	return RefineLocation(entry, clamped);
+}
+
+/// <summary>
+/// Same as LocateDistance, but starts at the entry found by the previous call. Objects moving along the curve
+/// only advance a few entries per frame, so this is O(1) for them; bigger jumps fall back to the binary search.
+/// </summary>
+/// <param name="cursor">Table entry of the previous lookup (0 for a new object), updated by the call</param>
+/// 
+SplineLocation CubicBSpline::LocateDistance(const float& distance, unsigned int& cursor) const
+{
+	float clamped = glm::clamp(distance, 0.0f, GetLength());
+	unsigned int lastEntry = mArcLengths.size() - 2;
+
+	cursor = std::min(cursor, lastEntry);
+
+	for (unsigned int step = 0; step < 4; step++)
+	{
+		if (clamped < mArcLengths[cursor] && cursor > 0)
+			cursor--;
+		else if (clamped >= mArcLengths[cursor + 1] && cursor < lastEntry)
+			cursor++;
+		else
+			return RefineLocation(cursor, clamped);
+	}
+
+	SplineLocation location = LocateDistance(clamped);
+	cursor = location.mSegment * SPLINE_ARC_LENGTH_SUBDIVISIONS + std::min((unsigned int)(location.mT * SPLINE_ARC_LENGTH_SUBDIVISIONS), SPLINE_ARC_LENGTH_SUBDIVISIONS - 1u);
+
+	return location;
+}
+
+// Interpolates the parameter inside a table interval, then corrects it with Newton steps on the exact arc length
+SplineLocation CubicBSpline::RefineLocation(const unsigned int& entry, const float& distance) const
+{
+	const float step = 1.0f / SPLINE_ARC_LENGTH_SUBDIVISIONS;
+
+	SplineLocation location;
+	location.mSegment = entry / SPLINE_ARC_LENGTH_SUBDIVISIONS;
+
+	float t0 = (entry % SPLINE_ARC_LENGTH_SUBDIVISIONS) * step;
+	float t1 = t0 + step;
 
-	glm::mat3 rotationMatrix(1.0f);
+	float span = mArcLengths[entry + 1] - mArcLengths[entry];
+	float t = span > 0.0f ? t0 + (distance - mArcLengths[entry]) / span * step : t0;
 
-	int l = 0;
-	for (size_t i = 1; i <= controlPoints.size() - 3; i++)
+	glm::vec3 position, firstDerivative, secondDerivative;
+
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		EvaluateSegment(location.mSegment, t, position, firstDerivative, secondDerivative);
+
+		float speed = glm::length(firstDerivative);
+		if (speed <= 1e-6f)
+			break;
+
+		float error = mArcLengths[entry] + IntegrateSpeed(location.mSegment, t0, t) - distance;
+		t = glm::clamp(t - error / speed, t0, t1);
+	}
+
+	location.mT = t;
+
+	return location;
+}
+
+SplineFrame CubicBSpline::EvaluateFrame(const SplineLocation& location) const
+{
+	glm::vec3 firstDerivative, secondDerivative;
+
+	SplineFrame frame;
+	EvaluateSegment(location.mSegment, location.mT, frame.mPosition, firstDerivative, secondDerivative);
+	ComputeFrame(firstDerivative, secondDerivative, frame);
+
+	return frame;
+}
+
+/// <summary>
+/// Same as EvaluateFrame for many locations; with SSE the coefficients of 4 locations (any segments) are gathered into lanes
+/// and evaluated together
+/// </summary>
+/// 
+void CubicBSpline::EvaluateFrames(const SplineLocation* locations, const unsigned int& count, SplineFrame* frames) const
+{
+	unsigned int i = 0;
+
+#ifdef SPLINE_USE_SSE
+
+	__m128 coefficients[4][3];
+	alignas(16) float values[12][4];
+
+	for (; i + 4 <= count; i += 4)
 	{
-		glm::vec4 T{};
-		glm::vec3 T2{};
-		glm::vec2 T3{};
+		const SplineSegment* s[4];
+
+		for (unsigned int j = 0; j < 4; j++)
+		{
+			s[j] = &mSegments[locations[i + j].mSegment];
+		}
+
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			coefficients[0][axis] = _mm_set_ps(s[3]->mA[axis], s[2]->mA[axis], s[1]->mA[axis], s[0]->mA[axis]);
+			coefficients[1][axis] = _mm_set_ps(s[3]->mB[axis], s[2]->mB[axis], s[1]->mB[axis], s[0]->mB[axis]);
+			coefficients[2][axis] = _mm_set_ps(s[3]->mC[axis], s[2]->mC[axis], s[1]->mC[axis], s[0]->mC[axis]);
+			coefficients[3][axis] = _mm_set_ps(s[3]->mD[axis], s[2]->mD[axis], s[1]->mD[axis], s[0]->mD[axis]);
+		}
 
-		glm::mat4x3 R{ controlPoints[i - 1], controlPoints[i], controlPoints[i + 1], controlPoints[i + 2]};
+		__m128 t = _mm_set_ps(locations[i + 3].mT, locations[i + 2].mT, locations[i + 1].mT, locations[i].mT);
 
-		glm::mat4 B{ {-1.0f, 3.0f, -3.0f, 1.0f}, {3.0f, -6.0f, 3.0f, 0.0f}, {-3.0f, 0.0f, 3.0f, 0.0f}, {1.0f, 4.0f, 1.0f, 0.0} };
-		glm::mat3x4 B2{ {-1.0f, 3.0f, -3.0f, 1.0f}, {2.0f, -4.0f, 2.0f, 0.0f}, {-1.0f, 0.0f, 1.0f, 0.0f} };
-		glm::mat2x4 B3{ {-1.0f, 3.0f, -3.0f, 1.0f}, {1.0f, -2.0f, 1.0f, 0.0f} };
+		EvaluateFramesSSE(coefficients, t, values);
 
-		glm::vec3 opResult, tangResult, tang2Result;
-		for (float j = 0.0f; j < 1.0f; j += delta)
+		for (unsigned int j = 0; j < 4; j++)
 		{
-			T = {j*j*j, j*j, j, 1.0f};
-			T2 = { j*j, j, 1.0f };
-			T3 = { j, 1.0f };
+			SplineFrame& frame = frames[i + j];
+			frame.mPosition = { values[0][j], values[1][j], values[2][j] };
+			frame.mTangent = { values[3][j], values[4][j], values[5][j] };
+			frame.mNormal = { values[6][j], values[7][j], values[8][j] };
+			frame.mBinormal = { values[9][j], values[10][j], values[11][j] };
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		frames[i] = EvaluateFrame(locations[i]);
+	}
+}
+
+SplineFrame CubicBSpline::EvaluateAtDistance(const float& distance) const
+{
+	return EvaluateFrame(LocateDistance(distance));
+}
+
+/// <summary>
+/// Point on the curve closest to the given point (local space of the spline)
+/// </summary>
+/// 
+SplineQueryResult CubicBSpline::FindClosestPoint(const glm::vec3& point) const
+{
+	SplineQueryResult result;
 
-			opResult = { R * B * (T * (1.0f / 6.0f)) }; // spline points
-			tangResult = { R * B2 * (T2 * (1.0f / 2.0f)) }; // first derivative
-			tang2Result = { R * B3 * T3 }; // second derivative
+	float distanceSquared = mSegmentTree.QueryClosest(point, [&](void* userData, const float& bestDistanceSquared)
+	{
+		unsigned int segment = (unsigned int)(uintptr_t)userData;
+		float t;
+		float segmentDistance = ClosestPointOnSegment(segment, point, t);
 
-			mSplinePoints.push_back({ opResult, {1.0f, 1.0f, 1.0f} });
+		if (segmentDistance < bestDistanceSquared)
+			result.mLocation = { segment, t };
 
-			mTangents.push_back({glm::normalize(tangResult), {1.0f, -1.0f, -1.0f}});
-			mNormals.push_back({ glm::normalize(glm::cross(mTangents.back().pos, (tang2Result))), {-1.0f, 1.0f, -1.0f} });
-			mBinormals.push_back({ glm::normalize(glm::cross(mNormals.back().pos, mTangents.back().pos)), {-1.0f, -1.0f, 1.0f} });
+		return segmentDistance;
+	});
 
+	result.mPosition = EvaluatePosition(result.mLocation.mSegment, result.mLocation.mT);
+	result.mDistance = std::sqrt(distanceSquared);
+	result.mValid = true;
 
-			rotationMatrix = { mBinormals.back().pos, mNormals.back().pos, mTangents.back().pos };
+	return result;
+}
 
-			// rotationMatrix = glm::inverse(rotationMatrix);
+SplineQueryResult CubicBSpline::FindClosestPointBruteForce(const glm::vec3& point) const
+{
+	SplineQueryResult result;
+	float distanceSquared = std::numeric_limits<float>::max();
 
-			mRotationMatrices.push_back(rotationMatrix);
+	for (int segment = 0; segment < mNumOfSegments; segment++)
+	{
+		float t;
+		float segmentDistance = ClosestPointOnSegment(segment, point, t);
 
-			indices.push_back(l);
-			l++;
+		if (segmentDistance < distanceSquared)
+		{
+			distanceSquared = segmentDistance;
+			result.mLocation = { (unsigned int)segment, t };
 		}
 	}
 
-	mSplinePoints.push_back(mSplinePoints[0]);
-	mSplinePoints.push_back(mSplinePoints[0].AddPosition(mTangents[0]));
-	mSplinePoints.push_back(mSplinePoints[0]);
-	mSplinePoints.push_back(mSplinePoints[0].AddPosition(mNormals[0]));
-	mSplinePoints.push_back(mSplinePoints[0]);
-	mSplinePoints.push_back(mSplinePoints[0].AddPosition(mBinormals[0]));
+	result.mPosition = EvaluatePosition(result.mLocation.mSegment, result.mLocation.mT);
+	result.mDistance = std::sqrt(distanceSquared);
+	result.mValid = true;
 
-	mActive++;
+	return result;
+}
+
+void CubicBSpline::FindClosestPoints(const glm::vec3* points, const unsigned int& count, SplineQueryResult* results) const
+{
+	ThreadPool::GetShared().ParallelFor(count, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			results[i] = FindClosestPoint(points[i]);
+		}
+	}, SPLINE_QUERY_PARALLEL_MIN);
+}
+
+/// <summary>
+/// Treats the curve as a tube and returns the hit closest to the ray origin. On every segment the point closest to the ray
+/// is used, so the hit lies on the curve itself, not on the surface of the tube.
+/// </summary>
+/// <param name="direction">Doesn't have to be normalized</param>
+/// <param name="radius">Radius of the tube, in model units</param>
+/// <returns>mValid is false if the ray missed</returns>
+/// 
+SplineQueryResult CubicBSpline::Raycast(const glm::vec3& origin, const glm::vec3& direction, const float& radius) const
+{
+	SplineQueryResult result;
+
+	float length = glm::length(direction);
+
+	if (length <= 0.0f)
+		return result;
+
+	glm::vec3 unitDirection = direction / length;
+	float radiusSquared = radius * radius;
+
+	mSegmentTree.QueryRay(origin, unitDirection, std::numeric_limits<float>::max(), radius, [&](void* userData, const float& maxDistance)
+	{
+		unsigned int segment = (unsigned int)(uintptr_t)userData;
+		float t, rayDistance;
+		float distanceSquared = ClosestPointToRay(segment, origin, unitDirection, t, rayDistance);
+
+		if (distanceSquared > radiusSquared || rayDistance >= maxDistance)
+			return maxDistance;
+
+		result.mLocation = { segment, t };
+		result.mDistance = std::sqrt(distanceSquared);
+		result.mRayDistance = rayDistance;
+		result.mValid = true;
+
+		return rayDistance;
+	});
+
+	if (result.mValid)
+		result.mPosition = EvaluatePosition(result.mLocation.mSegment, result.mLocation.mT);
+
+	return result;
+}
+
+void CubicBSpline::Raycast(const glm::vec3* origins, const glm::vec3* directions, const unsigned int& count, const float& radius, SplineQueryResult* results) const
+{
+	ThreadPool::GetShared().ParallelFor(count, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			results[i] = Raycast(origins[i], directions[i], radius);
+		}
+	}, SPLINE_QUERY_PARALLEL_MIN);
+}
+
+/// <summary>
+/// Minimizes the squared distance over the segment: the best of a few uniform samples is refined with Newton iterations
+/// on the derivative (P(t) - point) . P'(t)
+/// </summary>
+/// <returns>Squared distance; t is set to the parameter of the closest point</returns>
+/// 
+float CubicBSpline::ClosestPointOnSegment(const unsigned int& segment, const glm::vec3& point, float& t) const
+{
+	const SplineSegment& s = mSegments[segment];
+
+	glm::vec3 position, firstDerivative, secondDerivative;
+	float best = std::numeric_limits<float>::max();
+
+	for (unsigned int i = 0; i <= SPLINE_QUERY_SAMPLES; i++)
+	{
+		float sampleT = (float)i / SPLINE_QUERY_SAMPLES;
+		glm::vec3 offset = ((s.mA * sampleT + s.mB) * sampleT + s.mC) * sampleT + s.mD - point;
+		float distanceSquared = glm::dot(offset, offset);
+
+		if (distanceSquared < best)
+		{
+			best = distanceSquared;
+			t = sampleT;
+		}
+	}
+
+	float refinedT = t;
+
+	for (unsigned int step = 0; step < SPLINE_QUERY_NEWTON_STEPS; step++)
+	{
+		EvaluateSegment(s, refinedT, position, firstDerivative, secondDerivative);
+
+		glm::vec3 offset = position - point;
+		float derivative = glm::dot(offset, firstDerivative);
+		float secondOrder = glm::dot(firstDerivative, firstDerivative) + glm::dot(offset, secondDerivative);
+
+		// not a minimum nearby, keep the sample
+		if (secondOrder <= 0.0f)
+			break;
+
+		refinedT = glm::clamp(refinedT - derivative / secondOrder, 0.0f, 1.0f);
+	}
+
+	glm::vec3 offset = ((s.mA * refinedT + s.mB) * refinedT + s.mC) * refinedT + s.mD - point;
+	float refined = glm::dot(offset, offset);
+
+	if (refined < best)
+	{
+		best = refined;
+		t = refinedT;
+	}
+
+	return best;
+}
+
+// same as ClosestPointOnSegment, but the distance is measured to the ray (unit direction); points behind the origin are measured to the origin
+float CubicBSpline::ClosestPointToRay(const unsigned int& segment, const glm::vec3& origin, const glm::vec3& direction, float& t, float& rayDistance) const
+{
+	const SplineSegment& s = mSegments[segment];
+
+	auto measure = [&](const glm::vec3& position, float& alongRay)
+	{
+		glm::vec3 offset = position - origin;
+		alongRay = std::max(glm::dot(offset, direction), 0.0f);
+		offset -= alongRay * direction;
+
+		return glm::dot(offset, offset);
+	};
+
+	glm::vec3 position, firstDerivative, secondDerivative;
+	float best = std::numeric_limits<float>::max();
+	float alongRay;
+
+	for (unsigned int i = 0; i <= SPLINE_QUERY_SAMPLES; i++)
+	{
+		float sampleT = (float)i / SPLINE_QUERY_SAMPLES;
+		float distanceSquared = measure(((s.mA * sampleT + s.mB) * sampleT + s.mC) * sampleT + s.mD, alongRay);
+
+		if (distanceSquared < best)
+		{
+			best = distanceSquared;
+			t = sampleT;
+			rayDistance = alongRay;
+		}
+	}
+
+	float refinedT = t;
+
+	for (unsigned int step = 0; step < SPLINE_QUERY_NEWTON_STEPS; step++)
+	{
+		EvaluateSegment(s, refinedT, position, firstDerivative, secondDerivative);
+
+		glm::vec3 offset = position - origin;
+		float along = glm::dot(offset, direction);
+		float speedSquared = glm::dot(firstDerivative, firstDerivative);
+
+		// perpendicular part of the offset; behind the origin the whole offset counts
+		if (along > 0.0f)
+		{
+			offset -= along * direction;
+
+			float alongDerivative = glm::dot(firstDerivative, direction);
+			speedSquared -= alongDerivative * alongDerivative;
+		}
+
+		float derivative = glm::dot(offset, firstDerivative);
+		float secondOrder = speedSquared + glm::dot(offset, secondDerivative);
+
+		if (secondOrder <= 0.0f)
+			break;
+
+		refinedT = glm::clamp(refinedT - derivative / secondOrder, 0.0f, 1.0f);
+	}
+
+	float refined = measure(((s.mA * refinedT + s.mB) * refinedT + s.mC) * refinedT + s.mD, alongRay);
+
+	if (refined < best)
+	{
+		best = refined;
+		t = refinedT;
+		rayDistance = alongRay;
+	}
+
+	return best;
+}
+
+void CubicBSpline::Upload()
+{
+	unsigned int sampleCount = GetSampleCount();
+
+	std::vector<unsigned int> indices(sampleCount);
+
+	for (unsigned int i = 0; i < indices.size(); i++)
+	{
+		indices[i] = i;
+	}
 
 	mVArray.Bind();
 
@@ -106,38 +1222,158 @@ void CubicBSpline::FillSplinePoints(std::vector<glm::vec3>& controlPoints, const
 	mVArray.SetDrawingMode(GL_LINE_STRIP);
 	mVArray.SetUsage(GL_STATIC_DRAW);
 
-	mVBuffer.FillBuffer(mSplinePoints.data(), mSplinePoints.size() * sizeof(Vertex), mVArray.GetUsage());
+	// samples followed by the 6 guide vertices, allocated once so the chunks don't grow the buffer
+	mVBuffer.AdjustBufferSize((sampleCount + 6) * sizeof(Vertex), mVArray.GetUsage());
+
+	UploadSamples(0, sampleCount);
+	UpdateGuides(0);
+
+	mIBuffer.FillBuffer(indices.data(), indices.size(), GL_STATIC_DRAW);
+
+	mVArray.AddBuffer(mVBuffer, mIBuffer);
+}
+
+/// <summary>
+/// Converts samples first..first + count - 1 to vertices and writes them to the vertex buffer, SPLINE_UPLOAD_CHUNK at a time,
+/// so the whole curve never exists in the vertex format on the CPU
+/// </summary>
+/// 
+void CubicBSpline::UploadSamples(const unsigned int& first, const unsigned int& count)
+{
+	std::vector<Vertex> vertices(std::min(count, SPLINE_UPLOAD_CHUNK));
+
+	for (unsigned int offset = 0; offset < count; offset += SPLINE_UPLOAD_CHUNK)
+	{
+		unsigned int chunkSize = std::min(count - offset, SPLINE_UPLOAD_CHUNK);
+
+		for (unsigned int i = 0; i < chunkSize; i++)
+		{
+			vertices[i] = { mPositions[first + offset + i], {1.0f, 1.0f, 1.0f} };
+		}
+
+		if (first + offset == 0)
+			mVBuffer.FillBuffer(vertices.data(), chunkSize * sizeof(Vertex), mVArray.GetUsage());
+		else
+			mVBuffer.InsertDataWithOffset(vertices.data(), chunkSize * sizeof(Vertex), (first + offset) * sizeof(Vertex));
+	}
+}
+
+// tangent, normal and binormal of one sample as 3 lines, only these 6 vertices are rewritten in the vertex buffer
+void CubicBSpline::UpdateGuides(const unsigned int& index)
+{
+	SplineFrame frame = GetFrame(index);
+	Vertex point = { frame.mPosition, {1.0f, 1.0f, 1.0f} };
+
+	mCurrentGuides[0] = point;
+	mCurrentGuides[1] = point.AddPosition({ frame.mTangent, {1.0f, -1.0f, -1.0f} });
+	mCurrentGuides[2] = point;
+	mCurrentGuides[3] = point.AddPosition({ frame.mNormal, {-1.0f, 1.0f, -1.0f} });
+	mCurrentGuides[4] = point;
+	mCurrentGuides[5] = point.AddPosition({ frame.mBinormal, {-1.0f, -1.0f, 1.0f} });
+
+	mVBuffer.InsertDataWithOffset(mCurrentGuides.data(), mCurrentGuides.size() * sizeof(Vertex), GetSampleCount() * sizeof(Vertex));
+}
+
+/// <summary>
+/// Uploads the control points and one patch (4 indices) per segment, nothing that depends on the sample rate
+/// </summary>
+/// 
+void CubicBSpline::UploadControlPoints()
+{
+	std::vector<unsigned int> indices(mNumOfSegments * 4);
+
+	for (int i = 0; i < mNumOfSegments; i++)
+	{
+		for (unsigned int j = 0; j < 4; j++)
+		{
+			indices[i * 4 + j] = i + j;
+		}
+	}
+
+	mVArray.Bind();
+
+	VertexBufferLayout layout;
+	layout.Push<float>(3);
+
+	mVArray.SetLayout(layout, false);
+	mVArray.SetDrawingMode(GL_PATCHES);
+	mVArray.SetUsage(GL_STATIC_DRAW);
+
+	unsigned int vertexSize = mControlPoints.size() * sizeof(glm::vec3);
+
+	mVBuffer.SetInitialCapacity(vertexSize);
+	mIBuffer.SetInitialCapacity(indices.size() * sizeof(unsigned int));
+
+	mVBuffer.FillBuffer(mControlPoints.data(), vertexSize, mVArray.GetUsage());
 	mIBuffer.FillBuffer(indices.data(), indices.size(), GL_STATIC_DRAW);
 
 	mVArray.AddBuffer(mVBuffer, mIBuffer);
 }
 
+void CubicBSpline::SetTessellationUniforms(Shader& shader, const unsigned int& viewportWidth, const unsigned int& viewportHeight) const
+{
+	if (mHandleShaderID != shader.GetRendererID())
+	{
+		mTessellationHandle = shader.GetUniformHandle<glm::vec4>("uTessellation");
+		mHandleShaderID = shader.GetRendererID();
+	}
+
+	shader.SetUniform(mTessellationHandle, glm::vec4((float)viewportWidth, (float)viewportHeight, mPixelsPerSegment, SPLINE_TESSELLATION_MAX_LEVEL));
+}
+
+void CubicBSpline::SetPixelsPerSegment(const float& pixels)
+{
+	if (pixels <= 0.0f)
+		Debug::ThrowException("CubicBSpline => pixels per segment must be positive! (pixels = " + STRING(pixels) + ")");
+
+	mPixelsPerSegment = pixels;
+}
+
 void CubicBSpline::Draw()
 {
+	PROFILE_SCOPE("CubicBSpline::Draw");
+
+	const glm::mat4& model = mTransform.GetMatrix();
+	ObjectBlock& object = mObjectBlock.Data();
+
+	if (!mObjectBlockValid || object.mModel != model)
+	{
+		object.mModel = model;
+		object.mNormalMatrix = glm::transpose(glm::inverse(model));
+		mObjectBlock.Upload();
+		mObjectBlockValid = true;
+	}
+
+	mObjectBlock.Bind();
+
+	if (mEvaluation == SPLINE_EVALUATION_GPU)
+	{
+		mVArray.Bind();
+		mVBuffer.Bind<glm::vec3>(0);
+		mIBuffer.Bind();
+
+		glPatchParameteri(GL_PATCH_VERTICES, 4);
+		glDrawElements(GL_PATCHES, mIBuffer.GetIndicesCount(), GL_UNSIGNED_INT, nullptr);
+
+		return;
+	}
+
 	mVArray.Bind();
 	mVBuffer.Bind<Vertex>(0);
 	mIBuffer.Bind(); // i thought that VAO stored state about the index buffer ???
 
-	glDrawElements(mVArray.GetDrawingMode(), mSplinePoints.size() - 6, GL_UNSIGNED_INT, nullptr);
+	glDrawElements(mVArray.GetDrawingMode(), GetSampleCount(), GL_UNSIGNED_INT, nullptr);
 	
 	glLineWidth(3.0f);
-	glDrawArrays(GL_LINES, mSplinePoints.size() - 6, 6);
+	glDrawArrays(GL_LINES, GetSampleCount(), 6);
 	glLineWidth(1.0f);
 
-	auto size = mSplinePoints.size();
-	mSplinePoints[size - 6] = (mSplinePoints[mActive]);
-	mSplinePoints[size - 5] = (mSplinePoints[mActive].AddPosition(mTangents[mActive]));
-	mSplinePoints[size - 4] = (mSplinePoints[mActive]);
-	mSplinePoints[size - 3] = (mSplinePoints[mActive].AddPosition(mNormals[mActive]));
-	mSplinePoints[size - 2] = (mSplinePoints[mActive]);
-	mSplinePoints[size - 1] = (mSplinePoints[mActive].AddPosition(mBinormals[mActive]));
+	UpdateGuides(mActive);
 
 	mActive++;
 
-	if ((size_t)mActive >= mTangents.size())
+	if ((size_t)mActive >= GetSampleCount())
 		mActive = 0;
-
-	mVBuffer.FillBuffer(mSplinePoints.data(), mSplinePoints.size() * sizeof(Vertex), mVArray.GetUsage());
 }
 
 const bool& CubicBSpline::IsActive() const
@@ -155,7 +1391,15 @@ Transform& CubicBSpline::GetTransform()
 	return mTransform;
 }
 
-const std::vector<Vertex>& CubicBSpline::GetTangents() const
+// the curve always lies inside the convex hull of its control points
+AABB CubicBSpline::GetLocalBounds() const
 {
-	return mTangents;
+	AABB bounds;
+
+	for (const auto& point : mControlPoints)
+	{
+		bounds.Expand(point);
+	}
+
+	return bounds;
 }
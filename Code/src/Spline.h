@@ -3,6 +3,7 @@
 #include <vector>
 
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
@@ -10,28 +11,174 @@
 #include "Drawable.h"
 #include "Mesh.h"
 #include "Transform.h"
+#include "BVH.h"
+#include "Shader.h"
+#include "UniformBuffer.h"
+
+#define SPLINE_ADAPTIVE_MIN_DEPTH 1 // every segment is split at least once, so S-shaped segments aren't taken for straight lines
+#define SPLINE_ARC_LENGTH_SUBDIVISIONS 16 // arc length table entries per segment
+#define SPLINE_PARALLEL_MIN_SAMPLES 4096 // smallest range of samples evaluated by one job
+#define SPLINE_UPLOAD_CHUNK 65536u // samples converted to vertices at once when uploading
+#define SPLINE_TESSELLATION_MAX_LEVEL 64.0f // GL_MAX_TESS_GEN_LEVEL is at least 64
+#define SPLINE_TESSELLATION_PIXELS_PER_SEGMENT 8.0f // screen-space length of one generated line segment
+
+#define SPLINE_QUERY_SAMPLES 8 // coarse samples per segment that pick the start of the Newton refinement
+#define SPLINE_QUERY_NEWTON_STEPS 4
+#define SPLINE_QUERY_PARALLEL_MIN 64 // smallest number of queries handled by one job
+
+enum SplineEvaluation
+{
+	SPLINE_EVALUATION_CPU = 0, // samples are evaluated on the CPU and uploaded as a line strip
+	SPLINE_EVALUATION_GPU = 1 // only the control points are uploaded, tessellation shaders generate the curve (Shaders/spline.glsl)
+};
+
+// Power basis form of one segment: P(t) = ((mA * t + mB) * t + mC) * t + mD, precomputed from its 4 control points
+struct SplineSegment
+{
+	glm::vec3 mA;
+	glm::vec3 mB;
+	glm::vec3 mC;
+	glm::vec3 mD;
+};
+
+// Point on the curve: segment index (control points mSegment..mSegment + 3) and parameter in [0, 1]
+struct SplineLocation
+{
+	unsigned int mSegment = 0;
+	float mT = 0.0f;
+};
+
+struct SplineFrame
+{
+	glm::vec3 mPosition;
+	glm::vec3 mTangent;
+	glm::vec3 mNormal;
+	glm::vec3 mBinormal;
+
+	// same layout as GetRotationMatrices (binormal, normal, tangent columns)
+	glm::mat3 GetRotation() const
+	{
+		return { mBinormal, mNormal, mTangent };
+	}
+};
+
+// Result of a closest point or ray query, in the local space of the spline
+struct SplineQueryResult
+{
+	SplineLocation mLocation;
+	glm::vec3 mPosition{ 0.0f };
+	float mDistance = 0.0f; // from the query point, or from the ray for ray queries
+	float mRayDistance = 0.0f; // along the ray to the point closest to the curve; ray queries only
+	bool mValid = false; // false if a ray missed the curve
+};
 
 class CubicBSpline : public Drawable
 {
 public:
 
-	CubicBSpline(std::vector<glm::vec3>& controlPoints, const unsigned int& sampleRate = 1000);
+	// tolerance > 0 samples adaptively: segments are subdivided until the curve is within tolerance of its chords,
+	// sampleRate then only limits the density (never more samples than uniform sampling would produce)
+	// with SPLINE_EVALUATION_GPU there are no samples, sampleRate and tolerance are ignored
+	CubicBSpline(std::vector<glm::vec3>& controlPoints, const unsigned int& sampleRate = 1000, const float& tolerance = 0.0f,
+		const SplineEvaluation& evaluation = SPLINE_EVALUATION_CPU);
 	~CubicBSpline();
 
+	// samples are stored as a position and an orientation (28 bytes per sample), these accessors build the old
+	// per-sample arrays on first use after every FillSplinePoints; not thread-safe
 	const std::vector<Vertex>& GetSplinePoints() const;
 	const std::vector<glm::mat4>& GetRotationMatrices() const;
+	const std::vector<Vertex>& GetTangents() const;
 
-	void FillSplinePoints(std::vector<glm::vec3>& controlPoints, const unsigned int& sampleRate);
+	const std::vector<glm::vec3>& GetPositions() const;
+	const std::vector<glm::quat>& GetOrientations() const; // rotation with the same columns as SplineFrame::GetRotation
+	SplineFrame GetFrame(const unsigned int& index) const;
+	glm::mat4 GetRotationMatrix(const unsigned int& index) const;
 
-	void Draw();
+	void FillSplinePoints(std::vector<glm::vec3>& controlPoints, const unsigned int& sampleRate, const float& tolerance = 0.0f);
+
+	// a control point is used by at most 4 segments, edits re-evaluate and upload only those; with adaptive sampling
+	// or inserted/removed segments the sample count changes and the samples after the edit are uploaded too
+	void SetControlPoint(const unsigned int& index, const glm::vec3& point);
+	void InsertControlPoint(const unsigned int& index, const glm::vec3& point);
+	void RemoveControlPoint(const unsigned int& index);
+	const std::vector<glm::vec3>& GetControlPoints() const;
+
+	const SplineEvaluation& GetEvaluation() const;
+	unsigned int GetSegmentCount() const;
+	unsigned int GetSampleCount() const;
+	unsigned int GetBufferSize() const; // vertex and index data on the GPU, in bytes
+	const unsigned int& GetSavedSamples() const;
+
+	// arc length parameterization, distances are clamped to [0, GetLength()]
+	float GetLength() const;
+	SplineLocation LocateDistance(const float& distance) const;
+	SplineLocation LocateDistance(const float& distance, unsigned int& cursor) const; // cursor keeps the last table entry, O(1) for small steps
+	SplineFrame EvaluateFrame(const SplineLocation& location) const;
+	void EvaluateFrames(const SplineLocation* locations, const unsigned int& count, SplineFrame* frames) const; // 4 at a time with SSE
+	SplineFrame EvaluateAtDistance(const float& distance) const;
+
+	// GPU evaluation: the shader has to be bound before Draw, the tessellation level of every segment follows its size on screen
+	void SetTessellationUniforms(Shader& shader, const unsigned int& viewportWidth, const unsigned int& viewportHeight) const;
+	void SetPixelsPerSegment(const float& pixels);
+
+	void Draw(); // binds its own Object block with the matrix of GetTransform
 	virtual const bool& IsActive() const;
 	virtual void SetActive(const bool& value);
 
 	Transform& GetTransform();
-	const std::vector<Vertex>& GetTangents() const;
+	AABB GetLocalBounds() const;
+
+	// queries in the local space of the curve; the segment BVH (boxes of the control point hulls) narrows the candidates,
+	// Newton iterations find the exact point on each candidate segment. The batch versions run on the shared thread pool.
+	SplineQueryResult FindClosestPoint(const glm::vec3& point) const;
+	SplineQueryResult FindClosestPointBruteForce(const glm::vec3& point) const; // tests every segment, reference for FindClosestPoint
+	void FindClosestPoints(const glm::vec3* points, const unsigned int& count, SplineQueryResult* results) const;
+	SplineQueryResult Raycast(const glm::vec3& origin, const glm::vec3& direction, const float& radius) const; // nearest point along the ray within radius of the curve
+	void Raycast(const glm::vec3* origins, const glm::vec3* directions, const unsigned int& count, const float& radius, SplineQueryResult* results) const;
+
+	// evaluation without a CubicBSpline instance (used by SplineStream for control points that are never stored as a whole)
+	static SplineSegment ComputeSegment(const glm::vec3* controlPoints); // power basis of controlPoints[0..3]
+	static void EvaluateSegmentSamples(const SplineSegment& segment, const unsigned int& first, const unsigned int& count, const float& delta,
+		glm::vec3* positions, glm::quat* orientations);
 
 private:
 
+	void EvaluateSegment(const unsigned int& segment, const float& t, glm::vec3& position, glm::vec3& firstDerivative, glm::vec3& secondDerivative) const;
+	static void EvaluateSegment(const SplineSegment& segment, const float& t, glm::vec3& position, glm::vec3& firstDerivative, glm::vec3& secondDerivative);
+	glm::vec3 EvaluatePosition(const unsigned int& segment, const float& t) const;
+	void AppendSample(const unsigned int& segment, const float& t);
+	static void StoreFrame(const SplineFrame& frame, glm::vec3& position, glm::quat& orientation);
+	void EvaluateSamples(const unsigned int& segment, const unsigned int& first, const unsigned int& count, const float& delta, const unsigned int& outputIndex);
+
+	void BuildSegments();
+	void BuildSegmentTree();
+	AABB GetSegmentBounds(const unsigned int& segment) const;
+	float ClosestPointOnSegment(const unsigned int& segment, const glm::vec3& point, float& t) const;
+	float ClosestPointToRay(const unsigned int& segment, const glm::vec3& origin, const glm::vec3& direction, float& t, float& rayDistance) const;
+	void BuildSegment(const unsigned int& segment);
+	void UpdateSegments(const unsigned int& first, const unsigned int& oldCount, const unsigned int& newCount);
+	void UpdateSamples(const unsigned int& first, const unsigned int& oldCount, const unsigned int& newCount, const unsigned int& oldNumOfSegments);
+
+	void SampleUniform(const unsigned int& sampleRate);
+	unsigned int GetUniformSamplesPerSegment(const unsigned int& sampleRate) const;
+	void EvaluateUniformSegments(const unsigned int& first, const unsigned int& count);
+	unsigned int GetAdaptiveMaxDepth() const;
+	void SampleAdaptive(const unsigned int& sampleRate, const float& tolerance);
+	void SubdivideSegment(const unsigned int& segment, const float& t0, const glm::vec3& p0, const float& t1, const glm::vec3& p1,
+		const unsigned int& depth, const unsigned int& maxDepth, const float& tolerance);
+
+	static void ComputeFrame(const glm::vec3& firstDerivative, const glm::vec3& secondDerivative, SplineFrame& frame);
+
+	void BuildArcLengthTable();
+	void UpdateArcLengthTable(const unsigned int& first, const unsigned int& oldCount, const unsigned int& newCount);
+	float IntegrateSpeed(const unsigned int& segment, const float& t0, const float& t1) const;
+	SplineLocation RefineLocation(const unsigned int& entry, const float& distance) const;
+
+	void Upload();
+	void UploadControlPoints();
+	void UploadSamples(const unsigned int& first, const unsigned int& count);
+	void UpdateGuides(const unsigned int& index);
+
 	bool mBoolActive = true;
 	int mActive = 0;
 	VertexArray mVArray;
@@ -39,14 +186,28 @@ private:
 	VertexBuffer mVBufferGuides;
 	IndexBuffer mIBuffer;
 	Transform mTransform;
+	UniformBlock<ObjectBlock> mObjectBlock{ OBJECT_BLOCK_BINDING };
+	bool mObjectBlockValid = false;
 	std::vector<glm::vec3> mControlPoints;
-	std::vector<Vertex> mSplinePoints;
-	std::vector<Vertex> mTangents;
-	std::vector<Vertex> mNormals;
-	std::vector<Vertex> mBinormals;
-	std::vector<Vertex> mCurrentGuides;
-	std::vector<glm::mat4> mRotationMatrices;
+	std::vector<SplineSegment> mSegments;
+	std::vector<unsigned int> mSegmentOffsets; // index of the first sample of every segment, mNumOfSegments + 1 entries
+	std::vector<glm::vec3> mPositions;
+	std::vector<glm::quat> mOrientations;
+	std::vector<Vertex> mCurrentGuides; // tangent, normal and binormal lines of sample mActive, stored after the samples in mVBuffer
+	mutable std::vector<Vertex> mSplinePoints;
+	mutable std::vector<Vertex> mTangents;
+	mutable std::vector<glm::mat4> mRotationMatrices;
+	BVH mSegmentTree; // user data of a leaf is its segment index
+	std::vector<int> mSegmentLeaves;
+	std::vector<float> mArcLengths; // cumulative length at every table entry, SPLINE_ARC_LENGTH_SUBDIVISIONS entries per segment + the end
 	int mNumOfSegments;
 	unsigned int mSampleRate;
+	unsigned int mSamplesPerSegment = 0; // uniform sampling only
+	float mTolerance;
+	SplineEvaluation mEvaluation;
+	float mPixelsPerSegment = SPLINE_TESSELLATION_PIXELS_PER_SEGMENT;
+	unsigned int mSavedSamples = 0; // compared to uniform sampling with the same sample rate
+	mutable unsigned int mHandleShaderID = 0; // shader for which mTessellationHandle was resolved
+	mutable UniformHandle<glm::vec4> mTessellationHandle;
 
 };
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "SplineFollowers.h"
+
+#include <cmath>
+
+#include "Debug.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+SplineFollowers::SplineFollowers(CubicBSpline& spline, InstanceGroup& instances, const glm::mat4& meshTransform)
+	:
+	mSpline(spline),
+	mInstances(instances),
+	mMeshTransform(meshTransform)
+{
+}
+
+/// <summary>
+/// 
+/// </summary>
+/// <param name="distance">Starting distance along the curve</param>
+/// <param name="speed">Units per second, negative moves backwards</param>
+/// <returns>Follower index</returns>
+/// 
+unsigned int SplineFollowers::AddFollower(const float& distance, const float& speed)
+{
+	unsigned int instance = mInstances.AddInstance(mSpline.GetTransform().GetMatrix() * mMeshTransform);
+
+	if (mFollowers.empty())
+		mFirstInstance = instance;
+	else if (instance != mFirstInstance + mFollowers.size())
+		Debug::ThrowException("SplineFollowers => instances of the followers must be consecutive! (instance = " + STRING(instance) + ")");
+
+	SplineFollower follower;
+	follower.mDistance = distance;
+	follower.mSpeed = speed;
+
+	mFollowers.push_back(follower);
+
+	return mFollowers.size() - 1;
+}
+
+void SplineFollowers::SetSpeed(const unsigned int& follower, const float& speed)
+{
+	if (follower >= mFollowers.size())
+		Debug::ThrowException("Follower index out of range! (index = " + STRING(follower) + ")");
+
+	mFollowers[follower].mSpeed = speed;
+}
+
+void SplineFollowers::ClearFollowers()
+{
+	mFollowers.clear();
+}
+
+/// <summary>
+/// Advances every follower and writes its instance transform. Each job locates its followers on the curve (the arc length
+/// cursor makes that O(1) for small steps), evaluates their frames in one batch and builds the matrices.
+/// </summary>
+/// <param name="deltaTime">Seconds since the last update</param>
+/// 
+void SplineFollowers::Update(const float& deltaTime)
+{
+	PROFILE_SCOPE("SplineFollowers::Update");
+
+	unsigned int count = mFollowers.size();
+
+	if (count == 0)
+		return;
+
+	float length = mSpline.GetLength();
+	glm::mat4 splineModel = mSpline.GetTransform().GetMatrix();
+	InstanceData* instances = mInstances.MapInstances(mFirstInstance, count);
+
+	mLocations.resize(count);
+	mFrames.resize(count);
+
+	ThreadPool::GetShared().ParallelFor(count, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			SplineFollower& follower = mFollowers[i];
+
+			if (length > 0.0f)
+			{
+				follower.mDistance = std::fmod(follower.mDistance + follower.mSpeed * deltaTime, length);
+
+				if (follower.mDistance < 0.0f)
+					follower.mDistance += length;
+			}
+
+			mLocations[i] = mSpline.LocateDistance(follower.mDistance, follower.mCursor);
+		}
+
+		mSpline.EvaluateFrames(&mLocations[begin], end - begin, &mFrames[begin]);
+
+		for (unsigned int i = begin; i < end; i++)
+		{
+			const SplineFrame& frame = mFrames[i];
+
+			// same columns as CubicBSpline::GetRotationMatrices, with the position as translation
+			glm::mat4 model(glm::vec4(frame.mBinormal, 0.0f), glm::vec4(frame.mNormal, 0.0f), glm::vec4(frame.mTangent, 0.0f), glm::vec4(frame.mPosition, 1.0f));
+
+			instances[i].SetModel(splineModel * model * mMeshTransform);
+		}
+	}, SPLINE_FOLLOWERS_PARALLEL_MIN);
+}
+
+const std::vector<SplineFollower>& SplineFollowers::GetFollowers() const
+{
+	return mFollowers;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Spline.h"
+#include "InstanceGroup.h"
+
+#define SPLINE_FOLLOWERS_PARALLEL_MIN 1024 // smallest number of followers updated by one job
+
+struct SplineFollower
+{
+	float mDistance = 0.0f; // along the curve
+	float mSpeed = 0.0f; // units per second, negative moves backwards
+	unsigned int mCursor = 0; // arc length table entry of the last update (see CubicBSpline::LocateDistance)
+};
+
+// Moves instances of an InstanceGroup along a CubicBSpline, each at its own distance and speed, and wraps them around at the ends.
+// Update writes every model matrix (spline transform * Frenet frame * mesh transform) straight into the instance data
+// in parallel jobs; the frames are evaluated 4 at a time by CubicBSpline::EvaluateFrames.
+class SplineFollowers
+{
+public:
+
+	SplineFollowers(CubicBSpline& spline, InstanceGroup& instances, const glm::mat4& meshTransform = glm::mat4(1.0f));
+
+	unsigned int AddFollower(const float& distance, const float& speed); // also adds its instance to the group
+	void SetSpeed(const unsigned int& follower, const float& speed);
+	void ClearFollowers(); // doesn't remove the instances
+
+	void Update(const float& deltaTime);
+
+	const std::vector<SplineFollower>& GetFollowers() const;
+
+private:
+
+	CubicBSpline& mSpline;
+	InstanceGroup& mInstances;
+	glm::mat4 mMeshTransform;
+
+	std::vector<SplineFollower> mFollowers;
+	unsigned int mFirstInstance = 0; // instances of the followers are consecutive
+
+	// per follower, reused every update
+	std::vector<SplineLocation> mLocations;
+	std::vector<SplineFrame> mFrames;
+
+};
@@ -0,0 +1,121 @@
+#include "SplineStream.h"
+
+#include <vector>
+#include <algorithm>
+
+#include "Spline.h"
+#include "Parser.h"
+#include "ThreadPool.h"
+#include "TimeControl.h"
+#include "Profiler.h"
+#include "Debug.h"
+
+double SplineStreamResult::GetControlPointsPerSecond() const
+{
+	return mSeconds > 0.0 ? mControlPoints / mSeconds : 0.0;
+}
+
+double SplineStreamResult::GetSamplesPerSecond() const
+{
+	return mSeconds > 0.0 ? mSamples / mSeconds : 0.0;
+}
+
+/// <summary>
+/// Reads, evaluates and passes the samples to the sink one chunk at a time; the segments of a chunk are evaluated in parallel
+/// </summary>
+/// <param name="samplesPerSegment">Samples at t = 0, 1 / n, ..., (n - 1) / n of every segment</param>
+/// <param name="chunkSize">Control points per chunk, at least 4</param>
+/// 
+SplineStreamResult SplineStream::Evaluate(const std::string& filePath, const Sink& sink, const unsigned int& samplesPerSegment, const unsigned int& chunkSize)
+{
+	PROFILE_SCOPE("SplineStream::Evaluate");
+
+	if (samplesPerSegment == 0)
+		Debug::ThrowException("SplineStream => samples per segment must be at least 1!");
+
+	if (chunkSize < 4)
+		Debug::ThrowException("SplineStream => chunk must hold at least 4 control points! (chunkSize = " + STRING(chunkSize) + ")");
+
+	SplineStreamResult result;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::quat> orientations;
+
+	const float delta = 1.0f / samplesPerSegment;
+
+	TimeControl timer;
+	timer.Start();
+
+	// the 3 control points of overlap make the first segment of a chunk the one after the last segment of the previous chunk
+	result.mControlPoints = Parser::ReadFileChunked(filePath, chunkSize, 3, [&](const std::vector<glm::vec3>& chunk)
+	{
+		if (chunk.size() < 4)
+			return;
+
+		unsigned int segmentCount = chunk.size() - 3;
+		unsigned int sampleCount = segmentCount * samplesPerSegment;
+
+		positions.resize(sampleCount);
+		orientations.resize(sampleCount);
+
+		ThreadPool::GetShared().ParallelFor(segmentCount, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+			{
+				SplineSegment segment = CubicBSpline::ComputeSegment(&chunk[i]);
+				CubicBSpline::EvaluateSegmentSamples(segment, 0, samplesPerSegment, delta, &positions[i * samplesPerSegment], &orientations[i * samplesPerSegment]);
+			}
+		}, std::max(1u, SPLINE_PARALLEL_MIN_SAMPLES / samplesPerSegment));
+
+		sink(positions.data(), orientations.data(), sampleCount);
+
+		result.mSamples += sampleCount;
+		result.mChunks++;
+	});
+
+	result.mSeconds = timer.End();
+
+	return result;
+}
+
+SplineStream::Sink SplineStream::FileSink(std::ofstream& file)
+{
+	std::vector<float> staging;
+
+	return [&file, staging](const glm::vec3* positions, const glm::quat* orientations, const unsigned int& count) mutable
+	{
+		staging.resize((size_t)count * 7);
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			float* sample = &staging[(size_t)i * 7];
+
+			sample[0] = positions[i].x;
+			sample[1] = positions[i].y;
+			sample[2] = positions[i].z;
+			sample[3] = orientations[i].x;
+			sample[4] = orientations[i].y;
+			sample[5] = orientations[i].z;
+			sample[6] = orientations[i].w;
+		}
+
+		file.write((const char*)staging.data(), staging.size() * sizeof(float));
+	};
+}
+
+void SplineStream::Run(const std::string& filePath, const std::string& outputPath, const unsigned int& samplesPerSegment)
+{
+	std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+		Debug::ThrowException("SplineStream => couldn't open file '" + outputPath + "' for writing!");
+
+	SplineStreamResult result = Evaluate(filePath, FileSink(file), samplesPerSegment);
+
+	printf("-------------------\n");
+	printf("Spline stream (%u samples per segment, %u control points per chunk)\n\n", samplesPerSegment, SPLINE_STREAM_CHUNK_SIZE);
+	printf("%zu control points, %zu samples in %zu chunks, %.3f s\n", result.mControlPoints, result.mSamples, result.mChunks, result.mSeconds);
+	printf("%.0f control points/s\t%.0f samples/s\t%.1f MB written\n", result.GetControlPointsPerSecond(), result.GetSamplesPerSecond(),
+		result.mSamples * 7 * sizeof(float) / (1024.0 * 1024.0));
+	printf("-------------------\n");
+}
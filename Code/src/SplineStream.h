@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <functional>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#define SPLINE_STREAM_CHUNK_SIZE 16384 // control points held in memory at once
+#define SPLINE_STREAM_SAMPLES_PER_SEGMENT 16
+
+struct SplineStreamResult
+{
+	size_t mControlPoints = 0;
+	size_t mSamples = 0;
+	size_t mChunks = 0;
+	double mSeconds = 0.0; // reading, evaluation and the sink
+
+	double GetControlPointsPerSecond() const;
+	double GetSamplesPerSecond() const;
+};
+
+// Evaluates a uniform cubic B-spline from a control point file chunk by chunk, consecutive chunks share 3 control points
+// so no segment is lost between them. Memory is bounded by the chunk size, not by the file; the samples are the same as
+// CubicBSpline's uniform sampling with the same number of samples per segment.
+class SplineStream
+{
+public:
+
+	// receives the samples of one chunk; the arrays are only valid during the call
+	using Sink = std::function<void(const glm::vec3* positions, const glm::quat* orientations, const unsigned int& count)>;
+
+	static SplineStreamResult Evaluate(const std::string& filePath, const Sink& sink, const unsigned int& samplesPerSegment = SPLINE_STREAM_SAMPLES_PER_SEGMENT,
+		const unsigned int& chunkSize = SPLINE_STREAM_CHUNK_SIZE);
+
+	static Sink FileSink(std::ofstream& file); // binary, position and orientation (x, y, z, w) per sample
+
+	// evaluates into a file and prints the throughput
+	static void Run(const std::string& filePath, const std::string& outputPath, const unsigned int& samplesPerSegment = SPLINE_STREAM_SAMPLES_PER_SEGMENT);
+
+};
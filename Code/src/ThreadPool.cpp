@@ -0,0 +1,200 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "Debug.h"
+#include "Profiler.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	mWorkers.reserve(threadCount);
+
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		mWorkers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+
+	mJobAvailable.notify_all();
+
+	for (auto& worker : mWorkers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Enqueue(const std::function<void()>& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobs.push(job);
+	}
+
+	mJobAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	// help out instead of sleeping while there is still queued work
+	while (RunPendingJob(lock))
+	{
+	}
+
+	mJobsDone.wait(lock, [this]() { return mJobs.empty() && mActiveJobs == 0; });
+}
+
+void ThreadPool::ParallelFor(const unsigned int& count, const std::function<void(unsigned int begin, unsigned int end)>& job, const unsigned int& minChunk)
+{
+	if (count == 0)
+		return;
+
+	unsigned int chunk = std::max(minChunk, 1u);
+	unsigned int chunkCount = std::min<unsigned int>((unsigned int)mWorkers.size() + 1, (count + chunk - 1) / chunk);
+
+	if (chunkCount <= 1)
+	{
+		job(0, count);
+		return;
+	}
+
+	unsigned int chunkSize = (count + chunkCount - 1) / chunkCount;
+	unsigned int remaining = 0; // guarded by mMutex
+	std::exception_ptr error; // first exception thrown by any chunk; guarded by mMutex
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		for (unsigned int begin = chunkSize; begin < count; begin += chunkSize)
+		{
+			unsigned int end = std::min(begin + chunkSize, count);
+			remaining++;
+
+			mJobs.push([this, &job, &remaining, &error, begin, end]()
+			{
+				std::exception_ptr jobError;
+
+				try
+				{
+					job(begin, end);
+				}
+				catch (...)
+				{
+					jobError = std::current_exception();
+				}
+
+				std::lock_guard<std::mutex> lock(mMutex);
+
+				if (jobError && !error)
+					error = jobError;
+
+				remaining--;
+				mJobsDone.notify_all();
+			});
+		}
+	}
+
+	mJobAvailable.notify_all();
+
+	// first chunk runs on the calling thread; the queued chunks reference this stack frame,
+	// so an exception is only rethrown once all of them are done
+	std::exception_ptr callerError;
+
+	try
+	{
+		job(0, std::min(chunkSize, count));
+	}
+	catch (...)
+	{
+		callerError = std::current_exception();
+	}
+
+	// only waits for its own chunks, so ParallelFor may be nested inside a job
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (remaining > 0)
+	{
+		if (!RunPendingJob(lock))
+			mJobsDone.wait(lock);
+	}
+
+	if (callerError)
+		std::rethrow_exception(callerError);
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+unsigned int ThreadPool::GetThreadCount() const
+{
+	return (unsigned int)mWorkers.size();
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	Profiler::SetThreadName("Worker");
+
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	while (true)
+	{
+		mJobAvailable.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+
+		if (mStopping && mJobs.empty())
+			return;
+
+		RunPendingJob(lock);
+	}
+}
+
+// Expects the lock to be held; releases it while the job runs
+bool ThreadPool::RunPendingJob(std::unique_lock<std::mutex>& lock)
+{
+	if (mJobs.empty())
+		return false;
+
+	std::function<void()> job = std::move(mJobs.front());
+	mJobs.pop();
+	mActiveJobs++;
+
+	lock.unlock();
+
+	// an exception leaving an Enqueue job has nowhere to go; it must not end the worker or leave mActiveJobs counted
+	try
+	{
+		job();
+	}
+	catch (...)
+	{
+		Debug::Print("ThreadPool => job threw an exception!");
+	}
+
+	lock.lock();
+
+	mActiveJobs--;
+
+	if (mJobs.empty() && mActiveJobs == 0)
+		mJobsDone.notify_all();
+
+	return true;
+}
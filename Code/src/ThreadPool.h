@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Fixed set of worker threads; the calling thread also executes jobs while it waits
+class ThreadPool
+{
+public:
+
+	ThreadPool(unsigned int threadCount = 0); // 0 = hardware concurrency - 1
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Enqueue(const std::function<void()>& job);
+	void Wait(); // waits for every queued job; not meant to be called from inside a job
+
+	// Splits [0, count) into chunks of at least minChunk items and blocks until all of them are done
+	void ParallelFor(const unsigned int& count, const std::function<void(unsigned int begin, unsigned int end)>& job, const unsigned int& minChunk = 1);
+
+	unsigned int GetThreadCount() const;
+
+	static ThreadPool& GetShared();
+
+private:
+
+	void WorkerLoop();
+	bool RunPendingJob(std::unique_lock<std::mutex>& lock);
+
+	std::vector<std::thread> mWorkers;
+	std::queue<std::function<void()>> mJobs;
+
+	std::mutex mMutex;
+	std::condition_variable mJobAvailable;
+	std::condition_variable mJobsDone;
+
+	unsigned int mActiveJobs = 0;
+	bool mStopping = false;
+
+};
@@ -32,6 +32,7 @@ const glm::vec3& Transform::GetScale() const
 void Transform::SetPosition(const glm::vec3& pos)
 {
 	mHasTransformed = true;
+	mVersion++;
 
 	glm::vec3 direction = (pos - mPosition);
 	mTranslation = glm::translate(mTranslation, direction);
@@ -41,6 +42,7 @@ void Transform::SetPosition(const glm::vec3& pos)
 void Transform::SetOrientation(const glm::vec3& orientation)
 {
 	mHasTransformed = true;
+	mVersion++;
 
 	glm::vec3 endOrientation = orientation - mOrientation;
 
@@ -59,6 +61,7 @@ void Transform::SetOrientation(const glm::vec3& orientation)
 void Transform::SetOrientation(const glm::vec3& axis, const float& angle)
 {
 	mHasTransformed = true;
+	mVersion++;
 
 	mRotation = glm::mat4(1.0f);
 
@@ -68,16 +71,16 @@ void Transform::SetOrientation(const glm::vec3& axis, const float& angle)
 void Transform::SetOrientation(const glm::mat4& rotationMatrix)
 {
 	mHasTransformed = true;
+	mVersion++;
 
 	mRotation = rotationMatrix;
-
-	printf("Matrix set orientation used!\n");
 }
 
 // not sure if this actually works; gotta test
 void Transform::ResetScale()
 {
 	mHasTransformed = true;
+	mVersion++;
 
 	mScale = { 1.0f, 1.0f, 1.0f };
 	mScaling = { glm::mat4{1.0f} };
@@ -86,6 +89,7 @@ void Transform::ResetScale()
 void Transform::Translation(const glm::vec3& translation)
 {
 	mHasTransformed = true;
+	mVersion++;
 
 	mTranslation = glm::translate(mTranslation, translation);
 	mPosition += translation;
@@ -94,6 +98,7 @@ void Transform::Translation(const glm::vec3& translation)
 void Transform::Rotate(const glm::vec3& rotation)
 {
 	mHasTransformed = true;
+	mVersion++;
 
 	glm::vec3 axis{ 1.0f, 0.0f, 0.0f };
 	mRotation = glm::rotate(mRotation, glm::radians(rotation.x), axis);
@@ -110,11 +115,22 @@ void Transform::Rotate(const glm::vec3& rotation)
 void Transform::Scale(const glm::vec3& scale)
 {
 	mHasTransformed = true;
+	mVersion++;
 
 	mScaling = glm::scale(mScaling, scale);
 	mScale *= scale;
 }
 
+/// <summary>
+/// 
+/// </summary>
+/// <returns>Counter which changes every time the transform is modified</returns>
+/// 
+const unsigned int& Transform::GetVersion() const
+{
+	return mVersion;
+}
+
 const glm::mat4& Transform::GetMatrix()
 {
 	if(!mHasTransformed)
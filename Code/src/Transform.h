@@ -38,6 +38,7 @@ public:
 	void Scale(const glm::vec3& scale);
 
 	const glm::mat4& GetMatrix();
+	const unsigned int& GetVersion() const;
 
 
 	static glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4* from);
@@ -46,6 +47,7 @@ private:
 
 	glm::mat4 mMatrix{ 1.0f };
 	bool mHasTransformed = false;
+	unsigned int mVersion = 0;
 
 	glm::vec3 mPosition{ 0.0f };
 	glm::mat4 mTranslation{ 1.0f };
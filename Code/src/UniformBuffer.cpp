@@ -0,0 +1,90 @@
+#include "UniformBuffer.h"
+
+#include <GL/glew.h>
+
+#include "Debug.h"
+#include "Profiler.h"
+
+UniformBuffer::UniformBuffer(const unsigned int& size, const unsigned int& bindingPoint)
+	:
+	mBindingPoint(bindingPoint),
+	mSize(size)
+{
+	glGenBuffers(1, &mRendererID);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, mRendererID);
+	glBufferData(GL_UNIFORM_BUFFER, mSize, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	Bind();
+}
+
+UniformBuffer::~UniformBuffer()
+{
+	glDeleteBuffers(1, &mRendererID);
+}
+
+/// <summary>
+/// 
+/// </summary>
+/// <param name="data">Pointer to the block data</param>
+/// <param name="size">Size of data; in bytes</param>
+/// <param name="offset">Offset inside the block; in bytes</param>
+/// 
+void UniformBuffer::Update(const void* data, const unsigned int& size, const unsigned int& offset)
+{
+	PROFILE_SCOPE("UniformBuffer::Update");
+
+	if (offset + size > mSize)
+		Debug::ThrowException("Uniform buffer update out of range! (mRendererID = " + STRING(mRendererID) + ")");
+
+	glBindBuffer(GL_UNIFORM_BUFFER, mRendererID);
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// Reallocates the buffer; previous contents are discarded
+void UniformBuffer::Resize(const unsigned int& size)
+{
+	mSize = size;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, mRendererID);
+	glBufferData(GL_UNIFORM_BUFFER, mSize, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::Bind() const
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, mBindingPoint, mRendererID);
+}
+
+// Binds a part of the buffer; offset has to be a multiple of GetOffsetAlignment()
+void UniformBuffer::BindRange(const unsigned int& offset, const unsigned int& size) const
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, mBindingPoint, mRendererID, offset, size);
+}
+
+unsigned int UniformBuffer::GetOffsetAlignment()
+{
+	static int alignment = 0;
+
+	if (alignment == 0)
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+	return (unsigned int)alignment;
+}
+
+const unsigned int& UniformBuffer::GetRendererID() const
+{
+	return mRendererID;
+}
+
+const unsigned int& UniformBuffer::GetBindingPoint() const
+{
+	return mBindingPoint;
+}
+
+const unsigned int& UniformBuffer::GetSize() const
+{
+	return mSize;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#define CAMERA_BLOCK_BINDING 0
+#define OBJECT_BLOCK_BINDING 1
+#define BONES_BLOCK_BINDING 2
+
+#define MAX_BONES 100 // has to match MAX_BONES in the shaders
+
+// std140 layouts of the uniform blocks declared in the shaders
+// (only mat4/vec4 members, so the C++ layout matches without extra padding)
+
+struct CameraBlock
+{
+	glm::mat4 mView{ 1.0f };
+	glm::mat4 mProjection{ 1.0f };
+	glm::vec4 mViewPos{ 0.0f };
+};
+
+struct ObjectBlock
+{
+	glm::mat4 mModel{ 1.0f };
+	glm::mat4 mNormalMatrix{ 1.0f };
+};
+
+struct BonesBlock
+{
+	glm::mat4 mBones[MAX_BONES];
+};
+
+class UniformBuffer
+{
+public:
+
+	UniformBuffer(const unsigned int& size, const unsigned int& bindingPoint);
+	~UniformBuffer();
+
+	void Update(const void* data, const unsigned int& size, const unsigned int& offset = 0);
+	void Resize(const unsigned int& size);
+
+	void Bind() const;
+	void BindRange(const unsigned int& offset, const unsigned int& size) const;
+
+	static unsigned int GetOffsetAlignment();
+
+	const unsigned int& GetRendererID() const;
+	const unsigned int& GetBindingPoint() const;
+	const unsigned int& GetSize() const;
+
+private:
+
+	unsigned int mRendererID = 0;
+	unsigned int mBindingPoint;
+	unsigned int mSize; // in bytes
+
+};
+
+// Uniform buffer holding a single std140 block; CPU copy is written with one Upload() call
+template<typename T>
+class UniformBlock
+{
+public:
+
+	UniformBlock(const unsigned int& bindingPoint)
+		:
+		mBuffer(sizeof(T), bindingPoint)
+	{
+		Upload();
+	}
+
+	T& Data()
+	{
+		return mData;
+	}
+
+	const T& Data() const
+	{
+		return mData;
+	}
+
+	void Upload()
+	{
+		mBuffer.Update(&mData, sizeof(T));
+	}
+
+	void Upload(const unsigned int& size)
+	{
+		mBuffer.Update(&mData, size);
+	}
+
+	void Bind() const
+	{
+		mBuffer.Bind();
+	}
+
+private:
+
+	T mData{};
+	UniformBuffer mBuffer;
+
+};
@@ -63,6 +63,42 @@ void VertexArray::AddBuffer(const VertexBuffer& vb, const IndexBuffer& ib)
 	ib.Bind();
 }
 
+/// <summary>
+/// Adds per-instance attributes which are read once per instance instead of once per vertex
+/// </summary>
+/// <param name="instanceLayout">Layout of a single instance element</param>
+/// <param name="bindingIndex">Binding index the instance buffer is going to be bound to</param>
+/// <param name="firstAttributeIndex">Shader attribute location of the first instance element</param>
+/// 
+void VertexArray::AddInstanceBuffer(const VertexBufferLayout& instanceLayout, const unsigned int& bindingIndex, const unsigned int& firstAttributeIndex)
+{
+	if (!instanceLayout.IsInitialized())
+	{
+		Debug::ThrowException("Instance layout is empty! (mRendererID = " + STRING(mRendererID) + ")");
+	}
+
+	Bind();
+
+	mInstanceLayout = instanceLayout;
+
+	unsigned int offset = 0;
+	const auto& elements = mInstanceLayout.GetElements();
+
+	for (unsigned int i = 0; i < elements.size(); i++)
+	{
+		const auto& e = elements[i];
+		unsigned int attributeIndex = firstAttributeIndex + i;
+
+		glEnableVertexAttribArray(attributeIndex);
+		VertexAttribFormat(attributeIndex, e.count, e.type, e.normalized, offset);
+		glVertexAttribBinding(attributeIndex, bindingIndex);
+
+		offset += e.count * VertexBufferElement::SizeOfDataType(e.type);
+	}
+
+	glVertexBindingDivisor(bindingIndex, 1);
+}
+
 void VertexArray::Bind() const
 {
 	if (mRendererID == 0)
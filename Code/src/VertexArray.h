@@ -20,6 +20,7 @@ public:
 	void SetDrawingMode(const unsigned int& drawingMode);
 
 	void AddBuffer(const VertexBuffer& vb, const IndexBuffer& ib);
+	void AddInstanceBuffer(const VertexBufferLayout& instanceLayout, const unsigned int& bindingIndex, const unsigned int& firstAttributeIndex);
 
 	void Bind() const;
 	void Unbind() const;
@@ -34,6 +35,7 @@ private:
 	unsigned int mRendererID;
 
 	VertexBufferLayout mLayout;
+	VertexBufferLayout mInstanceLayout;
 	bool mLayoutBuffersSeperated = false;
 
 	unsigned int mUsage;
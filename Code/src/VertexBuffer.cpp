@@ -2,6 +2,7 @@
 
 #include "Debug.h"
 #include "Vertex.h"
+#include "Profiler.h"
 
 #define INITIAL_BUFFER_SIZE 16 * 1024 * 1024 // 16 MB in bytes
 
@@ -42,6 +43,8 @@ VertexBuffer::~VertexBuffer()
 /// 
 void VertexBuffer::FillBuffer(const void* data, const unsigned int& size, unsigned int usage)
 {
+	PROFILE_SCOPE("VertexBuffer::FillBuffer");
+
 	if (usage != mUsage)
 		Debug::Print("Inserted usage type is different from the member usage type! (mRendererID = " + STRING(mRendererID) + ")");
 
@@ -102,7 +105,7 @@ void VertexBuffer::AdjustBufferSize(const unsigned int& newSize, const unsigned
 
 	if (mBufferCapacity == 0)
 	{
-		mBufferCapacity = INITIAL_BUFFER_SIZE;
+		mBufferCapacity = (mInitialCapacity != 0) ? mInitialCapacity : INITIAL_BUFFER_SIZE;
 		sizeChanged = true;
 	}
 
@@ -131,6 +134,16 @@ void VertexBuffer::AdjustBufferSize(const unsigned int& newSize, const unsigned
 	}
 }
 
+/// <summary>
+/// Small buffers (e.g. thousands of curves with a few control points each) would waste most of the default first allocation
+/// </summary>
+/// <param name="capacity">In bytes; only used if the buffer isn't allocated yet</param>
+/// 
+void VertexBuffer::SetInitialCapacity(const unsigned int& capacity)
+{
+	mInitialCapacity = capacity;
+}
+
 const bool& VertexBuffer::IsInitialized() const
 {
 	return mInitialized;
@@ -177,6 +190,17 @@ void VertexBuffer::Bind() const
 	boundVBO = mRendererID;
 }
 
+/// <summary>
+/// Same as Bind<T>, for when the vertex type is only known at runtime
+/// </summary>
+/// <param name="bindingIndex">Vertex buffer binding index</param>
+/// <param name="stride">Size of a single element; in bytes</param>
+/// 
+void VertexBuffer::Bind(const unsigned int& bindingIndex, const unsigned int& stride) const
+{
+	glBindVertexBuffer(bindingIndex, mRendererID, 0, stride);
+}
+
 void VertexBuffer::Unbind() const
 {
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -15,6 +15,7 @@ public:
 	unsigned int AppendData(const void* data, const unsigned int& size);
 
 	void AdjustBufferSize(const unsigned int& newSize, const unsigned int& usage);
+	void SetInitialCapacity(const unsigned int& capacity); // size of the first allocation; in bytes (0 = INITIAL_BUFFER_SIZE)
 
 	const bool& IsInitialized() const;
 
@@ -31,6 +32,8 @@ public:
 		glBindVertexBuffer(bindingIndex, mRendererID, 0, sizeof(T));
 	}
 
+	void Bind(const unsigned int& bindingIndex, const unsigned int& stride) const;
+
 	void Unbind() const;
 
 private:
@@ -41,6 +44,7 @@ private:
 	unsigned int mRendererID = 0;
 	unsigned int mUsage;
 
+	unsigned int mInitialCapacity = 0; // in bytes
 	unsigned int mBufferCapacity = 0; // (filled memory + reserved memory); in bytes
 	unsigned int mBufferSize = 0; // (filled memory); in bytes
 };
\ No newline at end of file
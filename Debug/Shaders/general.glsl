@@ -1,7 +1,11 @@
 #shader VERT
 #version 450 core
 
-#define MAX_NUM_OF_BONES_PER_VERTEX 8
+// Variant defines (injected by ShaderVariants, see ShaderVariantKey)
+#ifndef NUM_BONE_INFLUENCES
+#define NUM_BONE_INFLUENCES 8
+#endif
+
 #define MAX_BONES 100
 
 layout (location = 0) in vec3 position;
@@ -11,28 +15,45 @@ layout (location = 3) in uvec4 boneIDs_2;
 layout (location = 4) in vec4 boneWeights_1;
 layout (location = 5) in vec4 boneWeights_2;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// std140 blocks (see UniformBuffer.h)
+layout (std140, binding = 0) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec4 uViewPos;
+};
+
+layout (std140, binding = 1) uniform Object
+{
+	mat4 model;
+	mat4 normalMatrix;
+};
 
-uniform mat4 uBones[MAX_BONES];
+layout (std140, binding = 2) uniform Bones
+{
+	mat4 uBones[MAX_BONES];
+};
 
 out vec3 vColor;
 out vec3 vLocalPos;
 out vec3 vFragPos;
 out vec3 vNormal;
 
+#ifdef DEBUG_BONE_VIEW
 flat out uvec4 vBoneIDs_1;
 flat out uvec4 vBoneIDs_2;
 out vec4 vBoneWeights_1;
 out vec4 vBoneWeights_2;
+#endif
 
 void main()
 {
+#if NUM_BONE_INFLUENCES == 0
+	mat4 boneTransform = mat4(1.0f);
+#else
 	mat4 boneTransform = mat4(0.0f);
 	
-	
-	for (int j = 0; j < MAX_NUM_OF_BONES_PER_VERTEX; j++)
+	for (int j = 0; j < NUM_BONE_INFLUENCES; j++)
 	{
 		if(j < 4)
 		{
@@ -43,26 +64,41 @@ void main()
 			boneTransform += uBones[boneIDs_2[j-4]] * boneWeights_2[j-4];
 		}
 	}
-
+#endif
 
 	vFragPos = vec3(model * vec4(position, 1.0));
 	gl_Position = projection * view * model * boneTransform * vec4(position, 1.0f);
 	vLocalPos = position;
 	vColor = color;
-	vNormal = mat3(transpose(inverse(model))) * color;
+	vNormal = mat3(normalMatrix) * color;
+
+#ifdef DEBUG_BONE_VIEW
 	vBoneIDs_1 = boneIDs_1;
 	vBoneIDs_2 = boneIDs_2;
 	vBoneWeights_1 = boneWeights_1;
 	vBoneWeights_2 = boneWeights_2;
+#endif
 }
 
 #shader FRAG
 #version 450 core
 
-#define MAX_NUM_OF_BONES_PER_VERTEX 8
+#ifndef NUM_BONE_INFLUENCES
+#define NUM_BONE_INFLUENCES 8
+#endif
+
+// 0 = unlit, 1 = lambert, 2 = phong
+#ifndef LIGHTING_MODEL
+#define LIGHTING_MODEL 2
+#endif
+
+layout (std140, binding = 0) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec4 uViewPos;
+};
 
-uniform int uDisplayBoneIndex;
-uniform vec3 uViewPos;
 uniform vec3 uLightColor;
 
 in vec3 vColor;
@@ -70,15 +106,22 @@ in vec3 vLocalPos;
 in vec3 vFragPos;
 in vec3 vNormal;
 
+#ifdef DEBUG_BONE_VIEW
+uniform int uDisplayBoneIndex;
+
 flat in uvec4 vBoneIDs_1;
 flat in uvec4 vBoneIDs_2;
 in vec4 vBoneWeights_1;
 in vec4 vBoneWeights_2;
+#endif
 
 out vec4 FragColor;
 
-void main()
+vec3 CalculateLighting()
 {
+#if LIGHTING_MODEL == 0
+	return uLightColor;
+#else
 	vec3 lightPos = vec3(0.0f, 2.0f, 1.0f);
 	
 	float ambientStrenght = 0.25;
@@ -88,41 +131,49 @@ void main()
 	vec3 lightDirection = normalize(lightPos - vFragPos);
 	float diff = max(dot(norm, lightDirection), 0.0f);
 	vec3 diffuse = diff * uLightColor;
-	
+
+#if LIGHTING_MODEL == 1
+	return ambient + diffuse;
+#else
 	float specularStrength = 0.5;
-    vec3 viewDir = normalize(uViewPos - vFragPos);
+    vec3 viewDir = normalize(uViewPos.xyz - vFragPos);
     vec3 reflectDir = reflect(-lightDirection, norm);  
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
     vec3 specular = specularStrength * spec * uLightColor; 
 
-	bool found = false;
-	
-	for (int j = 0; j < MAX_NUM_OF_BONES_PER_VERTEX; j++)
+	return ambient + diffuse + specular;
+#endif
+#endif
+}
+
+#ifdef DEBUG_BONE_VIEW
+vec4 BoneWeightColor(vec3 light, float weight)
+{
+	if( weight >= 0.7 )
+		return vec4(light * vec3(1.0, 0.0, 0.0), 0.0) * weight;
+	else if( weight >= 0.4 && weight <= 0.6 )
+		return vec4(light * vec3(0.0, 1.0, 0.0), 0.0) * weight;
+	else if( weight >= 0.1 )
+		return vec4(light * vec3(1.0, 1.0, 0.0), 0.0) * weight;
+
+	return vec4(light * vec3(0.1, 0.1, 0.8), 1.0);
+}
+#endif
+
+void main()
+{
+	vec3 light = CalculateLighting();
+
+#ifdef DEBUG_BONE_VIEW
+	for (int j = 0; j < NUM_BONE_INFLUENCES; j++)
 	{
 		// Bones 0 - 3
 		if( j < 4)
 		{
 			if (vBoneIDs_1[j] == uDisplayBoneIndex)
 			{
-				if( vBoneWeights_1[j] >= 0.7 )
-				{
-					FragColor = vec4((ambient + diffuse + specular) * vec3(1.0, 0.0, 0.0), 0.0) * vBoneWeights_1[j];
-				} 
-				else if( vBoneWeights_1[j] >= 0.4 && vBoneWeights_1[j] <= 0.6 )
-				{
-					FragColor = vec4((ambient + diffuse + specular) * vec3(0.0, 1.0, 0.0), 0.0) * vBoneWeights_1[j];
-				} 
-				else if( vBoneWeights_1[j] >= 0.1 )
-				{
-					FragColor = vec4((ambient + diffuse + specular) * vec3(1.0, 1.0, 0.0), 0.0) * vBoneWeights_1[j];
-				}
-				else 
-				{
-					FragColor = vec4((ambient + diffuse + specular) * vec3(0.1, 0.1, 0.8), 1.0);
-				}
-				
-				found = true;
-				break;
+				FragColor = BoneWeightColor(light, vBoneWeights_1[j]);
+				return;
 			}
 		}
 		// Bones 4 - 7
@@ -130,30 +181,13 @@ void main()
 		{
 			if (vBoneIDs_2[j - 4] == uDisplayBoneIndex)
 			{
-				if( vBoneWeights_2[j-4] >= 0.7 )
-				{
-					FragColor = vec4((ambient + diffuse + specular) * vec3(1.0, 0.0, 0.0), 0.0) * vBoneWeights_2[j-4];
-				} 
-				else if( vBoneWeights_2[j-4] >= 0.4 && vBoneWeights_2[j-4] <= 0.6 )
-				{
-					FragColor = vec4((ambient + diffuse + specular) * vec3(0.0, 1.0, 0.0), 0.0) * vBoneWeights_2[j-4];
-				} 
-				else if( vBoneWeights_2[j-4] >= 0.1 )
-				{
-					FragColor = vec4((ambient + diffuse + specular) * vec3(1.0, 1.0, 0.0), 0.0) * vBoneWeights_2[j-4];
-				}
-				else 
-				{
-					FragColor = vec4((ambient + diffuse + specular) * vec3(0.1, 0.1, 0.8), 1.0);
-				}
-
-				found = true;
-				break;
+				FragColor = BoneWeightColor(light, vBoneWeights_2[j - 4]);
+				return;
 			}
 		}
 	}
-	
-	// In case the selected display bone is not associated with this pixel
-	if(!found)
-		FragColor = vec4((ambient + diffuse + specular) * vec3(0.15, 0.15, 0.75), 1.0);
-}
\ No newline at end of file
+#endif
+
+	// In case the selected display bone is not associated with this pixel (or bone view is disabled)
+	FragColor = vec4(light * vec3(0.15, 0.15, 0.75), 1.0);
+}
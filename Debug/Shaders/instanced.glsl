@@ -0,0 +1,107 @@
+#shader VERT
+#version 450 core
+
+#define MAX_NUM_OF_BONES_PER_VERTEX 8
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 color;
+layout (location = 2) in uvec4 boneIDs_1;
+layout (location = 3) in uvec4 boneIDs_2;
+layout (location = 4) in vec4 boneWeights_1;
+layout (location = 5) in vec4 boneWeights_2;
+
+// per-instance attributes (see InstanceGroup.h)
+layout (location = 6) in vec4 instanceModel_0;
+layout (location = 7) in vec4 instanceModel_1;
+layout (location = 8) in vec4 instanceModel_2;
+layout (location = 9) in vec4 instanceModel_3;
+layout (location = 10) in vec4 instanceNormalMatrix_0;
+layout (location = 11) in vec4 instanceNormalMatrix_1;
+layout (location = 12) in vec4 instanceNormalMatrix_2;
+layout (location = 13) in uint instanceBoneOffset;
+
+layout (std430, binding = 0) readonly buffer BonePalette
+{
+	mat4 uBonePalette[];
+};
+
+layout (std140, binding = 0) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec4 uViewPos;
+};
+
+uniform int uSkinned;
+
+out vec3 vFragPos;
+out vec3 vNormal;
+
+void main()
+{
+	mat4 model = mat4(instanceModel_0, instanceModel_1, instanceModel_2, instanceModel_3);
+	mat4 boneTransform = mat4(1.0f);
+
+	if (uSkinned != 0)
+	{
+		boneTransform = mat4(0.0f);
+
+		for (int j = 0; j < MAX_NUM_OF_BONES_PER_VERTEX; j++)
+		{
+			if(j < 4)
+			{
+				boneTransform += uBonePalette[instanceBoneOffset + boneIDs_1[j]] * boneWeights_1[j];
+			}
+			else 
+			{
+				boneTransform += uBonePalette[instanceBoneOffset + boneIDs_2[j-4]] * boneWeights_2[j-4];
+			}
+		}
+	}
+
+	vec4 worldPos = model * boneTransform * vec4(position, 1.0f);
+
+	vFragPos = vec3(worldPos);
+	gl_Position = projection * view * worldPos;
+	// bone matrices are rigid (rotation, translation, uniform scale), so their upper 3x3 can transform the normal directly
+	mat3 normalMatrix = mat3(instanceNormalMatrix_0.xyz, instanceNormalMatrix_1.xyz, instanceNormalMatrix_2.xyz);
+	vNormal = normalMatrix * mat3(boneTransform) * color;
+}
+
+#shader FRAG
+#version 450 core
+
+layout (std140, binding = 0) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec4 uViewPos;
+};
+
+uniform vec3 uLightColor;
+
+in vec3 vFragPos;
+in vec3 vNormal;
+
+out vec4 FragColor;
+
+void main()
+{
+	vec3 lightPos = vec3(0.0f, 2.0f, 1.0f);
+	
+	float ambientStrenght = 0.25;
+	vec3 ambient = ambientStrenght * uLightColor;
+	
+	vec3 norm = normalize(vNormal);
+	vec3 lightDirection = normalize(lightPos - vFragPos);
+	float diff = max(dot(norm, lightDirection), 0.0f);
+	vec3 diffuse = diff * uLightColor;
+	
+	float specularStrength = 0.5;
+	vec3 viewDir = normalize(uViewPos.xyz - vFragPos);
+	vec3 reflectDir = reflect(-lightDirection, norm);  
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+	vec3 specular = specularStrength * spec * uLightColor; 
+
+	FragColor = vec4((ambient + diffuse + specular) * vec3(0.15, 0.15, 0.75), 1.0);
+}
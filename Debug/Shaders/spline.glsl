@@ -0,0 +1,135 @@
+#shader VERT
+#version 450 core
+
+// control points of CubicBSpline (SPLINE_EVALUATION_GPU), one patch of 4 per segment
+layout (location = 0) in vec3 position;
+
+out vec3 vControlPoint;
+
+void main()
+{
+	vControlPoint = position;
+}
+
+#shader TESC
+#version 450 core
+
+layout (vertices = 4) out;
+
+layout (std140, binding = 0) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec4 uViewPos;
+};
+
+layout (std140, binding = 1) uniform Object
+{
+	mat4 model;
+	mat4 normalMatrix;
+};
+
+// viewport width, viewport height, pixels per generated line segment, max tessellation level
+uniform vec4 uTessellation;
+
+in vec3 vControlPoint[];
+out vec3 tcControlPoint[];
+
+void main()
+{
+	tcControlPoint[gl_InvocationID] = vControlPoint[gl_InvocationID];
+
+	if (gl_InvocationID != 0)
+		return;
+
+	mat4 mvp = projection * view * model;
+
+	vec4 clip[4];
+	for (int i = 0; i < 4; i++)
+	{
+		clip[i] = mvp * vec4(vControlPoint[i], 1.0f);
+	}
+
+	// the segment lies inside the convex hull of its control points, so it is invisible if they are all outside the same clip plane
+	bool culled = false;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		bool belowAll = true;
+		bool aboveAll = true;
+
+		for (int i = 0; i < 4; i++)
+		{
+			belowAll = belowAll && clip[i][axis] < -clip[i].w;
+			aboveAll = aboveAll && clip[i][axis] > clip[i].w;
+		}
+
+		culled = culled || belowAll || aboveAll;
+	}
+
+	// projected length of the control polygon is an upper bound for the length of the curve on screen
+	// (points behind the camera get a huge length and the max level)
+	float pixels = 0.0f;
+	vec2 previous = clip[0].xy / max(clip[0].w, 1e-4f) * 0.5f * uTessellation.xy;
+
+	for (int i = 1; i < 4; i++)
+	{
+		vec2 current = clip[i].xy / max(clip[i].w, 1e-4f) * 0.5f * uTessellation.xy;
+		pixels += distance(previous, current);
+		previous = current;
+	}
+
+	gl_TessLevelOuter[0] = culled ? 0.0f : 1.0f; // number of lines, 0 discards the patch
+	gl_TessLevelOuter[1] = clamp(ceil(pixels / uTessellation.z), 1.0f, uTessellation.w); // line segments
+}
+
+#shader TESE
+#version 450 core
+
+layout (isolines, equal_spacing) in;
+
+layout (std140, binding = 0) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec4 uViewPos;
+};
+
+layout (std140, binding = 1) uniform Object
+{
+	mat4 model;
+	mat4 normalMatrix;
+};
+
+in vec3 tcControlPoint[];
+
+out vec3 vColor;
+
+void main()
+{
+	float t = gl_TessCoord.x;
+	float t2 = t * t;
+	float t3 = t2 * t;
+
+	// uniform cubic B-spline basis, same curve as CubicBSpline::BuildSegments
+	vec4 basis = vec4(1.0f - 3.0f * t + 3.0f * t2 - t3,
+		4.0f - 6.0f * t2 + 3.0f * t3,
+		1.0f + 3.0f * t + 3.0f * t2 - 3.0f * t3,
+		t3) / 6.0f;
+
+	vec3 position = basis.x * tcControlPoint[0] + basis.y * tcControlPoint[1] + basis.z * tcControlPoint[2] + basis.w * tcControlPoint[3];
+
+	gl_Position = projection * view * model * vec4(position, 1.0f);
+	vColor = vec3(1.0f);
+}
+
+#shader FRAG
+#version 450 core
+
+in vec3 vColor;
+
+out vec4 FragColor;
+
+void main()
+{
+	FragColor = vec4(vColor, 1.0f);
+}